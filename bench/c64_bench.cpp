@@ -0,0 +1,327 @@
+#include "common.hpp"
+#include <c64/c64.hpp>
+#include <c64/cpu_6502.hpp>
+#include <c64/cpu_6502_impl.hpp>
+
+#include <fmt/format.h>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+// Microbenchmarks for the CPU core: one loop per addressing mode and per
+// instruction group, Klaus' functional test for every dispatch backend and a
+// KERNAL boot to READY and frame capture. Prints a table, or JSON with --json.
+//
+// Every backend runs through run_for_cycles, the only driver the JIT compiles
+// under, and counts instructions with CPU6502Base::instruction_count. Klaus'
+// test runs up to the same clock, the success trap.
+//
+//   c64_bench [--json] [filter]
+
+template class CPU6502T<MockBus>;
+
+struct BenchResult {
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    double seconds = 0.0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<BenchResult()> run;
+};
+
+static constexpr uint16_t program_start = 0x0200;
+static constexpr uint64_t micro_instructions = 2000000;
+static constexpr int repetitions = 3;
+
+template<typename F>
+static BenchResult timed(F &&body) {
+    auto start = std::chrono::high_resolution_clock::now();
+    BenchResult result = body();
+    auto stop = std::chrono::high_resolution_clock::now();
+    result.seconds = std::chrono::duration<double>(stop - start).count();
+    return result;
+}
+
+/// Repeats `body` as often as it fits in a page starting at $0200, followed by
+/// a JMP back to the start, and runs it on MockBus. Zero page $10-$12 point at
+/// $3000, a subroutine at $0300 returns straight away and X = Y = 1.
+static BenchResult run_loop(std::vector<uint8_t> const &body) {
+    auto bus = MockBus();
+    uint16_t addr = program_start;
+    for (size_t repeat = 0; repeat < 32 && addr + body.size() + 3 <= 0x0300; repeat++) {
+        for (uint8_t byte: body) {
+            bus.write(addr++, byte);
+        }
+    }
+    bus.write(addr++, 0x4C);
+    bus.write(addr++, program_start & 0xFF);
+    bus.write(addr, program_start >> 8);
+
+    bus.write(0x0010, 0x00);
+    bus.write(0x0011, 0x00);
+    bus.write(0x0012, 0x30);
+    bus.write(0x0020, program_start & 0xFF);
+    bus.write(0x0021, program_start >> 8);
+    bus.write(0x0300, 0x60);
+    bus.write(0xFFFC, program_start & 0xFF);
+    bus.write(0xFFFD, program_start >> 8);
+
+    auto cpu = CPU6502T<MockBus>();
+    cpu.reset(bus);
+    cpu.step_instruction(bus);
+    cpu.x = 1;
+    cpu.y = 1;
+    cpu.status = U;
+
+    return timed([&] {
+        uint64_t start = cpu.clock_count;
+        for (uint64_t i = 0; i < micro_instructions; i++) {
+            cpu.step_instruction(bus);
+        }
+        return BenchResult{micro_instructions, cpu.clock_count - start};
+    });
+}
+
+/// The clock at which Klaus' test first reaches its success trap at $3469,
+/// found once by stepping so that every backend can run to exactly there
+static uint64_t klaus_cycles(std::vector<uint8_t> const &data) {
+    static uint64_t cycles = 0;
+    if (cycles == 0) {
+        auto bus = MockBus();
+        for (size_t index = 0; index < data.size(); index++) {
+            bus.write(index, data[index]);
+        }
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x04);
+        auto cpu = CPU6502T<MockBus>();
+        cpu.reset(bus);
+        while (cpu.pc != 0x3469) {
+            cpu.step_instruction(bus);
+        }
+        cycles = cpu.clock_count;
+    }
+    return cycles;
+}
+
+template<typename Bus>
+static BenchResult run_klaus(std::vector<uint8_t> const &data, Dispatch dispatch) {
+    uint64_t end = klaus_cycles(data);
+    auto bus = MockBus();
+    for (size_t index = 0; index < data.size(); index++) {
+        bus.write(index, data[index]);
+    }
+    bus.write(0xFFFC, 0x00);
+    bus.write(0xFFFD, 0x04);
+
+    auto cpu = CPU6502T<Bus>();
+    cpu.dispatch = dispatch;
+    cpu.reset(bus);
+
+    auto result = timed([&] {
+        cpu.run_for_cycles(bus, end);
+        return BenchResult{cpu.instruction_count, cpu.clock_count};
+    });
+    if (cpu.pc != 0x3469 || cpu.cycles != 0) {
+        throw std::runtime_error(fmt::format("klaus: stopped at ${:04X} instead of the success trap", cpu.pc));
+    }
+    return result;
+}
+
+static BenchResult run_kernal_boot(Dispatch dispatch) {
+    auto c64 = std::make_unique<C64>();
+    c64->set_dispatch(dispatch);
+    c64->reset();
+
+    return timed([&] {
+        uint64_t first = c64->get_cpu().instruction_count;
+        uint64_t cycles = 0;
+        // the '.' of READY. on the screen
+        while (c64->read(0x04CD, true) != 0x2E) {
+            cycles += c64->run_for_cycles(1000);
+        }
+        return BenchResult{c64->get_cpu().instruction_count - first, cycles};
+    });
+}
+
+/// Boots to READY, then times 20M cycles of BASIC running FOR I=1 TO 1E9:NEXT
+static BenchResult run_basic_loop(Dispatch dispatch) {
+    auto c64 = std::make_unique<C64>();
+    c64->set_dispatch(dispatch);
+    c64->reset();
+    c64->run_for_cycles(2500000);
+
+    // 10 FOR I=1 TO 1E9:NEXT
+    const std::vector<uint8_t> prg = {
+            0x01, 0x08, 0x15, 0x08, 0x0A, 0x00, 0x81, 0x20, 0x49, 0xB2, 0x31, 0x20,
+            0xA4, 0x20, 0x31, 0x45, 0x39, 0x3A, 0x82, 0x00, 0x00, 0x00,
+    };
+    c64->load_prg(prg);
+    c64->type("RUN\n");
+    c64->run_for_cycles(100000);
+
+    return timed([&] {
+        uint64_t first = c64->get_cpu().instruction_count;
+        uint64_t cycles = c64->run_for_cycles(20000000);
+        return BenchResult{c64->get_cpu().instruction_count - first, cycles};
+    });
+}
+
+/// Boots to READY, then times 250 frames, each one captured as RGBA
+static BenchResult run_frame_capture(Dispatch dispatch) {
+    auto c64 = std::make_unique<C64>();
+    c64->set_dispatch(dispatch);
+    c64->reset();
+    c64->run_for_cycles(2500000);
+    std::vector<uint8_t> rgba(VicII::frame_width * VicII::frame_height * 4);
+
+    return timed([&] {
+        uint64_t cycles = 0;
+        for (int frame = 0; frame < 250; frame++) {
+            cycles += c64->run_frames(1);
+            c64->get_vic().frame_rgba(rgba.data());
+        }
+        return BenchResult{0, cycles};
+    });
+}
+
+// A three voice chord held for 250 frames, collected once a frame
+static BenchResult run_audio(Dispatch dispatch) {
+    auto c64 = std::make_unique<C64>();
+    c64->set_dispatch(dispatch);
+    c64->reset();
+    c64->run_for_cycles(2500000);
+    c64->enable_audio(44100);
+    // C5, E5 and G5 as pulse, sawtooth and triangle
+    const uint16_t frequencies[3] = {0x22CE, 0x2BDA, 0x3426};
+    const uint8_t waveforms[3] = {0x40, 0x20, 0x10};
+    for (int voice = 0; voice < 3; voice++) {
+        uint16_t base = 0xD400 + voice * 7;
+        c64->write(base + 0, frequencies[voice] & 0xFF);
+        c64->write(base + 1, frequencies[voice] >> 8);
+        c64->write(base + 3, 0x08);
+        c64->write(base + 5, 0x22);
+        c64->write(base + 6, 0xC4);
+        c64->write(base + 4, waveforms[voice] | 0x01);
+    }
+    c64->write(0xD417, 0xF1);
+    c64->write(0xD416, 0x40);
+    c64->write(0xD418, 0x1F);
+
+    return timed([&] {
+        uint64_t cycles = 0;
+        for (int frame = 0; frame < 250; frame++) {
+            cycles += c64->run_frames(1);
+            (void) c64->take_audio();
+        }
+        return BenchResult{0, cycles};
+    });
+}
+
+static std::vector<Benchmark> benchmarks(std::vector<uint8_t> const &klaus) {
+    std::vector<Benchmark> list;
+    auto loop = [&](std::string name, std::vector<uint8_t> body) {
+        list.push_back({std::move(name), [body] { return run_loop(body); }});
+    };
+
+    loop("mode/IMP", {0xE8});              // INX
+    loop("mode/IMM", {0xA9, 0x42});        // LDA #$42
+    loop("mode/ZP0", {0xA5, 0x10});        // LDA $10
+    loop("mode/ZPX", {0xB5, 0x10});        // LDA $10,X
+    loop("mode/ZPY", {0xB6, 0x10});        // LDX $10,Y
+    loop("mode/REL", {0xD0, 0x00});        // BNE *+2
+    loop("mode/ABS", {0xAD, 0x00, 0x30});  // LDA $3000
+    loop("mode/ABX", {0xBD, 0x00, 0x30});  // LDA $3000,X
+    loop("mode/ABY", {0xB9, 0x00, 0x30});  // LDA $3000,Y
+    loop("mode/IND", {0x6C, 0x20, 0x00});  // JMP ($0020)
+    loop("mode/IZX", {0xA1, 0x10});        // LDA ($10,X)
+    loop("mode/IZY", {0xB1, 0x10});        // LDA ($10),Y
+
+    // ADC #1, AND #$FF, ORA #0, EOR #0, CMP #0, SBC #0
+    loop("group/alu", {0x69, 0x01, 0x29, 0xFF, 0x09, 0x00, 0x49, 0x00, 0xC9, 0x00, 0xE9, 0x00});
+    // INC $40, ASL $3000, ROR $40,X, DEC $3000,X
+    loop("group/rmw", {0xE6, 0x40, 0x0E, 0x00, 0x30, 0x76, 0x40, 0xDE, 0x00, 0x30});
+    // BNE taken, BEQ not taken, BPL taken, BMI not taken
+    loop("group/branch", {0xD0, 0x00, 0xF0, 0x00, 0x10, 0x00, 0x30, 0x00});
+    // PHA, PLA, PHP, PLP, JSR $0300 (RTS)
+    loop("group/stack", {0x48, 0x68, 0x08, 0x28, 0x20, 0x00, 0x03});
+    // SED, ADC #$19, ADC $10,X, SBC #$07, SBC $40
+    loop("group/decimal", {0xF8, 0x69, 0x19, 0x75, 0x10, 0xE9, 0x07, 0xE5, 0x40});
+
+    const std::pair<Dispatch, const char *> backends[] = {
+            {Dispatch::Switch,   "switch"},
+            {Dispatch::Table,    "table"},
+            {Dispatch::Threaded, "threaded"},
+            {Dispatch::Cached,   "cached"},
+            {Dispatch::Jit,      "jit"},
+    };
+    for (auto [dispatch, name]: backends) {
+        auto d = dispatch;
+        list.push_back({fmt::format("klaus/CPUIO/{}", name), [&klaus, d] { return run_klaus<CPUIO>(klaus, d); }});
+        list.push_back({fmt::format("klaus/MockBus/{}", name), [&klaus, d] { return run_klaus<MockBus>(klaus, d); }});
+    }
+    for (auto [dispatch, name]: backends) {
+        auto d = dispatch;
+        list.push_back({fmt::format("c64/kernal_boot/{}", name), [d] { return run_kernal_boot(d); }});
+        list.push_back({fmt::format("c64/basic_loop/{}", name), [d] { return run_basic_loop(d); }});
+    }
+
+    list.push_back({"c64/frames", [] { return run_frame_capture(Dispatch::Table); }});
+    list.push_back({"c64/frames/jit", [] { return run_frame_capture(Dispatch::Jit); }});
+    list.push_back({"c64/audio/jit", [] { return run_audio(Dispatch::Jit); }});
+    return list;
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    auto klaus = load_rom_file("roms/6502_functional_test.bin");
+
+    if (json) {
+        fmt::print("{{\n  \"benchmarks\": [");
+    }
+    bool first = true;
+    for (auto &benchmark: benchmarks(klaus)) {
+        if (benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        // best of a few runs, the first one also warms up the caches
+        BenchResult best;
+        for (int i = 0; i < repetitions; i++) {
+            auto result = benchmark.run();
+            if (i == 0 || result.seconds < best.seconds) {
+                best = result;
+            }
+        }
+        double instructions_per_second = best.instructions / best.seconds;
+        double cycles_per_second = best.cycles / best.seconds;
+
+        if (json) {
+            fmt::print("{}\n    {{\"name\": \"{}\", \"instructions\": {}, \"cycles\": {}, \"seconds\": {:.6f}, "
+                       "\"instructions_per_second\": {:.0f}, \"cycles_per_second\": {:.0f}}}",
+                       first ? "" : ",", benchmark.name, best.instructions, best.cycles, best.seconds,
+                       instructions_per_second, cycles_per_second);
+        } else {
+            fmt::print("{:<22} {:>10d} instructions {:>11d} cycles {:>8.1f} ms {:>8.2f} Minstr/s {:>8.2f} MHz\n",
+                       benchmark.name, best.instructions, best.cycles, best.seconds * 1000.0,
+                       instructions_per_second / 1e6, cycles_per_second / 1e6);
+        }
+        first = false;
+    }
+    if (json) {
+        fmt::print("\n  ]\n}}\n");
+    }
+    return 0;
+}
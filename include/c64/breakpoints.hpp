@@ -0,0 +1,85 @@
+#ifndef C64_BREAKPOINTS_HPP
+#define C64_BREAKPOINTS_HPP
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+class C64;
+
+/// The accesses a watchpoint reacts to
+enum class Access : uint8_t {
+    Read = 1,
+    Write = 2,
+    ReadWrite = Read | Write
+};
+
+enum class BreakKind : uint8_t {
+    Breakpoint,
+    Read,
+    Write
+};
+
+/// Why a run stopped early
+struct BreakEvent {
+    BreakKind kind;
+    int id;        // of the breakpoint or watchpoint that fired
+    uint16_t addr; // the PC for breakpoints, the address accessed for watchpoints
+    uint8_t value; // the value read or written, 0 for breakpoints
+};
+
+/// Decides whether a breakpoint or watchpoint that was reached stops the run.
+/// It runs in the middle of emulation and must not add or remove points.
+using BreakCondition = std::function<bool(C64 &)>;
+
+/// The breakpoints and watchpoints of a C64. One bit per address and kind
+/// tells whether anything is set there, so that the hot paths only test a bit
+/// and the list of points is searched on a hit.
+class Breakpoints {
+public:
+    int add_breakpoint(uint16_t addr, BreakCondition condition);
+
+    /// Watches `first` to `last` inclusive
+    int add_watchpoint(uint16_t first, uint16_t last, Access access, BreakCondition condition);
+
+    /// Returns false when `id` is unknown
+    bool remove(int id);
+
+    [[nodiscard]] bool empty() const { return points.empty(); }
+
+    [[nodiscard]] bool is_breakpoint(uint16_t addr) const { return test(exec_bits, addr); }
+
+    [[nodiscard]] bool is_watched(uint16_t addr, BreakKind kind) const {
+        return test(kind == BreakKind::Write ? write_bits : read_bits, addr);
+    }
+
+    /// Whether a watchpoint covers any byte of `page`
+    [[nodiscard]] bool watches_page(uint8_t page) const { return watched_pages[page]; }
+
+    /// The first point of `kind` at `addr` whose condition holds
+    std::optional<BreakEvent> match(C64 &c64, BreakKind kind, uint16_t addr, uint8_t value) const;
+
+private:
+    struct Point {
+        int id;
+        uint16_t first;
+        uint16_t last;
+        uint8_t kinds; // one bit per BreakKind
+        BreakCondition condition;
+    };
+
+    std::vector<Point> points;
+    int next_id = 1;
+
+    uint8_t exec_bits[0x10000 / 8] = {};
+    uint8_t read_bits[0x10000 / 8] = {};
+    uint8_t write_bits[0x10000 / 8] = {};
+    bool watched_pages[0x100] = {};
+
+    static bool test(uint8_t const *bits, uint16_t addr) { return (bits[addr >> 3] >> (addr & 7)) & 1u; }
+
+    void rebuild();
+};
+
+#endif //C64_BREAKPOINTS_HPP
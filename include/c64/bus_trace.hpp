@@ -0,0 +1,102 @@
+#ifndef C64_BUS_TRACE_HPP
+#define C64_BUS_TRACE_HPP
+
+#include "ring_buffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+enum class BusRegion : uint8_t {
+    CPUPort,
+    VIC,
+    SID,
+    ColorRAM,
+    CIA1,
+    CIA2,
+    IO1,
+    IO2,
+    Other
+};
+
+struct BusTraceRecord {
+    uint64_t cycle;
+    uint16_t addr;
+    uint8_t value;
+    bool write;
+    BusRegion region;
+};
+
+BusRegion bus_region(uint16_t addr);
+
+const char *bus_region_name(BusRegion region);
+
+/// Collects bus accesses from the emulation thread into a ring buffer and hands
+/// them to a consumer on a background thread, so that the emulation never
+/// waits for formatting or I/O. When the ring is full records are dropped and
+/// counted rather than stalling the emulation.
+///
+/// C64 only reports to a tracer when built with C64_BUS_TRACE, otherwise the
+/// calls are compiled out and set_tracer() has no effect.
+class BusTracer {
+public:
+    using Consumer = std::function<void(BusTraceRecord const &)>;
+
+    /// Prints one line per record to `out`
+    explicit BusTracer(FILE *out = stdout, size_t capacity = 1 << 16);
+
+    explicit BusTracer(Consumer consumer, size_t capacity = 1 << 16);
+
+    /// Drains whatever is left before returning
+    ~BusTracer();
+
+    BusTracer(BusTracer const &) = delete;
+
+    BusTracer &operator=(BusTracer const &) = delete;
+
+    void record(uint64_t cycle, uint16_t addr, uint8_t value, bool write) {
+        if (!ring.push({cycle, addr, value, write, bus_region(addr)})) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] uint64_t dropped_records() const { return dropped.load(std::memory_order_relaxed); }
+
+    static void print_record(FILE *out, BusTraceRecord const &record);
+
+private:
+    RingBuffer<BusTraceRecord> ring;
+    Consumer consumer;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<bool> running = true;
+    std::thread drain_thread;
+
+    size_t drain();
+};
+
+inline BusRegion bus_region(uint16_t addr) {
+    if (addr <= 0x0001) {
+        return BusRegion::CPUPort;
+    } else if (addr < 0xD000) {
+        return BusRegion::Other;
+    } else if (addr <= 0xD3FF) {
+        return BusRegion::VIC;
+    } else if (addr <= 0xD7FF) {
+        return BusRegion::SID;
+    } else if (addr <= 0xDBFF) {
+        return BusRegion::ColorRAM;
+    } else if (addr <= 0xDCFF) {
+        return BusRegion::CIA1;
+    } else if (addr <= 0xDDFF) {
+        return BusRegion::CIA2;
+    } else if (addr <= 0xDEFF) {
+        return BusRegion::IO1;
+    } else if (addr <= 0xDFFF) {
+        return BusRegion::IO2;
+    }
+    return BusRegion::Other;
+}
+
+#endif //C64_BUS_TRACE_HPP
@@ -2,35 +2,355 @@
 #define NES_C64_HPP
 
 
+#include "breakpoints.hpp"
+#include "cia.hpp"
 #include "cpu_6502.hpp"
+#include "instruction_trace.hpp"
+#include "profiler.hpp"
+#include "scheduler.hpp"
+#include "sid.hpp"
+#include "text_screen.hpp"
+#include "vic_ii.hpp"
 
-class C64 : public CPUIO {
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bus_trace.hpp"
+
+/// What the CPU sees in a 256 byte page for a given LORAM/HIRAM/CHAREN setting
+enum class MemoryRegion : uint8_t {
+    RAM,
+    BASIC,
+    CHAR,
+    KERNAL,
+    IO
+};
+
+struct StateHeader;
+struct DeviceState;
+
+/// The BASIC, KERNAL and character ROMs, page aligned. Instances share one
+/// immutable set and only copy it when a ROM is patched.
+struct RomSet {
+    alignas(0x1000) uint8_t basic[0x2000];
+    alignas(0x1000) uint8_t kernal[0x2000];
+    alignas(0x1000) uint8_t chars[0x1000];
+
+    /// The stock ROMs, created on first use and shared by every instance
+    static std::shared_ptr<const RomSet> stock();
+};
+
+/// A 256 byte page of RAM frozen by C64::fork() and shared between instances
+struct RamPage {
+    uint8_t data[0x100];
+};
+
+class C64 final : public CPUIO {
 private:
-    CPU6502 cpu;
+    CPU6502T<C64> cpu;
     uint8_t ram[0x10000];
-    uint8_t basic_rom[0x2000];
-    uint8_t char_rom[0x1000];
-    uint8_t kernal_rom[0x2000];
+
+    // Pages of RAM shared with forked instances, null when `ram` holds the
+    // page. Shared pages are read in place and copied into `ram` on write.
+    std::shared_ptr<const RamPage> shared_pages[0x100];
+
+    std::shared_ptr<const RomSet> roms;
+    RomSet *patched_roms = nullptr; // set once this instance has its own copy
 
     uint64_t system_clock = 0;
     Interrupt interrupt_state = Interrupt::None;
 
+    // Run behind the CPU and are brought up to its clock on access, see VicII
+    VicII vic;
+    Cia cia1; // keyboard, joysticks and the IRQ line
+    Cia cia2; // VIC-II bank and the NMI line
+    bool nmi_line = false; // CIA 2's interrupt output, NMI is taken on its edge
+    Sid sid; // raises no interrupts, only brought up on access and for its audio
+
+    // The next interrupt of each chip. Chips are only brought up to the CPU
+    // when theirs is due, when they are accessed and when the state is saved.
+    Scheduler scheduler;
+
+    // One pointer per page for the current bank configuration. A null entry
+    // means the page is I/O (or the CPU port) and is handled by read_io/write_io.
+    const uint8_t *read_map[0x100];
+    uint8_t *write_map[0x100];
+    uint8_t bank_config = 0xFF;
+
+    // Only reported to when built with C64_BUS_TRACE, the member is there
+    // either way so that the layout does not depend on the flag
+    BusTracer *tracer = nullptr;
+
+    // Null unless a breakpoint or watchpoint is set. Watched pages are left
+    // out of the page tables so that only their accesses take the slow path.
+    std::unique_ptr<Breakpoints> breakpoints;
+    std::optional<BreakEvent> break_event;
+    int resume_pc = -1; // the breakpoint last stopped at, passed once when resuming
+
+    std::unique_ptr<Profiler> profiler;
+    InstructionTracer *instruction_tracer = nullptr;
+
+    // Null until render_text_screen() is first called. Its screen RAM pages
+    // are left out of the write map so that every write to them is seen.
+    std::unique_ptr<TextScreen> text_screen;
+
+    void update_memory_map();
+
+    void remap_breakpoints();
+
+    void watch(BreakKind kind, uint16_t addr, uint8_t value);
+
+    void map_page(uint8_t page);
+
+    void own_page(uint8_t page);
+
+    [[nodiscard]] const uint8_t *ram_page(uint8_t page) const;
+
+    uint8_t read_io(uint16_t addr, bool read_only);
+
+    void write_io(uint16_t addr, uint8_t value);
+
+    /// The clock of the bus access in progress, native code included
+    [[nodiscard]] uint64_t bus_clock() const { return cpu.clock_count + cpu.cycles; }
+
+    /// The VIC-II's 16 KB bank, 0-3, selected by CIA 2 port A
+    [[nodiscard]] uint8_t vic_bank() const;
+
+    /// What the VIC-II sees
+    [[nodiscard]] VicMemory vic_memory() const;
+
+    void update_vic(uint64_t now);
+
+    /// Whether a device holds the IRQ line low
+    [[nodiscard]] bool irq_line() const { return vic.irq() || cia1.irq(); }
+
+    /// Queues the next interrupt of `device`, which has to be up to date
+    void post(Device device);
+
+    void post_all();
+
+    /// Reposts `device` after a write to it at `now` and ends the CPU's run
+    /// early if that moved an interrupt closer
+    void posted(Device device, uint64_t now);
+
+    /// Brings the devices whose events are due by `now` up to it
+    void run_events(uint64_t now);
+
+    /// Runs the events due and takes a pending interrupt
+    void between_instructions();
+
+    void service_interrupt();
+
+    struct ForkTag {};
+
+    /// For fork(), leaves RAM uninitialized as the child shares every page
+    C64(std::shared_ptr<const RomSet> roms, ForkTag);
+
+    [[nodiscard]] StateHeader state_header() const;
+
+    void apply_state_header(StateHeader const &header);
+
+    [[nodiscard]] DeviceState device_state() const;
+
+    void apply_device_state(DeviceState const &devices);
+
 public:
     C64();
 
+    explicit C64(std::shared_ptr<const RomSet> roms);
+
+    C64(C64 const &) = delete;
+
+    C64 &operator=(C64 const &) = delete;
+
+    /// Returns a copy of the running machine. RAM is shared page by page with
+    /// this instance and copied on the first write by either side, so a fork
+    /// costs the pages written since the previous one. The tracers,
+    /// breakpoints and profiler are not copied, and neither are the VIC-II's
+    /// frame (the child's is black up to the beam) and the audio.
+    [[nodiscard]] std::unique_ptr<C64> fork();
+
     void write(uint16_t addr, uint8_t value) override;
 
     uint8_t read(uint16_t addr, bool read_only) override;
 
+    uint8_t read(uint16_t addr) { return read(addr, false); }
+
     void reset();
 
     bool clock();
 
+    /// Runs one whole instruction, see CPU6502::step_instruction
+    uint32_t step_instruction();
+
+    /// Runs whole instructions until exactly `budget` system cycles have passed.
+    /// Interrupts are taken on instruction boundaries. Stops early, before the
+    /// next instruction, at a breakpoint or after a watchpoint fired, see
+    /// last_break().
+    ///
+    /// The CPU runs uninterrupted up to the next VIC-II or CIA interrupt, or
+    /// up to the CLI, PLP or RTI that lets an interrupt held off by the I
+    /// flag through.
+    uint64_t run_for_cycles(uint64_t budget);
+
+    /// Runs until the instruction at `addr` is up next (at least one
+    /// instruction runs first), or for `max_cycles`, or up to a breakpoint.
+    /// Returns the cycles that passed, check the PC to tell which one it was.
+    uint64_t run_until_pc(uint16_t addr, uint64_t max_cycles);
+
+    /// Runs for `frames` PAL frames, see cycles_per_frame
+    uint64_t run_frames(uint64_t frames);
+
+    /// System cycles in a PAL frame, 312 raster lines of 63 cycles each
+    static constexpr uint64_t cycles_per_frame = 312 * 63;
+
     void interrupt(Interrupt interrupt) override;
 
-    [[nodiscard]] CPU6502 const& get_cpu() const;
+    [[nodiscard]] CPU6502Base const& get_cpu() const;
+
+    /// The VIC-II with the beam brought up to the CPU, for its frame
+    VicII const &get_vic();
+
+    /// Presses or releases the key where keyboard matrix `column` (CIA 1 port
+    /// A bit) and `row` (port B bit) cross, both 0-7. The KERNAL picks it up
+    /// on its next keyboard scan.
+    void set_key(uint8_t column, uint8_t row, bool pressed);
+
+    /// Holds joystick `port` (1 or 2) lines low: bit 0 up, 1 down, 2 left,
+    /// 3 right, 4 fire
+    void set_joystick(int port, uint8_t lines);
+
+    /// Starts rendering the SID's audio at `sample_rate` samples per second,
+    /// to be collected with take_audio()
+    void enable_audio(uint32_t sample_rate = 44100);
+
+    void disable_audio();
+
+    /// The mono 16 bit samples rendered up to the CPU's clock since the last
+    /// call, empty unless audio is enabled
+    [[nodiscard]] std::vector<int16_t> take_audio();
+
+    /// 0 unless audio is enabled
+    [[nodiscard]] uint32_t audio_sample_rate() const { return sid.sample_rate(); }
+
+    /// The text screen with the cells written since the last call drawn
+    /// again. The first call starts tracking writes and draws every cell.
+    TextScreen const &render_text_screen();
+
+    /// Stops tracking the text screen
+    void disable_text_screen();
+
+    /// Selects the CPU's dispatch backend, e.g. Dispatch::Cached
+    void set_dispatch(Dispatch dispatch);
+
+    /// The LORAM/HIRAM/CHAREN setting, keys the CPU's block cache
+    [[nodiscard]] uint8_t code_bank() const { return bank_config; }
+
+    /// Stops runs before the instruction at `addr`, if `condition` (when
+    /// given) holds. A run resumed at a breakpoint passes it. Returns an id for
+    /// remove_breakpoint().
+    int add_breakpoint(uint16_t addr, BreakCondition condition = {});
+
+    /// Stops runs after the instruction that reads or writes (see `access`)
+    /// an address from `first` to `last`, if `condition` holds. Accesses made
+    /// through read(addr, true), read_ram() and friends are not watched.
+    int add_watchpoint(uint16_t first, uint16_t last, Access access, BreakCondition condition = {});
+
+    /// Removes a breakpoint or watchpoint, returns false for an unknown id
+    bool remove_breakpoint(int id);
+
+    void clear_breakpoints();
+
+    /// What stopped the last run (or step) early, if anything did
+    [[nodiscard]] std::optional<BreakEvent> const &last_break() const;
+
+    /// Counts instructions and cycles per PC from now on, and calls with
+    /// `call_graph`. Replaces the profiler running before.
+    Profiler &enable_profiler(bool call_graph = false);
+
+    void disable_profiler();
+
+    /// Null unless enabled
+    [[nodiscard]] Profiler const *get_profiler() const;
+
+    /// Records every instruction to `tracer` from now on (or stops when null).
+    /// The tracer must outlive this instance or be detached.
+    void set_instruction_tracer(InstructionTracer *tracer);
+
+    /// Whether breakpoints are set, the profiler runs or instructions are
+    /// traced, the CPU only calls stop_before() and executed() then
+    [[nodiscard]] bool debugging() const {
+        return breakpoints != nullptr || profiler != nullptr || instruction_tracer != nullptr;
+    }
+
+    /// Asked by the CPU before each instruction while debugging()
+    bool stop_before(uint16_t pc);
+
+    /// Told by the CPU after each instruction while debugging()
+    void executed(uint16_t pc, uint8_t cycles) {
+        if (profiler != nullptr) {
+            profiler->record(pc, cpu.opcode, cycles, cpu.pc);
+        }
+    }
+
+    [[nodiscard]] std::shared_ptr<const RomSet> const &rom_set() const;
+
+    /// Changes the ROM byte mapped at `addr` ($A000-$BFFF, $D000-$DFFF or
+    /// $E000-$FFFF). The first patch gives this instance its own ROM copy.
+    void patch_rom(uint16_t addr, uint8_t value);
+
+    /// Serializes the CPU registers, the interrupt line, the VIC-II, CIA and SID
+    /// registers and all 64 KB of RAM (which includes the CPU port) into one blob in
+    /// native byte order. ROMs, the frame and the audio are not part of the state.
+    [[nodiscard]] std::vector<uint8_t> save_state() const;
+
+    /// Like save_state() but only keeps the 256 byte pages of RAM that differ
+    /// from `base`, which must be a full snapshot.
+    [[nodiscard]] std::vector<uint8_t> save_state(std::vector<uint8_t> const &base) const;
+
+    /// Restores a full snapshot made by save_state()
+    void load_state(std::vector<uint8_t> const &state);
+
+    /// Restores a delta snapshot on top of the full snapshot it was made
+    /// against. Throws for any other base, which is told by its clock and a
+    /// checksum of its RAM.
+    void load_state(std::vector<uint8_t> const &state, std::vector<uint8_t> const &base);
+
+    /// Copies RAM (ignoring the bank configuration) to `out`
+    void read_ram(uint16_t addr, uint8_t *out, size_t size) const;
+
+    /// Copies `data` into RAM (ignoring the bank configuration)
+    void write_ram(uint16_t addr, uint8_t const *data, size_t size);
+
+    /// All 64 KB of RAM in one piece, to be read and written in place. Gives
+    /// this instance its own copy of every shared page, after a fork() the
+    /// pointer has to be fetched again. Writes through it neither switch banks
+    /// (the CPU port at $0001) nor drop code cached by the CPU until
+    /// ram_written() is called.
+    [[nodiscard]] uint8_t *ram_data();
+
+    /// Catches up with writes made through ram_data(): drops the code cached
+    /// by the CPU, draws the text screen in full and follows the CPU port.
+    void ram_written();
+
+    /// Loads a PRG file (load address followed by the data) into RAM the way
+    /// LOAD does and returns the load address. A program loaded to the start of
+    /// BASIC gets the BASIC pointers set so that it can be RUN.
+    uint16_t load_prg(std::vector<uint8_t> const &prg);
+
+    /// Puts text in the keyboard buffer as if it was typed, newlines become
+    /// RETURN. The buffer holds 10 keys, returns how many were queued.
+    size_t type(std::string const &text);
 
+    /// Reports accesses to the CPU port and I/O area to `bus_tracer` (or stops
+    /// when null). The tracer must outlive this instance or be detached. A
+    /// build without C64_BUS_TRACE keeps the tracer but reports nothing.
+    void set_tracer(BusTracer *bus_tracer);
 
+    /// The region mapped at `addr` for the LORAM/HIRAM/CHAREN bits in `config`
+    static MemoryRegion memory_region(uint8_t config, uint16_t addr);
 };
 
 #endif //NES_C64_HPP
@@ -0,0 +1,144 @@
+#ifndef C64_CIA_HPP
+#define C64_CIA_HPP
+
+#include <cstdint>
+
+/// A MOS 6526 CIA: two 8 bit ports, timers A and B, the time of day clock
+/// and the interrupt control register. Like VicII it runs behind the CPU and
+/// is brought up to its clock with run_until(), which works out timer
+/// underflows from the cycles that passed instead of counting them down one
+/// by one. next_irq() tells when the next enabled interrupt is due.
+///
+/// CNT is held high, so timers counting CNT edges stand still, and the
+/// serial port only keeps its register. The ports see the C64 keyboard
+/// matrix (columns on port A, rows on port B) and the joysticks, which only
+/// matters for CIA 1.
+class Cia {
+public:
+    /// PAL φ2, the TOD clock takes 50 Hz from it
+    static constexpr uint64_t clock_rate = 985248;
+
+    /// Moves the chip up to `now`, timers and the TOD alarm raise their flags
+    void run_until(uint64_t now);
+
+    /// The clock at which an enabled source next raises the interrupt line,
+    /// UINT64_MAX if none will. Only valid right after run_until().
+    [[nodiscard]] uint64_t next_irq() const;
+
+    /// Whether the interrupt line is held low
+    [[nodiscard]] bool irq() const { return (flags & mask) != 0; }
+
+    /// `reg` is the address within the chip, which repeats every 16 bytes.
+    /// Reading the ICR acknowledges it unless `read_only`.
+    uint8_t read(uint8_t reg, uint64_t now, bool read_only);
+
+    void write(uint8_t reg, uint8_t value, uint64_t now);
+
+    /// The levels of the port A pins the chip drives, inputs read high
+    [[nodiscard]] uint8_t port_a_out() const { return pra | ~ddra; }
+
+    /// Presses or releases the key where `column` (port A bit) and `row`
+    /// (port B bit) cross, both 0-7
+    void set_key(uint8_t column, uint8_t row, bool pressed);
+
+    /// Lines held low by the joystick on port A (joystick 2 on CIA 1): bit 0
+    /// up, 1 down, 2 left, 3 right, 4 fire
+    void set_joystick_a(uint8_t lines) { joystick_a = lines & 0x1F; }
+
+    /// Like set_joystick_a() for port B (joystick 1 on CIA 1)
+    void set_joystick_b(uint8_t lines) { joystick_b = lines & 0x1F; }
+
+    struct State {
+        uint64_t clock;
+        uint64_t tod_clock;
+        uint32_t tod_base;
+        uint32_t alarm;
+        uint32_t tod_latch;
+        uint16_t latch_a;
+        uint16_t counter_a;
+        uint16_t latch_b;
+        uint16_t counter_b;
+        uint8_t control_a;
+        uint8_t control_b;
+        uint8_t pra;
+        uint8_t prb;
+        uint8_t ddra;
+        uint8_t ddrb;
+        uint8_t flags;
+        uint8_t mask;
+        uint8_t sdr;
+        uint8_t tod_running;
+        uint8_t tod_latched;
+        uint8_t joystick_a;
+        uint8_t joystick_b;
+        uint8_t keys[8];
+        uint8_t padding[7];
+    };
+
+    /// The state as of `now`, which may be ahead of the chip
+    [[nodiscard]] State save_state(uint64_t now) const;
+
+    void load_state(State const &state);
+
+private:
+    struct Timer {
+        uint16_t latch = 0xFFFF;
+        uint16_t counter = 0xFFFF;
+        uint8_t control = 0x00;
+
+        [[nodiscard]] bool running() const { return (control & 0x01) != 0; }
+
+        [[nodiscard]] bool one_shot() const { return (control & 0x08) != 0; }
+
+        /// Counts down `ticks` times and returns how often it underflowed
+        uint64_t count(uint64_t ticks);
+    };
+
+    uint64_t clock = 0;
+    uint8_t pra = 0x00;
+    uint8_t prb = 0x00;
+    uint8_t ddra = 0x00;
+    uint8_t ddrb = 0x00;
+    Timer timer_a;
+    Timer timer_b;
+    uint8_t flags = 0x00; // ICR bits 0-4
+    uint8_t mask = 0x00;
+    uint8_t sdr = 0x00;
+
+    // The time of day in tenths of a second since midnight: `tod_base` at
+    // `tod_clock`, counting on from there while it runs
+    uint32_t tod_base = 36000;
+    uint64_t tod_clock = 0;
+    bool tod_running = true;
+    uint32_t alarm = 0;
+    bool tod_latched = false; // reading the hours holds all four registers
+    uint32_t tod_latch = 0;
+
+    uint8_t keys[8] = {}; // rows pressed per column
+    uint8_t joystick_a = 0x00;
+    uint8_t joystick_b = 0x00;
+
+    [[nodiscard]] uint8_t port_a_in() const;
+
+    [[nodiscard]] uint8_t port_b_in() const;
+
+    /// Timer B counts timer A underflows rather than cycles
+    [[nodiscard]] bool b_counts_a() const { return (timer_b.control & 0x40) != 0; }
+
+    /// 50 Hz ticks per tenth of a second, set by TODIN
+    [[nodiscard]] uint64_t tod_divider() const { return (timer_a.control & 0x80) ? 5 : 6; }
+
+    [[nodiscard]] uint32_t time_of_day(uint64_t now) const;
+
+    /// Stops or restarts the TOD clock at `now`, keeping its time
+    void set_time_of_day(uint32_t tenths, uint64_t now, bool running);
+
+    /// The first clock after `after` at which the time of day equals the alarm
+    [[nodiscard]] uint64_t alarm_after(uint64_t after) const;
+
+    uint8_t read_tod(uint8_t reg, uint32_t tenths) const;
+
+    static uint32_t write_tod(uint8_t reg, uint8_t value, uint32_t tenths);
+};
+
+#endif //C64_CIA_HPP
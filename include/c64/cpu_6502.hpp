@@ -1,7 +1,10 @@
 #ifndef NES_CPU_6502_HPP
 #define NES_CPU_6502_HPP
 
+#include "jit_x64.hpp"
+
 #include <cstdint>
+#include <memory>
 #include <string>
 
 enum Interrupt {
@@ -32,7 +35,44 @@ enum Flags6502 : uint8_t {
     N = 0x80, // Negative
 };
 
-bool is_flag_set(uint8_t flag, uint8_t flags);
+inline bool is_flag_set(uint8_t flag, uint8_t flags);
+
+/// The processor status register. Instructions only record what N, Z, C and V
+/// follow from, the flags are worked out when a branch tests one or the whole
+/// register is read (PHP, BRK, interrupts, tools). Reads and writes look like
+/// those of a plain uint8_t.
+struct StatusRegister {
+    uint8_t n = 0x00;     // N is bit 7
+    uint8_t z = 0x01;     // Z is set when this is 0
+    uint8_t c = 0x00;     // C is bit 0
+    uint8_t v = 0x00;     // V is bit 7
+    uint8_t other = 0x00; // I, D, B and U, in place
+
+    StatusRegister &operator=(uint8_t value);
+
+    operator uint8_t() const;
+
+    [[nodiscard]] bool is_set(Flags6502 flag) const;
+
+    /// N and Z as they follow from the result `value`
+    void set_nz(uint8_t value) {
+        n = value;
+        z = value;
+    }
+};
+
+/// How run_instruction gets from an opcode to its implementation
+enum class Dispatch : uint8_t {
+    Switch,   // one big switch statement
+    Table,    // table of function pointers, one per opcode
+    Threaded, // computed goto from handler to handler (GCC/Clang), falls back to Switch elsewhere
+    Cached,   // basic blocks decoded once and replayed, see CPU6502T::CodeCache
+    Jit       // Cached, plus hot blocks compiled to x86-64 for run_for_cycles
+};
+
+enum class AddressMode : uint8_t {
+    IMP, IMM, ZP0, ZPX, ZPY, REL, ABS, ABX, ABY, IND, IZX, IZY
+};
 
 struct InstructionInfo {
     const char * instruction;
@@ -40,14 +80,16 @@ struct InstructionInfo {
     bool non_standard;
 };
 
-class CPU6502 {
+/// Registers and bookkeeping shared by every CPU6502T instantiation. Tools
+/// and bindings that only inspect the CPU take this type.
+class CPU6502Base {
 public:
     uint8_t a = 0x00;
     uint8_t x = 0x00;
     uint8_t y = 0x00;
     uint8_t stkp = 0x00;
     uint16_t pc = 0x0000;
-    uint8_t status = 0x00;
+    StatusRegister status;
 
     uint16_t addr_abs = 0x0000;
     uint8_t addr_rel = 0x00;
@@ -55,20 +97,19 @@ public:
 
     uint8_t opcode = 0x00;
     uint64_t clock_count = 0;
+    /// Instructions started by any backend, interrupts do not count
+    uint64_t instruction_count = 0;
     uint8_t implied = 0x00;
     bool implied_has_value = false;
 
-    CPU6502();
-
-    virtual ~CPU6502();
+    Dispatch dispatch = Dispatch::Table;
 
-    void clock(CPUIO &bus);
+    /// How often a block runs before Dispatch::Jit compiles it
+    uint16_t jit_threshold = 32;
 
-    void reset(CPUIO &bus);
+    CPU6502Base();
 
-    void irq(CPUIO &bus);
-
-    void nmi(CPUIO &bus);
+    virtual ~CPU6502Base();
 
     [[nodiscard]] bool complete() const;
 
@@ -77,27 +118,180 @@ public:
     [[nodiscard]] bool is_status_flag_set(Flags6502 flag) const;
 
     [[nodiscard]] virtual InstructionInfo instruction_info(uint8_t opcode) const;
+};
+
+/// The 6502 core, compiled against a concrete bus type so that reads and
+/// writes can be inlined. CPU6502 is the instantiation for the virtual CPUIO
+/// interface, the definitions are in cpu_6502_impl.hpp.
+template<typename Bus>
+class CPU6502T : public CPU6502Base {
+public:
+    void clock(Bus &bus);
+
+    /// Finishes the cycles of the current instruction and runs the next one
+    /// in full. Returns the number of cycles that passed.
+    uint32_t step_instruction(Bus &bus);
+
+    /// Runs whole instructions until exactly `budget` cycles have passed. The
+    /// last instruction may be left with cycles pending, just as with clock().
+    /// A bus with breakpoints can stop it early, see DebuggableBus, and so
+    /// can end_run_at().
+    uint64_t run_for_cycles(Bus &bus, uint64_t budget);
+
+    /// Ends the run_for_cycles in progress once the clock reaches `clock` (but
+    /// not before the current instruction is done) instead of at the end of
+    /// its budget. For buses whose devices just scheduled something sooner.
+    void end_run_at(uint64_t clock);
+
+    /// Tells the CPU that an IRQ is waiting for the I flag. While it does,
+    /// the run in progress ends after the instruction that clears the flag
+    /// (CLI, PLP or RTI) so that the bus can take the interrupt.
+    void hold_irq(bool held) { irq_held = held; }
+
+    void reset(Bus &bus);
+
+    void irq(Bus &bus);
+
+    void nmi(Bus &bus);
+
+    /// Drops cached code in the page of `addr`. Writes made by the CPU drop
+    /// the code they hit on their own, anything changing memory behind its
+    /// back has to call this.
+    void invalidate_code(uint16_t addr);
+
+    /// Drops all cached code
+    void flush_code_cache();
 
 protected:
-    virtual uint8_t run_instruction(CPUIO &bus);
+    using InstructionFn = uint8_t (*)(CPU6502T &cpu, Bus &bus);
 
-    uint8_t fetch(CPUIO &bus);
+    using DecodedFn = uint8_t (*)(CPU6502T &cpu, Bus &bus, uint16_t operand);
 
-    void set_status_flag(Flags6502 flag, bool value);
+    static constexpr int max_block_length = 16;
+
+    static constexpr int code_cache_blocks = 1024;
+
+    struct CodeBlock;
+
+    /// A compiled block, returns how many of its instructions it ran
+    using NativeFn = uint32_t (*)(CPU6502T *cpu, Bus *bus, CodeBlock **current);
 
-    void push_value_on_stack(CPUIO &bus, uint8_t value);
+    struct DecodedInstruction {
+        DecodedFn handler;
+        uint16_t operand;
+        uint8_t opcode;
+        uint8_t cycles; // the base count, page crossings and branches add to it
+    };
+
+    /// Straight-line code from `start` up to and including the first jump,
+    /// branch or return. A block never leaves its page.
+    struct CodeBlock {
+        uint16_t start = 0;
+        uint16_t last = 0; // its last byte
+        uint8_t bank = 0;
+        uint8_t count = 0; // empty slot when 0
+        uint32_t generation = 0;      // of the chunk holding `start`
+        uint32_t last_generation = 0; // of the chunk holding `last`
+        uint16_t hits = 0;
+        uint8_t max_cycles = 0; // with every page crossing and branch taken
+        NativeFn native = nullptr;
+        DecodedInstruction instructions[max_block_length];
+    };
+
+    /// Code is dropped in chunks of 64 bytes, so that self-modifying code
+    /// only costs the blocks around the byte it changes
+    static constexpr int chunk_shift = 6;
+
+    /// Direct mapped cache of blocks keyed by PC and the bus' code bank (see
+    /// code_bank). Blocks are stale once the generation of a chunk they are in
+    /// moves on, which writes to bytes of decoded code make it do.
+    struct CodeCache {
+        uint32_t generation[0x10000 >> chunk_shift] = {};
+        uint8_t code_bytes[0x10000 / 8] = {}; // one bit per byte of decoded code
+        CodeBlock blocks[code_cache_blocks];
+        CodeBlock *block = nullptr; // the block being run
+        uint8_t index = 0;          // its next instruction
+        uint16_t next_pc = 0;
+        std::unique_ptr<JitBuffer> jit;
+    };
+
+    std::unique_ptr<CodeCache> code_cache;
+
+    uint64_t run_end = 0; // the clock the run in progress stops at
+    bool irq_held = false;
+
+    /// Ends the run after this instruction if it let a held IRQ through
+    void release_irq() {
+        if (irq_held && !is_status_flag_set(Flags6502::I)) {
+            end_run_at(clock_count);
+        }
+    }
+
+    template<bool Debugging>
+    uint64_t run_instructions(Bus &bus, uint64_t budget);
+
+    void begin_instruction(Bus &bus);
+
+    virtual uint8_t run_instruction(Bus &bus);
+
+    uint8_t run_switch(Bus &bus);
+
+    uint8_t run_table(Bus &bus);
+
+    /// Runs the instruction in `opcode`, and with `chain` the ones after it
+    /// up to the end of the run without returning in between
+    void run_threaded(Bus &bus, bool chain);
+
+    /// Books the cycles of the instruction just run and fetches the next
+    /// opcode, false once the run is over
+    bool next_threaded(Bus &bus);
+
+    uint8_t run_cached(Bus &bus);
+
+    /// Drops cached code in the chunk of `addr`, see chunk_shift
+    void invalidate_chunk(uint16_t addr);
+
+    /// Runs the current block, or the one at the PC, up to its end or the
+    /// end of the run, and books the cycles as it goes
+    void run_block(Bus &bus);
+
+    CodeBlock *enter_block(Bus &bus, uint8_t bank);
+
+    uint32_t run_native(Bus &bus, uint64_t budget);
+
+    void compile_block(CodeBlock &block);
+
+    /// Drops all native code and carries on with Dispatch::Cached, for when
+    /// executable memory cannot be had
+    void abandon_jit();
+
+    void decode_block(Bus &bus, CodeBlock &block, uint16_t start, uint8_t bank);
+
+    static uint8_t code_bank(Bus &bus);
+
+    template<uint8_t (CPU6502T::*Mode)(Bus &), uint8_t (CPU6502T::*Operate)(Bus &), uint8_t Cycles>
+    static uint8_t execute(CPU6502T &cpu, Bus &bus);
+
+    template<AddressMode Mode, uint8_t (CPU6502T::*Operate)(Bus &), uint8_t Cycles>
+    static uint8_t execute_decoded(CPU6502T &cpu, Bus &bus, uint16_t operand);
+
+    uint8_t fetch(Bus &bus);
+
+    void write(Bus &bus, uint16_t addr, uint8_t value);
+
+    void set_status_flag(Flags6502 flag, bool value);
 
-    uint8_t pop_value_from_stack(CPUIO &bus);
+    void push_value_on_stack(Bus &bus, uint8_t value);
 
-    void push_interrupt_state_on_stack(CPUIO & bus);
+    uint8_t pop_value_from_stack(Bus &bus);
 
-    void push_program_counter_on_stack(CPUIO &bus);
+    void push_interrupt_state_on_stack(Bus &bus);
 
-    void pop_program_counter_from_stack(CPUIO &bus);
+    void push_program_counter_on_stack(Bus &bus);
 
-    void load_program_counter_from_addr(CPUIO &bus, uint16_t addr);
+    void pop_program_counter_from_stack(Bus &bus);
 
-    bool is_negative(uint8_t);
+    void load_program_counter_from_addr(Bus &bus, uint16_t addr);
 
     void add(uint8_t m);
 
@@ -108,251 +302,297 @@ protected:
 
     // *** --- Addressing Modes --- ***
     /// Implied -> the fetched value is the _a_ register
-    uint8_t IMP(CPUIO &bus);
+    uint8_t IMP(Bus &bus);
 
     /// Immediate -> the value pointed to by the program counter
-    uint8_t IMM(CPUIO &bus);
+    uint8_t IMM(Bus &bus);
 
     /// Zero Page 0 -> The address is in the range $0000-$00FF
-    uint8_t ZP0(CPUIO &bus);
+    uint8_t ZP0(Bus &bus);
 
     /// Zero Page + X -> An address is read from memory and _x_ is added.
     /// The final address is in the range $0000-$00FF (wrap around).
-    uint8_t ZPX(CPUIO &bus);
+    uint8_t ZPX(Bus &bus);
 
     /// Zero Page + Y -> An address is read from memory and _y_ is added.
     /// The final address is in the range $0000-$00FF (wrap around).
-    uint8_t ZPY(CPUIO &bus);
+    uint8_t ZPY(Bus &bus);
 
     /// Relative -> A value is read from memory and stored for branching jump operations.
-    uint8_t REL(CPUIO &bus);
+    uint8_t REL(Bus &bus);
 
     /// Absolute -> Two values are read from memory and used as an address.
-    uint8_t ABS(CPUIO &bus);
+    uint8_t ABS(Bus &bus);
 
     /// Absolute + x -> Two values are read from memory then _x_ is added
     /// and used as an address.
-    uint8_t ABX(CPUIO &bus);
+    uint8_t ABX(Bus &bus);
 
     /// Absolute + y -> Two values are read from memory then _y_ is added
     /// and used as an address.
-    uint8_t ABY(CPUIO &bus);
+    uint8_t ABY(Bus &bus);
 
     /// Indirect -> Two values are read from memory and used as an address to
     /// read the actual address.
-    virtual uint8_t IND(CPUIO &bus);
+    virtual uint8_t IND(Bus &bus);
 
     /// Indirect Zero Page + X -> A value is read from memory and _x_ is added, then
     /// the actual address is read from the zero page.
-    uint8_t IZX(CPUIO &bus);
+    uint8_t IZX(Bus &bus);
 
     /// Indirect Zero Page + Y -> A value is read from memory and the actual
     /// address is read from the zero page then _y_ is added.
-    uint8_t IZY(CPUIO &bus);
+    uint8_t IZY(Bus &bus);
 
 
     // *** --- Instructions --- ***
 
     /// Add with carry
-    uint8_t ADC(CPUIO &bus);
+    uint8_t ADC(Bus &bus);
 
     /// ANDs the contents of the A register with an immediate
     /// value and then moves bit 7 of A into the Carry flag
-    uint8_t ANC(CPUIO &bus);
+    uint8_t ANC(Bus &bus);
 
     /// AND (with accumulator)
-    uint8_t AND(CPUIO &bus);
+    uint8_t AND(Bus &bus);
 
     /// arithmetic shift left
-    uint8_t ASL(CPUIO &bus);
+    uint8_t ASL(Bus &bus);
 
     /// branch on carry clear
-    uint8_t BCC(CPUIO &bus);
+    uint8_t BCC(Bus &bus);
 
     /// branch on carry set
-    uint8_t BCS(CPUIO &bus);
+    uint8_t BCS(Bus &bus);
 
     /// branch on equal (zero set)
-    uint8_t BEQ(CPUIO &bus);
+    uint8_t BEQ(Bus &bus);
 
     /// bit test
-    uint8_t BIT(CPUIO &bus);
+    uint8_t BIT(Bus &bus);
 
     /// branch on minus (negative set)
-    uint8_t BMI(CPUIO &bus);
+    uint8_t BMI(Bus &bus);
 
     /// branch on not equal (zero clear)
-    uint8_t BNE(CPUIO &bus);
+    uint8_t BNE(Bus &bus);
 
     /// branch on plus (negative clear)
-    uint8_t BPL(CPUIO &bus);
+    uint8_t BPL(Bus &bus);
 
     /// break / interrupt
-    virtual uint8_t BRK(CPUIO &bus);
+    virtual uint8_t BRK(Bus &bus);
 
     /// branch on overflow clear
-    uint8_t BVC(CPUIO &bus);
+    uint8_t BVC(Bus &bus);
 
     /// branch on overflow set
-    uint8_t BVS(CPUIO &bus);
+    uint8_t BVS(Bus &bus);
 
     /// clear carry
-    uint8_t CLC(CPUIO &bus);
+    uint8_t CLC(Bus &bus);
 
     /// clear decimal
-    uint8_t CLD(CPUIO &bus);
+    uint8_t CLD(Bus &bus);
 
     /// clear interrupt disable
-    uint8_t CLI(CPUIO &bus);
+    uint8_t CLI(Bus &bus);
 
     /// clear overflow
-    uint8_t CLV(CPUIO &bus);
+    uint8_t CLV(Bus &bus);
 
     /// compare (with accumulator)
-    uint8_t CMP(CPUIO &bus);
+    uint8_t CMP(Bus &bus);
 
     /// compare with X
-    uint8_t CPX(CPUIO &bus);
+    uint8_t CPX(Bus &bus);
 
     /// compare with Y
-    uint8_t CPY(CPUIO &bus);
+    uint8_t CPY(Bus &bus);
 
     /// decrement and compare with Accumulator
-    uint8_t DCP(CPUIO &bus);
+    uint8_t DCP(Bus &bus);
 
     /// decrement
-    uint8_t DEC(CPUIO &bus);
+    uint8_t DEC(Bus &bus);
 
     /// decrement X
-    uint8_t DEX(CPUIO &bus);
+    uint8_t DEX(Bus &bus);
 
     /// decrement Y
-    uint8_t DEY(CPUIO &bus);
+    uint8_t DEY(Bus &bus);
 
     /// exclusive or (with accumulator)
-    uint8_t EOR(CPUIO &bus);
+    uint8_t EOR(Bus &bus);
 
     /// increment
-    uint8_t INC(CPUIO &bus);
+    uint8_t INC(Bus &bus);
 
     /// increment X
-    uint8_t INX(CPUIO &bus);
+    uint8_t INX(Bus &bus);
 
     /// increment Y
-    uint8_t INY(CPUIO &bus);
+    uint8_t INY(Bus &bus);
 
     /// Increment memory with one and then subtract memory from Accumulator
-    uint8_t ISB(CPUIO &bus);
+    uint8_t ISB(Bus &bus);
 
     /// jump
-    uint8_t JMP(CPUIO &bus);
+    uint8_t JMP(Bus &bus);
 
     /// jump subroutine
-    uint8_t JSR(CPUIO &bus);
+    uint8_t JSR(Bus &bus);
 
     /// * load accumulator and x with memory contents
-    uint8_t LAX(CPUIO &bus);
+    uint8_t LAX(Bus &bus);
 
     /// load accumulator
-    uint8_t LDA(CPUIO &bus);
+    uint8_t LDA(Bus &bus);
 
     /// Load X
-    uint8_t LDX(CPUIO &bus);
+    uint8_t LDX(Bus &bus);
 
     /// Load Y
-    uint8_t LDY(CPUIO &bus);
+    uint8_t LDY(Bus &bus);
 
     /// logical shift right
-    uint8_t LSR(CPUIO &bus);
+    uint8_t LSR(Bus &bus);
 
     /// no operation
-    uint8_t NOP(CPUIO &bus);
+    uint8_t NOP(Bus &bus);
 
     /// or with accumulator
-    uint8_t ORA(CPUIO &bus);
+    uint8_t ORA(Bus &bus);
 
     /// push accumulator
-    uint8_t PHA(CPUIO &bus);
+    uint8_t PHA(Bus &bus);
 
     /// push processor status (SR)
-    uint8_t PHP(CPUIO &bus);
+    uint8_t PHP(Bus &bus);
 
     /// pull accumulator
-    uint8_t PLA(CPUIO &bus);
+    uint8_t PLA(Bus &bus);
 
     /// pull processor status (SR)
-    uint8_t PLP(CPUIO &bus);
+    uint8_t PLP(Bus &bus);
 
     /// rotate memory left and then AND accumulator with memory
-    uint8_t RLA(CPUIO &bus);
+    uint8_t RLA(Bus &bus);
 
     /// rotate left
-    uint8_t ROL(CPUIO &bus);
+    uint8_t ROL(Bus &bus);
 
     /// rotate right
-    uint8_t ROR(CPUIO &bus);
+    uint8_t ROR(Bus &bus);
 
     /// Rotate memory one bit to the right and then add memory to accumulator
-    uint8_t RRA(CPUIO &bus);
+    uint8_t RRA(Bus &bus);
 
     /// return from interrupt
-    uint8_t RTI(CPUIO &bus);
+    uint8_t RTI(Bus &bus);
 
     /// return from subroutine
-    uint8_t RTS(CPUIO &bus);
+    uint8_t RTS(Bus &bus);
 
     /// AND X with Accumulator and store in memory
-    uint8_t SAX(CPUIO &bus);
+    uint8_t SAX(Bus &bus);
 
     /// Subtract with borrow
-    uint8_t SBC(CPUIO &bus);
+    uint8_t SBC(Bus &bus);
 
     /// Set Carry
-    uint8_t SEC(CPUIO &bus);
+    uint8_t SEC(Bus &bus);
 
     /// Set Decimal
-    uint8_t SED(CPUIO &bus);
+    uint8_t SED(Bus &bus);
 
     /// set interrupt disable
-    uint8_t SEI(CPUIO &bus);
+    uint8_t SEI(Bus &bus);
 
     /// Shift memory left and then OR accumulator with memory
-    uint8_t SLO(CPUIO &bus);
+    uint8_t SLO(Bus &bus);
 
     /// Shift memory one bit right then XOR with accumulator
-    uint8_t SRE(CPUIO &bus);
+    uint8_t SRE(Bus &bus);
 
     /// store accumulator
-    uint8_t STA(CPUIO &bus);
+    uint8_t STA(Bus &bus);
 
     /// store X
-    uint8_t STX(CPUIO &bus);
+    uint8_t STX(Bus &bus);
 
     /// store Y
-    uint8_t STY(CPUIO &bus);
+    uint8_t STY(Bus &bus);
 
     /// transfer accumulator to X
-    uint8_t TAX(CPUIO &bus);
+    uint8_t TAX(Bus &bus);
 
     /// transfer accumulator to Y
-    uint8_t TAY(CPUIO &bus);
+    uint8_t TAY(Bus &bus);
 
     /// transfer stack pointer to X
-    uint8_t TSX(CPUIO &bus);
+    uint8_t TSX(Bus &bus);
 
     /// transfer X to accumulator
-    uint8_t TXA(CPUIO &bus);
+    uint8_t TXA(Bus &bus);
 
     /// transfer X to stack pointer
-    uint8_t TXS(CPUIO &bus);
+    uint8_t TXS(Bus &bus);
 
     /// transfer Y to accumulator
-    uint8_t TYA(CPUIO &bus);
+    uint8_t TYA(Bus &bus);
 
     /// Undefined opcode
-    uint8_t XXX(CPUIO &bus);
+    uint8_t XXX(Bus &bus);
 
 };
 
+using CPU6502 = CPU6502T<CPUIO>;
+
+extern template class CPU6502T<CPUIO>;
+
+inline bool is_flag_set(uint8_t flag, uint8_t flags) {
+    return (flags & flag) == flag;
+}
+
+inline StatusRegister &StatusRegister::operator=(uint8_t value) {
+    n = value;
+    z = ~value & Flags6502::Z;
+    c = value & Flags6502::C;
+    v = value << 1;
+    other = value & (Flags6502::I | Flags6502::D | Flags6502::B | Flags6502::U);
+    return *this;
+}
+
+inline StatusRegister::operator uint8_t() const {
+    return other | (n & Flags6502::N) | (z == 0 ? Flags6502::Z : 0) | (c & Flags6502::C) | ((v >> 1) & Flags6502::V);
+}
+
+inline bool StatusRegister::is_set(Flags6502 flag) const {
+    switch (flag) {
+        case Flags6502::N: return n & 0x80;
+        case Flags6502::Z: return z == 0;
+        case Flags6502::C: return c & 0x01;
+        case Flags6502::V: return v & 0x80;
+        default: return other & flag;
+    }
+}
+
+inline bool CPU6502Base::complete() const {
+    return cycles == 0;
+}
+
+inline uint8_t CPU6502Base::get_flag(Flags6502 flag) const {
+    if (status.is_set(flag)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+inline bool CPU6502Base::is_status_flag_set(Flags6502 flag) const {
+    return status.is_set(flag);
+}
 
 #endif
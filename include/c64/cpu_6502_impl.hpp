@@ -0,0 +1,1607 @@
+#ifndef C64_CPU_6502_IMPL_HPP
+#define C64_CPU_6502_IMPL_HPP
+
+// Definitions of CPU6502T. Include this from the one translation unit that
+// instantiates the core for a bus type, e.g. `template class CPU6502T<C64>;`
+
+#include "cpu_6502.hpp"
+#include "opcodes.hpp"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+template<typename Bus>
+void CPU6502T<Bus>::reset(Bus &bus) {
+    uint16_t lo = bus.read(0xFFFC);
+    uint16_t hi = bus.read(0xFFFC + 1);
+    pc = (hi << 8) | lo;
+    a = 0x00;
+    x = 0x00;
+    y = 0x00;
+    stkp = 0xFD;
+    status = 0x00 | Flags6502::U | Flags6502::I;
+
+    addr_abs = 0x0000;
+    addr_rel = 0x00;
+    implied = 0x00;
+    implied_has_value = false;
+    cycles = 8;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::clock(Bus &bus) {
+    if (cycles == 0) {
+        begin_instruction(bus);
+    }
+    cycles -= 1;
+    clock_count++;
+}
+
+template<typename Bus>
+uint32_t CPU6502T<Bus>::step_instruction(Bus &bus) {
+    // the bus sees the clock of the instruction it runs
+    uint32_t elapsed = cycles;
+    clock_count += cycles;
+    cycles = 0;
+    begin_instruction(bus);
+    elapsed += cycles;
+
+    clock_count += cycles;
+    cycles = 0;
+    return elapsed;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::end_run_at(uint64_t clock) {
+    run_end = std::min(run_end, std::max(clock, clock_count));
+    if (code_cache) {
+        code_cache->block = nullptr; // native code stops after the instruction
+    }
+}
+
+/// A bus with breakpoints or a profiler, like C64. While `debugging()` holds
+/// the CPU asks `stop_before(pc)` ahead of every instruction of run_for_cycles
+/// and stops when it returns true, and reports the cycles of each instruction
+/// to `executed(pc, cycles)`. Other buses get a loop without either call.
+template<typename Bus>
+concept DebuggableBus = requires(Bus &bus, uint16_t pc, uint8_t cycles) {
+    { bus.debugging() } -> std::convertible_to<bool>;
+    { bus.stop_before(pc) } -> std::convertible_to<bool>;
+    bus.executed(pc, cycles);
+};
+
+template<typename Bus>
+uint64_t CPU6502T<Bus>::run_for_cycles(Bus &bus, uint64_t budget) {
+    if constexpr (DebuggableBus<Bus>) {
+        if (bus.debugging()) {
+            return run_instructions<true>(bus, budget);
+        }
+    }
+    return run_instructions<false>(bus, budget);
+}
+
+template<typename Bus>
+template<bool Debugging>
+uint64_t CPU6502T<Bus>::run_instructions(Bus &bus, uint64_t budget) {
+    uint64_t start_clock = clock_count;
+    run_end = clock_count + budget;
+    // the bus sees the clock of the instruction it is asked about
+    uint8_t pending = std::min<uint64_t>(cycles, budget);
+    cycles -= pending;
+    clock_count += pending;
+
+    while (clock_count < run_end) {
+        if constexpr (Debugging) {
+            if (bus.stop_before(pc)) {
+                break;
+            }
+        }
+        // native blocks run several instructions without asking the bus
+        if (!Debugging && dispatch == Dispatch::Jit) {
+            if (uint32_t used = run_native(bus, run_end - clock_count)) {
+                clock_count += used;
+                continue;
+            }
+        }
+        // a cached block runs on to its end, or to the end of the run
+        if (!Debugging && (dispatch == Dispatch::Cached || dispatch == Dispatch::Jit)) {
+            run_block(bus);
+            continue;
+        }
+        // threaded code runs on to the end of the run by itself
+        if (!Debugging && dispatch == Dispatch::Threaded) {
+            opcode = bus.read(pc);
+            pc++;
+            implied = 0x00;
+            implied_has_value = false;
+            instruction_count++;
+            run_threaded(bus, true);
+            continue;
+        }
+        [[maybe_unused]] uint16_t start = pc;
+        begin_instruction(bus);
+        if constexpr (Debugging) {
+            bus.executed(start, cycles);
+        }
+        uint8_t used = std::min<uint64_t>(cycles, run_end - clock_count);
+        cycles -= used;
+        clock_count += used;
+    }
+    return clock_count - start_clock;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::begin_instruction(Bus &bus) {
+    instruction_count++;
+    if (dispatch == Dispatch::Cached || dispatch == Dispatch::Jit) {
+        run_cached(bus);
+        return;
+    }
+
+    opcode = bus.read(pc);
+    pc++;
+    implied = 0x00;
+    implied_has_value = false;
+
+    run_instruction(bus);
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::fetch(Bus &bus) {
+    if (implied_has_value) {
+        return implied;
+    } else {
+        return bus.read(addr_abs);
+    }
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::write(Bus &bus, uint16_t addr, uint8_t value) {
+    if (code_cache && (code_cache->code_bytes[addr >> 3] >> (addr & 7)) & 1u) {
+        invalidate_chunk(addr);
+    }
+    bus.write(addr, value);
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::set_status_flag(Flags6502 flag, bool value) {
+    if (value) {
+        status = status | flag;
+    } else {
+        status = status & ~flag;
+    }
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::irq(Bus &bus) {
+    if (!is_status_flag_set(Flags6502::I)) {
+        push_program_counter_on_stack(bus);
+        push_interrupt_state_on_stack(bus);
+        load_program_counter_from_addr(bus, 0xFFFE);
+        cycles = 7;
+    }
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::nmi(Bus &bus) {
+    push_program_counter_on_stack(bus);
+    push_interrupt_state_on_stack(bus);
+    load_program_counter_from_addr(bus, 0xFFFA);
+    cycles = 8;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::push_interrupt_state_on_stack(Bus &bus) {
+    set_status_flag(Flags6502::B, false);
+    set_status_flag(Flags6502::U, true);
+    push_value_on_stack(bus, status);
+    // RTI restores the I flag as it was before the interrupt
+    set_status_flag(Flags6502::I, true);
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::push_program_counter_on_stack(Bus &bus) {
+    push_value_on_stack(bus, (pc >> 8));
+    push_value_on_stack(bus, pc);
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::pop_program_counter_from_stack(Bus &bus) {
+    auto lo = pop_value_from_stack(bus);
+    auto hi = pop_value_from_stack(bus);
+    pc = (hi << 8) | lo;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::push_value_on_stack(Bus &bus, uint8_t value) {
+    write(bus, 0x0100 + stkp, value);
+    stkp--;
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::pop_value_from_stack(Bus &bus) {
+    stkp++;
+    return bus.read(0x0100 + stkp);
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::load_program_counter_from_addr(Bus &bus, uint16_t addr) {
+    auto lo = bus.read(addr);
+    auto hi = bus.read(addr + 1);
+    pc = (hi << 8) | lo;
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::run_instruction(Bus &bus) {
+    switch (dispatch) {
+        case Dispatch::Table: return run_table(bus);
+        case Dispatch::Threaded: run_threaded(bus, false); return cycles;
+        default: return run_switch(bus);
+    }
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::run_switch(Bus &bus) {
+#define C64_SWITCH_CASE(op, mode, inst, cyc) \
+    case op: { uint8_t extra = mode(bus); return cycles += cyc + (extra & inst(bus)); }
+
+    switch (opcode) {
+        C64_OPCODES(C64_SWITCH_CASE)
+        default: { throw std::runtime_error("what opcode is this? "); }
+    }
+#undef C64_SWITCH_CASE
+}
+
+/// One instruction with its addressing mode, the table backend points at these
+template<typename Bus>
+template<uint8_t (CPU6502T<Bus>::*Mode)(Bus &), uint8_t (CPU6502T<Bus>::*Operate)(Bus &), uint8_t Cycles>
+uint8_t CPU6502T<Bus>::execute(CPU6502T &cpu, Bus &bus) {
+    uint8_t extra = (cpu.*Mode)(bus);
+    extra &= (cpu.*Operate)(bus);
+    return cpu.cycles += Cycles + extra;
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::run_table(Bus &bus) {
+#define C64_TABLE_ENTRY(op, mode, inst, cyc) &CPU6502T::execute<&CPU6502T::mode, &CPU6502T::inst, cyc>,
+
+    static constexpr InstructionFn table[256] = {
+            C64_OPCODES(C64_TABLE_ENTRY)
+    };
+#undef C64_TABLE_ENTRY
+    return table[opcode](*this, bus);
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::run_threaded(Bus &bus, bool chain) {
+#if defined(__GNUC__)
+#define C64_LABEL_ADDRESS(op, mode, inst, cyc) &&opcode_##op,
+    // every handler fetches the next opcode and jumps straight to its handler
+#define C64_LABEL(op, mode, inst, cyc) \
+    opcode_##op: { \
+        uint8_t extra = mode(bus); \
+        cycles += cyc + (extra & inst(bus)); \
+        if (!chain || !next_threaded(bus)) return; \
+        goto *labels[opcode]; \
+    }
+
+    static void *const labels[256] = {
+            C64_OPCODES(C64_LABEL_ADDRESS)
+    };
+    goto *labels[opcode];
+    C64_OPCODES(C64_LABEL)
+#undef C64_LABEL
+#undef C64_LABEL_ADDRESS
+#else
+    // computed goto is a GCC/Clang extension
+    do {
+        run_switch(bus);
+    } while (chain && next_threaded(bus));
+#endif
+}
+
+template<typename Bus>
+bool CPU6502T<Bus>::next_threaded(Bus &bus) {
+    uint8_t used = std::min<uint64_t>(cycles, run_end - clock_count);
+    cycles -= used;
+    clock_count += used;
+    if (clock_count >= run_end) {
+        return false;
+    }
+    opcode = bus.read(pc);
+    pc++;
+    implied = 0x00;
+    implied_has_value = false;
+    instruction_count++;
+    return true;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::invalidate_code(uint16_t addr) {
+    if (code_cache) {
+        for (int offset = 0; offset < 0x100; offset += 1 << chunk_shift) {
+            invalidate_chunk((addr & 0xFF00) + offset);
+        }
+    }
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::invalidate_chunk(uint16_t addr) {
+    constexpr int chunk_size = 1 << chunk_shift;
+    auto &cache = *code_cache;
+    unsigned chunk = addr >> chunk_shift;
+    cache.generation[chunk]++;
+    std::fill_n(&cache.code_bytes[(chunk << chunk_shift) >> 3], chunk_size / 8, 0);
+    if (cache.block != nullptr && (cache.block->start >> chunk_shift) <= chunk && chunk <= (cache.block->last >> chunk_shift)) {
+        cache.block = nullptr;
+    }
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::flush_code_cache() {
+    if (code_cache) {
+        for (auto &generation: code_cache->generation) {
+            generation++;
+        }
+        std::fill(std::begin(code_cache->code_bytes), std::end(code_cache->code_bytes), 0);
+        code_cache->block = nullptr;
+    }
+}
+
+/// A bus whose memory map can change (e.g. the C64 banking ROMs in and out)
+/// reports the current configuration as `uint8_t code_bank()`
+template<typename Bus>
+uint8_t CPU6502T<Bus>::code_bank(Bus &bus) {
+    if constexpr (requires { { bus.code_bank() } -> std::convertible_to<uint8_t>; }) {
+        return bus.code_bank();
+    } else {
+        return 0;
+    }
+}
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::run_cached(Bus &bus) {
+    if (!code_cache) {
+        code_cache = std::make_unique<CodeCache>();
+    }
+    auto &cache = *code_cache;
+
+    // carry on in the current block unless something moved the PC (interrupts,
+    // jumps) or switched banks. Writing to the block's page drops it.
+    uint8_t bank = code_bank(bus);
+    CodeBlock *block = cache.block;
+    if (block == nullptr || pc != cache.next_pc || cache.index == block->count || bank != block->bank) {
+        block = enter_block(bus, bank);
+        if (block == nullptr) {
+            // the instruction runs into the next page
+            opcode = bus.read(pc);
+            pc++;
+            implied = 0x00;
+            implied_has_value = false;
+            return run_table(bus);
+        }
+    }
+
+    auto &instruction = block->instructions[cache.index++];
+    opcode = instruction.opcode;
+    pc++;
+    implied = 0x00;
+    implied_has_value = false;
+    uint8_t result = instruction.handler(*this, bus, instruction.operand);
+    cache.next_pc = pc;
+    return result;
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::run_block(Bus &bus) {
+    if (!code_cache) {
+        code_cache = std::make_unique<CodeCache>();
+    }
+    auto &cache = *code_cache;
+
+    uint8_t bank = code_bank(bus);
+    CodeBlock *block = cache.block;
+    if (block == nullptr || pc != cache.next_pc || cache.index == block->count || bank != block->bank) {
+        block = enter_block(bus, bank);
+        if (block == nullptr) {
+            // the instruction runs into the next page
+            instruction_count++;
+            opcode = bus.read(pc);
+            pc++;
+            implied = 0x00;
+            implied_has_value = false;
+            run_table(bus);
+            uint8_t used = std::min<uint64_t>(cycles, run_end - clock_count);
+            cycles -= used;
+            clock_count += used;
+            return;
+        }
+    }
+
+    // straight-line code, so only a write to the block (or the bank switch),
+    // end_run_at() or the end of the run stop it early
+    do {
+        auto &instruction = block->instructions[cache.index++];
+        instruction_count++;
+        opcode = instruction.opcode;
+        pc++;
+        implied = 0x00;
+        implied_has_value = false;
+        instruction.handler(*this, bus, instruction.operand);
+        uint8_t used = std::min<uint64_t>(cycles, run_end - clock_count);
+        cycles -= used;
+        clock_count += used;
+    } while (clock_count < run_end && cache.block == block && cache.index < block->count && code_bank(bus) == bank);
+    cache.next_pc = pc;
+}
+
+/// Makes the block at the PC the current one, null if there is no block
+template<typename Bus>
+typename CPU6502T<Bus>::CodeBlock *CPU6502T<Bus>::enter_block(Bus &bus, uint8_t bank) {
+    auto &cache = *code_cache;
+    CodeBlock *block = &cache.blocks[(pc ^ (pc >> 7) ^ (bank << 5)) & (code_cache_blocks - 1)];
+    if (block->count == 0 || block->start != pc || block->bank != bank ||
+        block->generation != cache.generation[pc >> chunk_shift] ||
+        block->last_generation != cache.generation[block->last >> chunk_shift]) {
+        decode_block(bus, *block, pc, bank);
+    }
+    cache.index = 0;
+    cache.block = block->count == 0 ? nullptr : block;
+    return cache.block;
+}
+
+/// Runs the block at the PC as native code if it is compiled (or hot enough
+/// to be) and fits in `budget`. Returns the cycles used, 0 when it did not run.
+template<typename Bus>
+uint32_t CPU6502T<Bus>::run_native(Bus &bus, uint64_t budget) {
+    if (!code_cache) {
+        code_cache = std::make_unique<CodeCache>();
+    }
+    auto &cache = *code_cache;
+
+    // native code only starts at the top of a block
+    uint8_t bank = code_bank(bus);
+    CodeBlock *block = cache.block;
+    if (block != nullptr && pc == cache.next_pc && cache.index < block->count && bank == block->bank) {
+        return 0;
+    }
+    block = enter_block(bus, bank);
+    if (block == nullptr) {
+        return 0;
+    }
+
+    if (block->native == nullptr) {
+        if (block->hits < jit_threshold) {
+            block->hits++;
+            return 0;
+        }
+        compile_block(*block);
+        if (block->native == nullptr) {
+            return 0;
+        }
+    }
+    if (block->max_cycles > budget) {
+        return 0;
+    }
+
+    uint32_t executed = block->native(this, &bus, &cache.block);
+    cache.index = executed;
+    cache.next_pc = pc;
+    instruction_count += executed;
+    uint32_t used = cycles;
+    cycles = 0;
+    return used;
+}
+
+/// Compiles a block to a function that sets up each instruction the way
+/// run_cached does and calls its handler. Flag, transfer and increment
+/// instructions are inlined. Code stops early once a write drops the block.
+template<typename Bus>
+void CPU6502T<Bus>::compile_block(CodeBlock &block) {
+#ifdef C64_JIT_X64
+    auto &cache = *code_cache;
+    block.hits = 0;
+
+    for (int i = 0; i < block.count; i++) {
+        // a handler must not throw through native code
+        if (std::string_view(instruction_info(block.instructions[i].opcode).instruction) == "???") {
+            return;
+        }
+    }
+
+    if (!cache.jit) {
+        try {
+            cache.jit = std::make_unique<JitBuffer>();
+        } catch (std::runtime_error const &) {
+            abandon_jit();
+            return;
+        }
+    }
+    auto &jit = *cache.jit;
+    size_t max_size = 32 + block.count * 112;
+    if (!jit.begin(max_size)) {
+        if (!jit.usable()) {
+            abandon_jit();
+            return;
+        }
+        // out of code space, start over
+        for (auto &other: cache.blocks) {
+            other.native = nullptr;
+        }
+        jit.reset();
+        if (!jit.begin(max_size)) {
+            return;
+        }
+    }
+
+    auto field = [this](const void *member) {
+        return static_cast<uint32_t>(static_cast<const char *>(member) - reinterpret_cast<const char *>(this));
+    };
+    const uint32_t a_at = field(&a), x_at = field(&x), y_at = field(&y), pc_at = field(&pc);
+    const uint32_t cycles_at = field(&cycles), opcode_at = field(&opcode);
+    const uint32_t n_at = field(&status.n), z_at = field(&status.z), c_at = field(&status.c);
+    const uint32_t v_at = field(&status.v), other_at = field(&status.other);
+    const uint32_t implied_at = field(&implied), has_value_at = field(&implied_has_value);
+
+    // [rbx + disp32] addressing, rbx holds the CPU
+    auto store8 = [&](uint32_t at, uint8_t value) { jit.emit({0xC6, 0x83}); jit.emit32(at); jit.emit8(value); };
+    auto add8 = [&](uint32_t at, uint8_t value) { jit.emit({0x80, 0x83}); jit.emit32(at); jit.emit8(value); };
+    auto and8 = [&](uint32_t at, uint8_t value) { jit.emit({0x80, 0xA3}); jit.emit32(at); jit.emit8(value); };
+    auto or8 = [&](uint32_t at, uint8_t value) { jit.emit({0x80, 0x8B}); jit.emit32(at); jit.emit8(value); };
+    auto add16 = [&](uint32_t at, uint8_t value) { jit.emit({0x66, 0x83, 0x83}); jit.emit32(at); jit.emit8(value); };
+    auto load_al = [&](uint32_t at) { jit.emit({0x0F, 0xB6, 0x83}); jit.emit32(at); };
+    auto store_al = [&](uint32_t at) { jit.emit({0x88, 0x83}); jit.emit32(at); };
+    auto set_nz = [&] { store_al(n_at); store_al(z_at); };
+    auto transfer = [&](uint32_t from, uint32_t to) { load_al(from); store_al(to); set_nz(); };
+    auto step = [&](uint32_t at, uint8_t modrm) { load_al(at); jit.emit({0xFE, modrm}); store_al(at); set_nz(); };
+
+    // push rbx, r12, r13 (keeps the stack aligned for the calls), then
+    // rbx = cpu, r12 = bus, r13 = &code_cache->block
+    jit.emit({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4, 0x49, 0x89, 0xD5});
+
+    std::pair<size_t, uint32_t> exits[max_block_length];
+    int exit_count = 0;
+    uint32_t max_cycles = 0;
+
+    for (int i = 0; i < block.count; i++) {
+        auto &instruction = block.instructions[i];
+        max_cycles += instruction.cycles + 2;
+        store8(opcode_at, instruction.opcode);
+        add16(pc_at, 1);
+
+        bool inlined = true;
+        switch (instruction.opcode) {
+            // CLI is left to its handler, which may end the run (see hold_irq)
+            case 0xEA: case 0x18: case 0x38: case 0x78: case 0xB8: case 0xD8: case 0xF8:
+            case 0xE8: case 0xC8: case 0xCA: case 0x88: case 0xAA: case 0xA8: case 0x8A: case 0x98:
+                // what IMP does
+                load_al(a_at);
+                store_al(implied_at);
+                store8(has_value_at, 1);
+                break;
+            default:
+                inlined = false;
+        }
+
+        switch (instruction.opcode) {
+            case 0x18: store8(c_at, 0); break;                // CLC
+            case 0x38: store8(c_at, 1); break;                // SEC
+            case 0x78: or8(other_at, Flags6502::I); break;    // SEI
+            case 0xB8: store8(v_at, 0); break;                // CLV
+            case 0xD8: and8(other_at, uint8_t(~Flags6502::D)); break; // CLD
+            case 0xF8: or8(other_at, Flags6502::D); break;    // SED
+            case 0xE8: step(x_at, 0xC0); break;               // INX
+            case 0xC8: step(y_at, 0xC0); break;               // INY
+            case 0xCA: step(x_at, 0xC8); break;               // DEX
+            case 0x88: step(y_at, 0xC8); break;               // DEY
+            case 0xAA: transfer(a_at, x_at); break;           // TAX
+            case 0xA8: transfer(a_at, y_at); break;           // TAY
+            case 0x8A: transfer(x_at, a_at); break;           // TXA
+            case 0x98: transfer(y_at, a_at); break;           // TYA
+            default: break;
+        }
+
+        if (inlined) {
+            add8(cycles_at, instruction.cycles);
+            continue;
+        }
+
+        store8(implied_at, 0);
+        store8(has_value_at, 0);
+        jit.emit({0x48, 0x89, 0xDF, 0x4C, 0x89, 0xE6, 0xBA}); // mov rdi, rbx; mov rsi, r12; mov edx, operand
+        jit.emit32(instruction.operand);
+        jit.emit({0x48, 0xB8}); // mov rax, handler; call rax
+        jit.emit64(reinterpret_cast<uint64_t>(instruction.handler));
+        jit.emit({0xFF, 0xD0});
+
+        if (i + 1 < block.count) {
+            // a write to the block's page cleared code_cache->block
+            jit.emit({0x49, 0x8B, 0x45, 0x00, 0x48, 0x85, 0xC0, 0x0F, 0x84}); // mov rax, [r13]; test rax, rax; jz
+            jit.emit32(0);
+            exits[exit_count++] = {jit.offset() - 4, static_cast<uint32_t>(i + 1)};
+        }
+    }
+
+    jit.emit8(0xB8); // mov eax, count
+    jit.emit32(block.count);
+    size_t epilogue = jit.offset();
+    jit.emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3}); // pop r13, r12, rbx; ret
+
+    for (int i = 0; i < exit_count; i++) {
+        jit.patch_rel32(exits[i].first, jit.offset());
+        jit.emit8(0xB8); // mov eax, executed; jmp epilogue
+        jit.emit32(exits[i].second);
+        jit.emit8(0xE9);
+        jit.emit32(0);
+        jit.patch_rel32(jit.offset() - 4, epilogue);
+    }
+
+    block.max_cycles = max_cycles;
+    block.native = reinterpret_cast<NativeFn>(jit.finish());
+    if (block.native == nullptr) {
+        abandon_jit();
+    }
+#endif
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::abandon_jit() {
+    auto &cache = *code_cache;
+    for (auto &other: cache.blocks) {
+        other.native = nullptr;
+    }
+    cache.jit.reset();
+    dispatch = Dispatch::Cached;
+}
+
+constexpr uint8_t operand_length(AddressMode mode) {
+    switch (mode) {
+        case AddressMode::IMP: return 0;
+        case AddressMode::ABS:
+        case AddressMode::ABX:
+        case AddressMode::ABY:
+        case AddressMode::IND: return 2;
+        default: return 1;
+    }
+}
+
+/// Whether the instruction can continue anywhere but the next instruction
+constexpr bool ends_block(std::string_view instruction, AddressMode mode) {
+    return mode == AddressMode::REL || instruction == "JMP" || instruction == "JSR" || instruction == "RTS" ||
+           instruction == "RTI" || instruction == "BRK" || instruction == "XXX";
+}
+
+template<typename Bus>
+void CPU6502T<Bus>::decode_block(Bus &bus, CodeBlock &block, uint16_t start, uint8_t bank) {
+    struct DecodeInfo {
+        DecodedFn handler;
+        uint8_t length;
+        uint8_t cycles;
+        bool ends_block;
+    };
+#define C64_DECODE_ENTRY(op, mode, inst, cyc) \
+    {&CPU6502T::execute_decoded<AddressMode::mode, &CPU6502T::inst, cyc>, \
+     operand_length(AddressMode::mode), cyc, ends_block(#inst, AddressMode::mode)},
+
+    static constexpr DecodeInfo table[256] = {
+            C64_OPCODES(C64_DECODE_ENTRY)
+    };
+#undef C64_DECODE_ENTRY
+
+    block.start = start;
+    block.bank = bank;
+    block.count = 0;
+    block.hits = 0;
+    block.native = nullptr;
+
+    uint16_t addr = start;
+    while (block.count < max_block_length) {
+        uint8_t op = bus.read(addr, true);
+        auto &info = table[op];
+        if ((addr & 0xFF) + 1 + info.length > 0x100) {
+            break;
+        }
+
+        uint16_t operand = 0;
+        if (info.length > 0) {
+            operand = bus.read(addr + 1, true);
+        }
+        if (info.length > 1) {
+            operand |= bus.read(addr + 2, true) << 8;
+        }
+        block.instructions[block.count++] = {info.handler, operand, op, info.cycles};
+        for (int i = 0; i <= info.length; i++, addr++) {
+            code_cache->code_bytes[addr >> 3] |= 1u << (addr & 7);
+        }
+
+        if (info.ends_block) {
+            break;
+        }
+    }
+    block.last = addr - 1;
+    block.generation = code_cache->generation[start >> chunk_shift];
+    block.last_generation = code_cache->generation[block.last >> chunk_shift];
+}
+
+/// Like execute, but with the operand bytes already decoded from memory
+template<typename Bus>
+template<AddressMode Mode, uint8_t (CPU6502T<Bus>::*Operate)(Bus &), uint8_t Cycles>
+uint8_t CPU6502T<Bus>::execute_decoded(CPU6502T &cpu, Bus &bus, uint16_t operand) {
+    uint8_t extra = 0;
+    if constexpr (Mode == AddressMode::IMP) {
+        extra = cpu.IMP(bus);
+    } else if constexpr (Mode == AddressMode::IMM) {
+        cpu.addr_abs = cpu.pc;
+    } else if constexpr (Mode == AddressMode::ZP0) {
+        cpu.addr_abs = operand;
+    } else if constexpr (Mode == AddressMode::ZPX) {
+        cpu.addr_abs = (operand + cpu.x) & 0x00FF;
+    } else if constexpr (Mode == AddressMode::ZPY) {
+        cpu.addr_abs = (operand + cpu.y) & 0x00FF;
+    } else if constexpr (Mode == AddressMode::REL) {
+        cpu.addr_rel = operand;
+    } else if constexpr (Mode == AddressMode::ABS) {
+        cpu.addr_abs = operand;
+    } else if constexpr (Mode == AddressMode::ABX) {
+        cpu.addr_abs = operand + cpu.x;
+        extra = (cpu.addr_abs & 0xFF00) != (operand & 0xFF00);
+    } else if constexpr (Mode == AddressMode::ABY) {
+        cpu.addr_abs = operand + cpu.y;
+        extra = (cpu.addr_abs & 0xFF00) != (operand & 0xFF00);
+    } else if constexpr (Mode == AddressMode::IND) {
+        // the pointer is read when the jump happens (it moves the PC itself)
+        extra = cpu.IND(bus);
+    } else if constexpr (Mode == AddressMode::IZX) {
+        auto lo = bus.read((operand + cpu.x) & 0x00FF);
+        auto hi = bus.read((operand + cpu.x + 1) & 0x00FF);
+        cpu.addr_abs = (hi << 8) | lo;
+    } else if constexpr (Mode == AddressMode::IZY) {
+        auto lo = bus.read(operand & 0x00FF);
+        auto hi = bus.read((operand + 1) & 0x00FF);
+        cpu.addr_abs = ((hi << 8) | lo) + cpu.y;
+        extra = (cpu.addr_abs & 0xFF00) != (hi << 8);
+    }
+    if constexpr (Mode != AddressMode::IND) {
+        cpu.pc += operand_length(Mode);
+    }
+
+    extra &= (cpu.*Operate)(bus);
+    return cpu.cycles += Cycles + extra;
+}
+
+/// Implied -> the fetched value is the _a_ register
+template<typename Bus>
+uint8_t CPU6502T<Bus>::IMP(Bus &bus) {
+    implied = a;
+    implied_has_value = true;
+    return 0;
+}
+
+/// Immediate -> the value pointed to by the program counter
+template<typename Bus>
+uint8_t CPU6502T<Bus>::IMM(Bus &bus) {
+    addr_abs = pc;
+    pc += 1;
+    return 0;
+}
+
+/// Zero Page 0 -> The address is in the range $0000-$00FF
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ZP0(Bus &bus) {
+    addr_abs = bus.read(pc);
+    pc += 1;
+    return 0;
+}
+
+/// Zero Page + X -> An address is read from memory and _x_ is added.
+/// The final address is in the range $0000-$00FF (wrap around).
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ZPX(Bus &bus) {
+    addr_abs = bus.read(pc) + x;
+    addr_abs &= 0x00FF;
+    pc += 1;
+    return 0;
+}
+
+/// Zero Page + Y -> An address is read from memory and _y_ is added.
+/// The final address is in the range $0000-$00FF (wrap around).
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ZPY(Bus &bus) {
+    addr_abs = bus.read(pc) + y;
+    addr_abs &= 0x00FF;
+    pc += 1;
+    return 0;
+}
+
+/// Relative -> A value is read from memory and stored for branching jump operations.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::REL(Bus &bus) {
+    addr_rel = bus.read(pc);
+    pc += 1;
+    return 0;
+}
+
+/// Absolute -> Two values are read from memory and used as an address.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ABS(Bus &bus) {
+    auto lo = bus.read(pc);
+    pc += 1;
+    auto hi = bus.read(pc);
+    pc += 1;
+    addr_abs = (hi << 8) | lo;
+    return 0;
+}
+
+/// Absolute + x -> Two values are read from memory then _x_ is added
+/// and used as an address.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ABX(Bus &bus) {
+    auto lo = bus.read(pc);
+    pc += 1;
+    auto hi = bus.read(pc);
+    pc += 1;
+    addr_abs = (hi << 8) | lo;
+    addr_abs += x;
+
+    // Cycle count increased if crossing a page
+    if ((addr_abs & 0xFF00) != (hi << 8)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/// Absolute + y -> Two values are read from memory then _y_ is added
+/// and used as an address.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ABY(Bus &bus) {
+    auto lo = bus.read(pc);
+    pc += 1;
+    auto hi = bus.read(pc);
+    pc += 1;
+    addr_abs = (hi << 8) | lo;
+    addr_abs = addr_abs + y;
+
+    // Cycle count increased if crossing a page
+    if ((addr_abs & 0xFF00) != (hi << 8)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/// Indirect -> Two values are read from memory and used as an address to
+/// read the actual address.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::IND(Bus &bus) {
+    auto ptr_lo = bus.read(pc);
+    pc += 1;
+    auto ptr_hi = bus.read(pc);
+    pc += 1;
+    auto ptr = (ptr_hi << 8) | ptr_lo;
+
+    // Simulate page boundary hardware bug
+    if (ptr_lo == 0x00FF) {
+        auto hi = bus.read(ptr & 0xFF00);
+        auto lo = bus.read(ptr);
+        addr_abs = (hi << 8) | lo;
+    } else {
+        auto hi = bus.read(ptr + 1);
+        auto lo = bus.read(ptr);
+        addr_abs = (hi << 8) | lo;
+    }
+    return 0;
+}
+
+/// Indirect Zero Page + X -> A value is read from memory and _x_ is added, then
+/// the actual address is read from the zero page.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::IZX(Bus &bus) {
+    auto t = bus.read(pc);
+    pc += 1;
+
+    auto lo = bus.read((t + x) & 0x00FF);
+    auto hi = bus.read((t + x + 1) & 0x00FF);
+    addr_abs = (hi << 8) | lo;
+
+    return 0;
+}
+
+/// Indirect Zero Page + Y -> A value is read from memory and the actual
+/// address is read from the zero page then _y_ is added.
+template<typename Bus>
+uint8_t CPU6502T<Bus>::IZY(Bus &bus) {
+    auto t = bus.read(pc);
+    pc += 1;
+
+    auto lo = bus.read(t & 0x00FF);
+    auto hi = bus.read((t + 1) & 0x00FF);
+    auto addr = ((hi << 8) | lo) + y;
+    addr_abs = addr;
+
+    // Cycle count increased if crossing a page
+    if ((addr & 0xFF00) != (hi << 8)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/// the actual add operation with carry and overflow checking
+template<typename Bus>
+void CPU6502T<Bus>::add(uint8_t m) {
+    auto carry = get_flag(Flags6502::C);
+    uint16_t temp = a + m + carry;
+    status.c = temp >> 8;
+    status.set_nz(temp);
+    status.v = ~(a ^ m) & (a ^ temp);
+    a = temp & 0x00FF;
+}
+
+/// One BCD digit of a decimal mode ADC or SBC, indexed by
+/// `subtract << 8 | digit of A << 4 | digit of M`. The low byte is the result
+/// without a carry (borrow for SBC) coming in, the high byte the one with. Each
+/// holds the digit in bits 0-3 and the carry (or borrow) out in bit 4. Digits
+/// above 9 are corrected the same way as valid ones.
+constexpr std::array<uint16_t, 0x200> make_bcd_digits() {
+    std::array<uint16_t, 0x200> table{};
+    for (int index = 0; index < 0x200; index++) {
+        bool subtract = index >> 8;
+        int d1 = (index >> 4) & 0x0F;
+        int d2 = index & 0x0F;
+        for (int carry = 0; carry < 2; carry++) {
+            int digit = subtract ? d1 - d2 - carry : d1 + d2 + carry;
+            int carry_out = 0;
+            if (digit < 0 || digit > 9) {
+                digit += subtract ? -6 : 6;
+                carry_out = 1;
+            }
+            table[index] |= ((digit & 0x0F) | carry_out << 4) << (carry * 8);
+        }
+    }
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 0x200> bcd_digits = make_bcd_digits();
+
+/// the actual decimal add operation, only C and Z are updated
+template<typename Bus>
+void CPU6502T<Bus>::add_bdc(uint8_t m, int8_t sign) {
+    unsigned subtract = sign < 0;
+    unsigned carry = get_flag(Flags6502::C) ^ subtract;
+    // both digits are looked up at once, the carry between them only picks a byte
+    uint16_t lo_digits = bcd_digits[subtract << 8 | (a & 0x0F) << 4 | (m & 0x0F)];
+    uint16_t hi_digits = bcd_digits[subtract << 8 | (a & 0xF0) | m >> 4];
+    uint8_t lo = lo_digits >> (carry << 3);
+    uint8_t hi = hi_digits >> ((lo & 0x10) >> 1);
+    uint8_t temp = hi << 4 | (lo & 0x0F);
+
+    status.c = (hi >> 4) ^ subtract;
+    status.z = temp;
+    a = temp;
+}
+
+/// Add with carry
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ADC(Bus &bus) {
+    auto m = fetch(bus);
+    if(is_status_flag_set(Flags6502::D)) {
+        add_bdc(m, 1);
+    } else {
+        add(m);
+    }
+    return 1;
+}
+
+/// ANDs the contents of the A register with an immediate
+/// value and then moves bit 7 of A into the Carry flag
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ANC(Bus &bus) {
+    AND(bus);
+    ASL(bus);
+    return 1;
+}
+
+/// AND (with accumulator)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::AND(Bus &bus) {
+    auto m = fetch(bus);
+    a = a & m;
+    status.set_nz(a);
+    return 1;
+}
+
+/// arithmetic shift left
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ASL(Bus &bus) {
+    auto m = fetch(bus);
+    status.c = m >> 7;
+    m = m << 1;
+    status.set_nz(m);
+
+    if (implied_has_value) {
+        a = m;
+    } else {
+        write(bus, addr_abs, m);
+    }
+    return 0;
+}
+
+
+/// common function for the branching instructions
+template<typename Bus>
+void CPU6502T<Bus>::branch() {
+    cycles += 1;
+    addr_abs = pc + (int8_t) addr_rel;
+
+    if ((addr_abs & 0xFF00) != (pc & 0xFF00)) {
+        cycles += 1;
+    }
+
+    pc = addr_abs;
+}
+
+/// branch on carry clear
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BCC(Bus &bus) {
+    if (!is_status_flag_set(Flags6502::C)) {
+        branch();
+    }
+    return 0;
+}
+
+/// branch on carry set
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BCS(Bus &bus) {
+    if (is_status_flag_set(Flags6502::C)) {
+        branch();
+    }
+    return 0;
+}
+
+/// branch on equal (zero set)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BEQ(Bus &bus) {
+    if (is_status_flag_set(Flags6502::Z)) {
+        branch();
+    }
+    return 0;
+}
+
+/// bit test
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BIT(Bus &bus) {
+    auto m = fetch(bus);
+    auto temp = a & m;
+    status.z = temp;
+    status.n = m;
+    status.v = m << 1;
+    return 0;
+}
+
+/// branch on minus (negative set)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BMI(Bus &bus) {
+    if (is_status_flag_set(Flags6502::N)) {
+        branch();
+    }
+    return 0;
+}
+
+/// branch on not equal (zero clear)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BNE(Bus &bus) {
+    if (!is_status_flag_set(Flags6502::Z)) {
+        branch();
+    }
+    return 0;
+}
+
+/// branch on plus (negative clear)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BPL(Bus &bus) {
+    if (!is_status_flag_set(Flags6502::N)) {
+        branch();
+    }
+    return 0;
+}
+
+/// break / interrupt
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BRK(Bus &bus) {
+    // pc += 1;
+    push_program_counter_on_stack(bus);
+    push_value_on_stack(bus, status | Flags6502::U | Flags6502::B);
+    load_program_counter_from_addr(bus, 0xFFFE);
+    set_status_flag(Flags6502::I, true);
+
+    return 0;
+}
+
+/// branch on overflow clear
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BVC(Bus &bus) {
+    if (!is_status_flag_set(Flags6502::V)) {
+        branch();
+    }
+    return 0;
+}
+
+/// branch on overflow set
+template<typename Bus>
+uint8_t CPU6502T<Bus>::BVS(Bus &bus) {
+    if (is_status_flag_set(Flags6502::V)) {
+        branch();
+    }
+    return 0;
+}
+
+/// clear carry
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CLC(Bus &bus) {
+    status.c = 0;
+    return 0;
+}
+
+/// clear decimal
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CLD(Bus &bus) {
+    set_status_flag(Flags6502::D, false);
+    return 0;
+}
+
+/// clear interrupt disable
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CLI(Bus &bus) {
+    set_status_flag(Flags6502::I, false);
+    release_irq();
+    return 0;
+}
+
+/// clear overflow
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CLV(Bus &bus) {
+    status.v = 0;
+    return 0;
+}
+
+/// compare (with accumulator)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CMP(Bus &bus) {
+    auto m = fetch(bus);
+    auto temp = a - m;
+    status.c = a >= m;
+    status.set_nz(temp);
+    return 1;
+}
+
+/// compare with X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CPX(Bus &bus) {
+    auto m = fetch(bus);
+    auto temp = x - m;
+    status.c = x >= m;
+    status.set_nz(temp);
+    return 1;
+}
+
+/// compare with Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::CPY(Bus &bus) {
+    auto m = fetch(bus);
+    auto temp = y - m;
+    status.c = y >= m;
+    status.set_nz(temp);
+    return 1;
+}
+
+/// decrement and compare with Accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::DCP(Bus &bus) {
+    DEC(bus);
+    CMP(bus);
+    return 1;
+}
+
+/// decrement
+template<typename Bus>
+uint8_t CPU6502T<Bus>::DEC(Bus &bus) {
+    auto m = fetch(bus);
+    m = m - 0x01;
+    write(bus, addr_abs, m);
+    status.set_nz(m);
+    return 0;
+}
+
+/// decrement X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::DEX(Bus &bus) {
+    x = x - 0x01;
+    status.set_nz(x);
+    return 0;
+}
+
+/// decrement Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::DEY(Bus &bus) {
+    y = y - 0x01;
+    status.set_nz(y);
+    return 0;
+}
+
+/// exclusive or (with accumulator)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::EOR(Bus &bus) {
+    auto m = fetch(bus);
+    a ^= m;
+    status.set_nz(a);
+    return 1;
+}
+
+/// increment
+template<typename Bus>
+uint8_t CPU6502T<Bus>::INC(Bus &bus) {
+    auto m = fetch(bus);
+    m = m + 1;
+    write(bus, addr_abs, m);
+    status.set_nz(m);
+    return 0;
+}
+
+/// increment X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::INX(Bus &bus) {
+    x = x + 0x01;
+    status.set_nz(x);
+    return 0;
+}
+
+/// increment Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::INY(Bus &bus) {
+    y = y + 0x01;
+    status.set_nz(y);
+    return 0;
+}
+
+/// Increment memory with one and then subtract memory from Accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ISB(Bus &bus) {
+    INC(bus);
+    SBC(bus);
+    return 1;
+}
+
+/// jump
+template<typename Bus>
+uint8_t CPU6502T<Bus>::JMP(Bus &bus) {
+    pc = addr_abs;
+    return 0;
+}
+
+/// jump subroutine
+template<typename Bus>
+uint8_t CPU6502T<Bus>::JSR(Bus &bus) {
+    pc -= 1;
+    push_program_counter_on_stack(bus);
+    pc = addr_abs;
+    return 0;
+}
+
+/// * load accumulator and x with memory contents
+template<typename Bus>
+uint8_t CPU6502T<Bus>::LAX(Bus &bus) {
+    auto m = fetch(bus);
+    a = m;
+    x = m;
+    status.set_nz(m);
+    return 1;
+}
+
+/// load accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::LDA(Bus &bus) {
+    a = fetch(bus);
+    status.set_nz(a);
+    return 1;
+}
+
+/// Load X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::LDX(Bus &bus) {
+    x = fetch(bus);
+    status.set_nz(x);
+    return 1;
+}
+
+/// Load Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::LDY(Bus &bus) {
+    y = fetch(bus);
+    status.set_nz(y);
+    return 1;
+}
+
+/// logical shift right
+template<typename Bus>
+uint8_t CPU6502T<Bus>::LSR(Bus &bus) {
+    auto m = fetch(bus);
+    status.c = m & 0x01;
+    m = m >> 1;
+    status.set_nz(m);
+
+    if (implied_has_value) {
+        a = m;
+    } else {
+        write(bus, addr_abs, m);
+    }
+    return 0;
+}
+
+/// no operation
+template<typename Bus>
+uint8_t CPU6502T<Bus>::NOP(Bus &bus) {
+    switch (opcode) {
+        case (0x1C):
+        case (0x3C):
+        case (0x5C):
+        case (0x7C):
+        case (0xDC):
+        case (0xFC):return 1;
+        default:return 0;
+    }
+}
+
+/// or with accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ORA(Bus &bus) {
+    auto m = fetch(bus);
+    a |= m;
+    status.set_nz(a);
+    return 1;
+}
+
+/// push accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::PHA(Bus &bus) {
+    push_value_on_stack(bus, a);
+    return 0;
+}
+
+/// push processor status (SR)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::PHP(Bus &bus) {
+    push_value_on_stack(bus, status | Flags6502::B | Flags6502::U);
+    return 0;
+}
+
+/// pull accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::PLA(Bus &bus) {
+    a = pop_value_from_stack(bus);
+    status.set_nz(a);
+    return 0;
+}
+
+/// pull processor status (SR)
+template<typename Bus>
+uint8_t CPU6502T<Bus>::PLP(Bus &bus) {
+    status = pop_value_from_stack(bus);
+    set_status_flag(Flags6502::U, true);
+    set_status_flag(Flags6502::B, false);
+    release_irq();
+    return 0;
+}
+
+/// rotate memory left and then AND accumulator with memory
+template<typename Bus>
+uint8_t CPU6502T<Bus>::RLA(Bus &bus) {
+    ROL(bus);
+    AND(bus);
+    return 0;
+}
+
+/// rotate left
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ROL(Bus &bus) {
+    uint16_t m = fetch(bus);
+    m = (m << 1) | get_flag(Flags6502::C);
+    status.c = m >> 8;
+
+    m &= 0x00FF;
+    status.set_nz(m);
+
+    if (implied_has_value) {
+        a = m;
+    } else {
+        write(bus, addr_abs, m);
+    }
+
+    return 0;
+}
+
+/// rotate right
+template<typename Bus>
+uint8_t CPU6502T<Bus>::ROR(Bus &bus) {
+    uint16_t m = fetch(bus);
+    auto carry = m & 0x01;
+    m = ((get_flag(Flags6502::C)) << 7) | (m >> 1);
+
+    m &= 0x00FF;
+    status.c = carry;
+    status.set_nz(m);
+
+    if (implied_has_value) {
+        a = m;
+    } else {
+        write(bus, addr_abs, m);
+    }
+
+    return 0;
+}
+
+/// Rotate memory one bit to the right and then add memory to accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::RRA(Bus &bus) {
+    ROR(bus);
+    ADC(bus);
+    return 0;
+}
+
+/// return from interrupt
+template<typename Bus>
+uint8_t CPU6502T<Bus>::RTI(Bus &bus) {
+    status = pop_value_from_stack(bus);
+    set_status_flag(Flags6502::U, true);
+    set_status_flag(Flags6502::B, false);
+    pop_program_counter_from_stack(bus);
+    release_irq();
+    return 0;
+}
+
+/// return from subroutine
+template<typename Bus>
+uint8_t CPU6502T<Bus>::RTS(Bus &bus) {
+    pop_program_counter_from_stack(bus);
+    pc += 1;
+    return 0;
+}
+
+/// AND X with Accumulator and store in memory
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SAX(Bus &bus) {
+    auto temp = a & x;
+    write(bus, addr_abs, temp);
+    return 0;
+}
+
+/// Subtract with borrow
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SBC(Bus &bus) {
+    auto m = fetch(bus);
+    if(is_status_flag_set(Flags6502::D)) {
+        add_bdc(m, -1);
+    } else {
+        add(~m);
+    }
+    return 1;
+}
+
+/// Set Carry
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SEC(Bus &bus) {
+    status.c = 1;
+    return 0;
+}
+
+/// Set Decimal
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SED(Bus &bus) {
+    set_status_flag(Flags6502::D, true);
+    return 0;
+}
+
+/// set interrupt disable
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SEI(Bus &bus) {
+    set_status_flag(Flags6502::I, true);
+    return 0;
+}
+
+/// Shift memory left and then OR accumulator with memory
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SLO(Bus &bus) {
+    ASL(bus);
+    ORA(bus);
+    return 0;
+}
+
+/// Shift memory one bit right then XOR with accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::SRE(Bus &bus) {
+    LSR(bus);
+    EOR(bus);
+    return 0;
+}
+
+/// store accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::STA(Bus &bus) {
+    write(bus, addr_abs, a);
+    return 0;
+}
+
+/// store X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::STX(Bus &bus) {
+    write(bus, addr_abs, x);
+    return 0;
+}
+
+/// store Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::STY(Bus &bus) {
+    write(bus, addr_abs, y);
+    return 0;
+}
+
+/// transfer accumulator to X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TAX(Bus &bus) {
+    x = a;
+    status.set_nz(x);
+    return 0;
+}
+
+/// transfer accumulator to Y
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TAY(Bus &bus) {
+    y = a;
+    status.set_nz(y);
+    return 0;
+}
+
+/// transfer stack pointer to X
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TSX(Bus &bus) {
+    x = stkp;
+    status.set_nz(x);
+    return 0;
+}
+
+/// transfer X to accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TXA(Bus &bus) {
+    a = x;
+    status.set_nz(a);
+    return 0;
+}
+
+/// transfer X to stack pointer
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TXS(Bus &bus) {
+    stkp = x;
+    return 0;
+}
+
+/// transfer Y to accumulator
+template<typename Bus>
+uint8_t CPU6502T<Bus>::TYA(Bus &bus) {
+    a = y;
+    status.set_nz(a);
+    return 0;
+}
+
+
+template<typename Bus>
+uint8_t CPU6502T<Bus>::XXX(Bus &bus) {
+    printf("Illegal opcode %02X at $%04X\n", opcode, pc);
+    throw std::runtime_error("err");
+}
+
+#endif //C64_CPU_6502_IMPL_HPP
@@ -0,0 +1,112 @@
+#ifndef C64_INSTRUCTION_TRACE_HPP
+#define C64_INSTRUCTION_TRACE_HPP
+
+#include "cpu_6502.hpp"
+#include "ring_buffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// The CPU as an instruction is about to run
+struct TraceRecord {
+    uint64_t cycle;
+    uint16_t pc;
+    uint8_t bytes[3]; // the opcode and the two bytes after it
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t sp;
+    uint8_t p;
+};
+
+/// The record for the instruction at the CPU's PC, `cycle` is the clock at
+/// which it starts
+TraceRecord trace_record(CPU6502Base const &cpu, CPUIO &bus, uint64_t cycle);
+
+/// Writes a binary trace of every instruction to a file. Records are delta
+/// encoded against the one before (registers that did not change and code
+/// seen before at that PC are left out) and the stream is compressed in
+/// 64 KB blocks with a small LZ77 coder, both on a background thread.
+///
+/// Unlike BusTracer nothing is dropped: when the ring is full the emulation
+/// waits for the writer.
+class InstructionTracer {
+public:
+    /// `out` must be open for binary writing, it is flushed but not closed
+    explicit InstructionTracer(FILE *out, size_t capacity = 1 << 16);
+
+    /// Writes whatever is left before returning
+    ~InstructionTracer();
+
+    InstructionTracer(InstructionTracer const &) = delete;
+
+    InstructionTracer &operator=(InstructionTracer const &) = delete;
+
+    void record(TraceRecord const &record) {
+        while (!ring.push(record)) {
+            std::this_thread::yield();
+        }
+    }
+
+    [[nodiscard]] uint64_t bytes_written() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    RingBuffer<TraceRecord> ring;
+    FILE *out;
+    std::atomic<uint64_t> written = 0;
+    std::atomic<bool> running = true;
+
+    // state of the delta encoder, only touched by the writer thread
+    TraceRecord previous{};
+    std::unique_ptr<uint8_t[]> code; // the bytes last recorded at each PC
+    std::vector<uint8_t> block;
+    std::vector<uint8_t> compressed;
+
+    std::thread write_thread;
+
+    size_t drain();
+
+    void encode(TraceRecord const &record);
+
+    void flush_block();
+};
+
+/// Reads back what InstructionTracer wrote
+class TraceReader {
+public:
+    /// `in` must be open for binary reading, throws if it is not a trace
+    explicit TraceReader(FILE *in);
+
+    /// False at the end of the trace, throws if it is corrupt
+    bool next(TraceRecord &record);
+
+private:
+    FILE *in;
+    TraceRecord previous{};
+    std::unique_ptr<uint8_t[]> code;
+    std::vector<uint8_t> block;
+    std::vector<uint8_t> compressed;
+    size_t position = 0;
+
+    bool read_block();
+
+    uint8_t byte();
+};
+
+/// One line in the format of the tests' CPU traces: PC, instruction bytes,
+/// disassembly, registers, cycle, addressing mode and flags
+std::string format_trace_record(TraceRecord const &record);
+
+/// LZ77 with LZ4-like sequences: a token with the literal and match lengths,
+/// the literals, a 16 bit offset. Exposed for the tests.
+void lz_compress(uint8_t const *data, size_t size, std::vector<uint8_t> &out);
+
+/// Throws if `data` does not decompress to exactly `size` bytes
+void lz_decompress(uint8_t const *data, size_t size, uint8_t *out, size_t out_size);
+
+#endif //C64_INSTRUCTION_TRACE_HPP
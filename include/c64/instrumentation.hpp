@@ -4,11 +4,22 @@
 
 #include <string>
 #include "cpu_6502.hpp"
+#include "profiler.hpp"
+#include "symbols.hpp"
 
 namespace c64tools {
-    std::string address(CPU6502 const& cpu, CPUIO& bus);
+    std::string address(CPU6502Base const& cpu, CPUIO& bus);
+
+    /// The operand of the instruction at `pc`, e.g. "$0400,X"
+    std::string address(CPU6502Base const& cpu, CPUIO& bus, uint16_t pc);
 
     std::string cpu_flags_to_string(uint8_t flags);
+
+    /// The `top` routines and instructions by cycles, and the costliest calls
+    /// when the profiler kept a call graph. Addresses are named from `symbols`
+    /// and instructions disassembled from `bus` as it is mapped now.
+    std::string profile_report(Profiler const& profiler, SymbolTable const& symbols,
+                               CPU6502Base const& cpu, CPUIO& bus, size_t top = 20);
 }
 
 
@@ -0,0 +1,68 @@
+#ifndef C64_JIT_X64_HPP
+#define C64_JIT_X64_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define C64_JIT_X64 1
+#endif
+
+/// Executable memory for the JIT backend together with an encoder for the
+/// few x86-64 instructions it emits. Code is written while the memory is
+/// writable and flipped to read/execute by finish(), so no page is ever
+/// writable and executable at the same time.
+class JitBuffer {
+public:
+    /// Whether native code can be generated on this platform
+    static bool supported();
+
+    explicit JitBuffer(size_t size = 1 << 20);
+
+    ~JitBuffer();
+
+    JitBuffer(JitBuffer const &) = delete;
+
+    JitBuffer &operator=(JitBuffer const &) = delete;
+
+    /// Starts a new function of at most `max_size` bytes, false when full or
+    /// when the memory cannot be made writable
+    bool begin(size_t max_size);
+
+    /// Makes the function executable and returns its entry point, nullptr when
+    /// the memory cannot be made executable
+    void *finish();
+
+    /// False once changing the protection of the memory has failed, after
+    /// which no function can be started
+    [[nodiscard]] bool usable() const { return !failed; }
+
+    /// Forgets all functions, earlier entry points become invalid
+    void reset();
+
+    [[nodiscard]] size_t offset() const { return used; }
+
+    void emit(std::initializer_list<uint8_t> bytes);
+
+    void emit8(uint8_t value);
+
+    void emit32(uint32_t value);
+
+    void emit64(uint64_t value);
+
+    /// Points the rel32 field at `at` (the last 4 bytes of a jump) to `target`
+    void patch_rel32(size_t at, size_t target);
+
+private:
+    uint8_t *memory = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t start = 0;
+    size_t page_size = 0;
+    bool failed = false;
+
+    bool protect(size_t from, size_t to, bool executable);
+};
+
+#endif //C64_JIT_X64_HPP
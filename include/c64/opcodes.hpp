@@ -0,0 +1,280 @@
+#ifndef C64_OPCODES_HPP
+#define C64_OPCODES_HPP
+
+// All 256 opcodes as OP(opcode, addressing mode, instruction, cycles).
+// The cycle count is the base count, page crossings and branches add to it.
+// Every dispatch backend in cpu_6502_impl.hpp is expanded from this one list.
+#define C64_OPCODES(OP) \
+    OP(0x00, IMM, BRK, 7) \
+    OP(0x01, IZX, ORA, 6) \
+    OP(0x02, IMP, XXX, 2) \
+    OP(0x03, IZX, SLO, 8) \
+    OP(0x04, ZP0, NOP, 3) \
+    OP(0x05, ZP0, ORA, 3) \
+    OP(0x06, ZP0, ASL, 5) \
+    OP(0x07, ZP0, SLO, 5) \
+    OP(0x08, IMP, PHP, 3) \
+    OP(0x09, IMM, ORA, 2) \
+    OP(0x0A, IMP, ASL, 2) \
+    OP(0x0B, IMP, XXX, 2) \
+    OP(0x0C, ABS, NOP, 4) \
+    OP(0x0D, ABS, ORA, 4) \
+    OP(0x0E, ABS, ASL, 6) \
+    OP(0x0F, ABS, SLO, 6) \
+    \
+    OP(0x10, REL, BPL, 2) \
+    OP(0x11, IZY, ORA, 5) \
+    OP(0x12, IMP, XXX, 2) \
+    OP(0x13, IZY, SLO, 8) \
+    OP(0x14, ZPX, NOP, 4) \
+    OP(0x15, ZPX, ORA, 4) \
+    OP(0x16, ZPX, ASL, 6) \
+    OP(0x17, ZPX, SLO, 6) \
+    OP(0x18, IMP, CLC, 2) \
+    OP(0x19, ABY, ORA, 4) \
+    OP(0x1A, IMP, NOP, 2) \
+    OP(0x1B, ABY, SLO, 7) \
+    OP(0x1C, ABX, NOP, 4) \
+    OP(0x1D, ABX, ORA, 4) \
+    OP(0x1E, ABX, ASL, 7) \
+    OP(0x1F, ABX, SLO, 7) \
+    \
+    OP(0x20, ABS, JSR, 6) \
+    OP(0x21, IZX, AND, 6) \
+    OP(0x22, IMP, XXX, 2) \
+    OP(0x23, IZX, RLA, 8) \
+    OP(0x24, ZP0, BIT, 3) \
+    OP(0x25, ZP0, AND, 3) \
+    OP(0x26, ZP0, ROL, 5) \
+    OP(0x27, ZP0, RLA, 5) \
+    OP(0x28, IMP, PLP, 4) \
+    OP(0x29, IMM, AND, 2) \
+    OP(0x2A, IMP, ROL, 2) \
+    OP(0x2B, IMM, ANC, 2) \
+    OP(0x2C, ABS, BIT, 4) \
+    OP(0x2D, ABS, AND, 4) \
+    OP(0x2E, ABS, ROL, 6) \
+    OP(0x2F, ABS, RLA, 6) \
+    \
+    OP(0x30, REL, BMI, 2) \
+    OP(0x31, IZY, AND, 5) \
+    OP(0x32, IMP, XXX, 2) \
+    OP(0x33, IZY, RLA, 8) \
+    OP(0x34, ZPX, NOP, 4) \
+    OP(0x35, ZPX, AND, 4) \
+    OP(0x36, ZPX, ROL, 6) \
+    OP(0x37, ZPX, RLA, 6) \
+    OP(0x38, IMP, SEC, 2) \
+    OP(0x39, ABY, AND, 4) \
+    OP(0x3A, IMP, NOP, 2) \
+    OP(0x3B, ABY, RLA, 7) \
+    OP(0x3C, ABX, NOP, 4) \
+    OP(0x3D, ABX, AND, 4) \
+    OP(0x3E, ABX, ROL, 7) \
+    OP(0x3F, ABX, RLA, 7) \
+    \
+    OP(0x40, IMP, RTI, 6) \
+    OP(0x41, IZX, EOR, 6) \
+    OP(0x42, IMP, XXX, 2) \
+    OP(0x43, IZX, SRE, 8) \
+    OP(0x44, ZP0, NOP, 3) \
+    OP(0x45, ZP0, EOR, 3) \
+    OP(0x46, ZP0, LSR, 5) \
+    OP(0x47, ZP0, SRE, 5) \
+    OP(0x48, IMP, PHA, 3) \
+    OP(0x49, IMM, EOR, 2) \
+    OP(0x4A, IMP, LSR, 2) \
+    OP(0x4B, IMP, XXX, 2) \
+    OP(0x4C, ABS, JMP, 3) \
+    OP(0x4D, ABS, EOR, 4) \
+    OP(0x4E, ABS, LSR, 6) \
+    OP(0x4F, ABS, SRE, 6) \
+    \
+    OP(0x50, REL, BVC, 2) \
+    OP(0x51, IZY, EOR, 5) \
+    OP(0x52, IMP, XXX, 2) \
+    OP(0x53, IZY, SRE, 8) \
+    OP(0x54, ZPX, NOP, 4) \
+    OP(0x55, ZPX, EOR, 4) \
+    OP(0x56, ZPX, LSR, 6) \
+    OP(0x57, ZPX, SRE, 6) \
+    OP(0x58, IMP, CLI, 2) \
+    OP(0x59, ABY, EOR, 4) \
+    OP(0x5A, IMP, NOP, 2) \
+    OP(0x5B, ABY, SRE, 7) \
+    OP(0x5C, ABX, NOP, 4) \
+    OP(0x5D, ABX, EOR, 4) \
+    OP(0x5E, ABX, LSR, 7) \
+    OP(0x5F, ABX, SRE, 7) \
+    \
+    OP(0x60, IMP, RTS, 6) \
+    OP(0x61, IZX, ADC, 6) \
+    OP(0x62, IMP, XXX, 2) \
+    OP(0x63, IZX, RRA, 8) \
+    OP(0x64, ZP0, NOP, 3) \
+    OP(0x65, ZP0, ADC, 3) \
+    OP(0x66, ZP0, ROR, 5) \
+    OP(0x67, ZP0, RRA, 5) \
+    OP(0x68, IMP, PLA, 4) \
+    OP(0x69, IMM, ADC, 2) \
+    OP(0x6A, IMP, ROR, 2) \
+    OP(0x6B, IMP, XXX, 2) \
+    OP(0x6C, IND, JMP, 5) \
+    OP(0x6D, ABS, ADC, 4) \
+    OP(0x6E, ABS, ROR, 6) \
+    OP(0x6F, ABS, RRA, 6) \
+    \
+    OP(0x70, REL, BVS, 2) \
+    OP(0x71, IZY, ADC, 5) \
+    OP(0x72, IMP, XXX, 2) \
+    OP(0x73, IZY, RRA, 8) \
+    OP(0x74, ZPX, NOP, 4) \
+    OP(0x75, ZPX, ADC, 4) \
+    OP(0x76, ZPX, ROR, 6) \
+    OP(0x77, ZPX, RRA, 6) \
+    OP(0x78, IMP, SEI, 2) \
+    OP(0x79, ABY, ADC, 4) \
+    OP(0x7A, IMP, NOP, 2) \
+    OP(0x7B, ABY, RRA, 7) \
+    OP(0x7C, ABX, NOP, 4) \
+    OP(0x7D, ABX, ADC, 4) \
+    OP(0x7E, ABX, ROR, 7) \
+    OP(0x7F, ABX, RRA, 7) \
+    \
+    OP(0x80, IMM, NOP, 2) \
+    OP(0x81, IZX, STA, 6) \
+    OP(0x82, IMP, NOP, 2) \
+    OP(0x83, IZX, SAX, 6) \
+    OP(0x84, ZP0, STY, 3) \
+    OP(0x85, ZP0, STA, 3) \
+    OP(0x86, ZP0, STX, 3) \
+    OP(0x87, ZP0, SAX, 3) \
+    OP(0x88, IMP, DEY, 2) \
+    OP(0x89, IMP, NOP, 2) \
+    OP(0x8A, IMP, TXA, 2) \
+    OP(0x8B, IMP, XXX, 2) \
+    OP(0x8C, ABS, STY, 4) \
+    OP(0x8D, ABS, STA, 4) \
+    OP(0x8E, ABS, STX, 4) \
+    OP(0x8F, ABS, SAX, 4) \
+    \
+    OP(0x90, REL, BCC, 2) \
+    OP(0x91, IZY, STA, 6) \
+    OP(0x92, IMP, XXX, 2) \
+    OP(0x93, IMP, XXX, 6) \
+    OP(0x94, ZPX, STY, 4) \
+    OP(0x95, ZPX, STA, 4) \
+    OP(0x96, ZPY, STX, 4) \
+    OP(0x97, ZPY, SAX, 4) \
+    OP(0x98, IMP, TYA, 2) \
+    OP(0x99, ABY, STA, 5) \
+    OP(0x9A, IMP, TXS, 2) \
+    OP(0x9B, IMP, XXX, 5) \
+    OP(0x9C, IMP, NOP, 5) \
+    OP(0x9D, ABX, STA, 5) \
+    OP(0x9E, IMP, XXX, 5) \
+    OP(0x9F, IMP, XXX, 5) \
+    \
+    OP(0xA0, IMM, LDY, 2) \
+    OP(0xA1, IZX, LDA, 6) \
+    OP(0xA2, IMM, LDX, 2) \
+    OP(0xA3, IZX, LAX, 6) \
+    OP(0xA4, ZP0, LDY, 3) \
+    OP(0xA5, ZP0, LDA, 3) \
+    OP(0xA6, ZP0, LDX, 3) \
+    OP(0xA7, ZP0, LAX, 3) \
+    OP(0xA8, IMP, TAY, 2) \
+    OP(0xA9, IMM, LDA, 2) \
+    OP(0xAA, IMP, TAX, 2) \
+    OP(0xAB, IMP, XXX, 2) \
+    OP(0xAC, ABS, LDY, 4) \
+    OP(0xAD, ABS, LDA, 4) \
+    OP(0xAE, ABS, LDX, 4) \
+    OP(0xAF, ABS, LAX, 4) \
+    \
+    OP(0xB0, REL, BCS, 2) \
+    OP(0xB1, IZY, LDA, 5) \
+    OP(0xB2, IMP, XXX, 2) \
+    OP(0xB3, IZY, LAX, 5) \
+    OP(0xB4, ZPX, LDY, 4) \
+    OP(0xB5, ZPX, LDA, 4) \
+    OP(0xB6, ZPY, LDX, 4) \
+    OP(0xB7, ZPY, LAX, 4) \
+    OP(0xB8, IMP, CLV, 2) \
+    OP(0xB9, ABY, LDA, 4) \
+    OP(0xBA, IMP, TSX, 2) \
+    OP(0xBB, IMP, XXX, 4) \
+    OP(0xBC, ABX, LDY, 4) \
+    OP(0xBD, ABX, LDA, 4) \
+    OP(0xBE, ABY, LDX, 4) \
+    OP(0xBF, ABY, LAX, 4) \
+    \
+    OP(0xC0, IMM, CPY, 2) \
+    OP(0xC1, IZX, CMP, 6) \
+    OP(0xC2, IMP, NOP, 2) \
+    OP(0xC3, IZX, DCP, 8) \
+    OP(0xC4, ZP0, CPY, 3) \
+    OP(0xC5, ZP0, CMP, 3) \
+    OP(0xC6, ZP0, DEC, 5) \
+    OP(0xC7, ZP0, DCP, 5) \
+    OP(0xC8, IMP, INY, 2) \
+    OP(0xC9, IMM, CMP, 2) \
+    OP(0xCA, IMP, DEX, 2) \
+    OP(0xCB, IMP, XXX, 2) \
+    OP(0xCC, ABS, CPY, 4) \
+    OP(0xCD, ABS, CMP, 4) \
+    OP(0xCE, ABS, DEC, 6) \
+    OP(0xCF, ABS, DCP, 6) \
+    \
+    OP(0xD0, REL, BNE, 2) \
+    OP(0xD1, IZY, CMP, 5) \
+    OP(0xD2, IMP, XXX, 2) \
+    OP(0xD3, IZY, DCP, 8) \
+    OP(0xD4, ZPX, NOP, 4) \
+    OP(0xD5, ZPX, CMP, 4) \
+    OP(0xD6, ZPX, DEC, 6) \
+    OP(0xD7, ZPX, DCP, 6) \
+    OP(0xD8, IMP, CLD, 2) \
+    OP(0xD9, ABY, CMP, 4) \
+    OP(0xDA, IMP, NOP, 2) \
+    OP(0xDB, ABY, DCP, 7) \
+    OP(0xDC, ABX, NOP, 4) \
+    OP(0xDD, ABX, CMP, 4) \
+    OP(0xDE, ABX, DEC, 7) \
+    OP(0xDF, ABX, DCP, 7) \
+    \
+    OP(0xE0, IMM, CPX, 2) \
+    OP(0xE1, IZX, SBC, 6) \
+    OP(0xE2, IMP, NOP, 2) \
+    OP(0xE3, IZX, ISB, 8) \
+    OP(0xE4, ZP0, CPX, 3) \
+    OP(0xE5, ZP0, SBC, 3) \
+    OP(0xE6, ZP0, INC, 5) \
+    OP(0xE7, ZP0, ISB, 5) \
+    OP(0xE8, IMP, INX, 2) \
+    OP(0xE9, IMM, SBC, 2) \
+    OP(0xEA, IMP, NOP, 2) \
+    OP(0xEB, IMM, SBC, 2) \
+    OP(0xEC, ABS, CPX, 4) \
+    OP(0xED, ABS, SBC, 4) \
+    OP(0xEE, ABS, INC, 6) \
+    OP(0xEF, ABS, ISB, 6) \
+    \
+    OP(0xF0, REL, BEQ, 2) \
+    OP(0xF1, IZY, SBC, 5) \
+    OP(0xF2, IMP, XXX, 2) \
+    OP(0xF3, IZY, ISB, 8) \
+    OP(0xF4, ZPX, NOP, 4) \
+    OP(0xF5, ZPX, SBC, 4) \
+    OP(0xF6, ZPX, INC, 6) \
+    OP(0xF7, ZPX, ISB, 6) \
+    OP(0xF8, IMP, SED, 2) \
+    OP(0xF9, ABY, SBC, 4) \
+    OP(0xFA, IMP, NOP, 2) \
+    OP(0xFB, ABY, ISB, 7) \
+    OP(0xFC, ABX, NOP, 4) \
+    OP(0xFD, ABX, SBC, 4) \
+    OP(0xFE, ABX, INC, 7) \
+    OP(0xFF, ABX, ISB, 7)
+
+#endif //C64_OPCODES_HPP
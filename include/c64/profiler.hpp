@@ -0,0 +1,80 @@
+#ifndef C64_PROFILER_HPP
+#define C64_PROFILER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// Calls from one routine to another, `cycles` includes everything the callee
+/// ran before it returned
+struct CallEdge {
+    uint32_t caller; // entry address of the calling routine, Profiler::root outside of any
+    uint16_t callee;
+    bool interrupt;
+    uint64_t calls;
+    uint64_t cycles;
+};
+
+/// Counts the instructions run and the cycles they took per PC, and
+/// optionally a call graph from JSR/RTS, BRK/RTI and interrupts. Every
+/// instruction is counted, there is no sampling.
+class Profiler {
+public:
+    static constexpr uint32_t root = 0x10000;
+
+    explicit Profiler(bool call_graph = false);
+
+    /// The instruction at `pc` ran in `cycles` and left the PC at `next_pc`
+    void record(uint16_t pc, uint8_t opcode, uint8_t cycles, uint16_t next_pc) {
+        instruction_counts[pc]++;
+        cycle_counts[pc] += cycles;
+        total += cycles;
+        if (call_graph) {
+            follow_call(pc, opcode, next_pc);
+        }
+    }
+
+    /// An interrupt taken at `pc` entered `handler`, its cycles count there
+    void interrupt(uint16_t pc, uint16_t handler, uint8_t cycles);
+
+    void clear();
+
+    [[nodiscard]] uint64_t instructions(uint16_t pc) const { return instruction_counts[pc]; }
+
+    [[nodiscard]] uint64_t cycles(uint16_t pc) const { return cycle_counts[pc]; }
+
+    [[nodiscard]] uint64_t total_cycles() const { return total; }
+
+    [[nodiscard]] bool has_call_graph() const { return call_graph; }
+
+    /// Calls that returned, by caller and callee. Calls still on the stack are
+    /// not in here yet.
+    [[nodiscard]] std::vector<CallEdge> call_edges() const;
+
+private:
+    struct Frame {
+        uint64_t edge;      // key into `edges`
+        uint16_t return_to; // the PC RTS or RTI comes back to
+        uint64_t entered;
+    };
+
+    // deeper than the 6502 stack can go, the oldest frames are dropped
+    static constexpr size_t max_depth = 256;
+
+    std::unique_ptr<uint64_t[]> instruction_counts;
+    std::unique_ptr<uint64_t[]> cycle_counts;
+    uint64_t total = 0;
+
+    bool call_graph;
+    std::vector<Frame> stack;
+    std::unordered_map<uint64_t, CallEdge> edges;
+
+    void follow_call(uint16_t pc, uint8_t opcode, uint16_t next_pc);
+
+    void enter(uint16_t callee, uint16_t return_to, bool interrupt);
+
+    void leave(uint16_t return_to);
+};
+
+#endif //C64_PROFILER_HPP
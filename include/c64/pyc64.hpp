@@ -4,16 +4,71 @@
 
 #include "c64.hpp"
 
+#include <pybind11/numpy.h>
+#include <pybind11/pytypes.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
 class pyC64 {
     C64 c64;
+    bool ram_shared = false; // the `ram` array has been handed out
+
+    /// Catches up with whatever Python wrote through the `ram` array
+    void sync_ram();
 
 public:
     pyC64();
     bool clock();
+    uint32_t step_instruction();
+    uint64_t run_cycles(uint64_t cycles);
+    uint64_t run_until_pc(uint16_t addr, uint64_t max_cycles);
+    uint64_t run_frames(uint64_t frames);
     void reset();
-    [[nodiscard]] const CPU6502 & cpu() const;
+    /// See C64::set_dispatch
+    void set_dispatch(Dispatch dispatch);
+    pybind11::bytes save_state() const;
+    void load_state(pybind11::bytes const &state);
+    [[nodiscard]] const CPU6502Base & cpu() const;
     std::string disassemble(uint16_t addr);
-};
 
+    /// `condition` is a callable without arguments or None, see C64::add_breakpoint
+    int add_breakpoint(uint16_t addr, pybind11::object const &condition);
+    int add_watchpoint(uint16_t first, uint16_t last, Access access, pybind11::object const &condition);
+    bool remove_breakpoint(int id);
+    void clear_breakpoints();
+    [[nodiscard]] std::optional<BreakEvent> last_break() const;
+
+    void enable_profiler(bool call_graph);
+    void disable_profiler();
+    /// See c64tools::profile_report, empty when the profiler is off
+    std::string profile_report(size_t top);
+
+    /// The visible frame as palette indices, shape (272, 384), see VicII::frame
+    pybind11::array_t<uint8_t> frame();
+    /// The visible frame as RGBA, shape (272, 384, 4)
+    pybind11::array_t<uint8_t> frame_rgba();
+
+    /// The text screen as ASCII lines, see C64::render_text_screen
+    std::string screen_text();
+    /// The text screen as RGBA, shape (200, 320, 4), only changed cells are drawn
+    pybind11::array_t<uint8_t> screen_rgba();
+
+    /// See C64::set_key and C64::set_joystick
+    void set_key(uint8_t column, uint8_t row, bool pressed);
+    void set_joystick(int port, uint8_t lines);
+
+    /// See C64::enable_audio and C64::disable_audio
+    void enable_audio(uint32_t sample_rate);
+    void disable_audio();
+    /// The samples of C64::take_audio as int16
+    pybind11::array_t<int16_t> audio();
+
+    /// The storage behind the `ram` and ROM arrays, see C64::ram_data. Writes
+    /// through `ram` are picked up by the next run and by the text screen.
+    uint8_t *ram();
+    [[nodiscard]] RomSet const &roms() const;
+};
 
 #endif //C64_PYC64_HPP
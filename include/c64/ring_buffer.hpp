@@ -0,0 +1,56 @@
+#ifndef C64_RING_BUFFER_HPP
+#define C64_RING_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/// Lock-free ring buffer for exactly one producer thread and one consumer
+/// thread. The capacity is rounded up to a power of two.
+template<typename T>
+class RingBuffer {
+    static constexpr size_t cache_line = 64;
+
+    std::unique_ptr<T[]> items;
+    size_t mask;
+
+    alignas(cache_line) std::atomic<size_t> head = 0; // written by the producer
+    alignas(cache_line) std::atomic<size_t> tail = 0; // written by the consumer
+
+public:
+    explicit RingBuffer(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        items = std::make_unique<T[]>(size);
+        mask = size - 1;
+    }
+
+    [[nodiscard]] size_t capacity() const { return mask + 1; }
+
+    /// Producer side. Returns false if the buffer is full.
+    bool push(T const &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side. Moves up to `max` items to `out` and returns the count.
+    size_t pop(T *out, size_t max) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - t;
+        size_t count = available < max ? available : max;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = items[(t + i) & mask];
+        }
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+};
+
+#endif //C64_RING_BUFFER_HPP
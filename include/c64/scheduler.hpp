@@ -0,0 +1,62 @@
+#ifndef C64_SCHEDULER_HPP
+#define C64_SCHEDULER_HPP
+
+#include <cstdint>
+#include <optional>
+
+/// The chips that post events to a Scheduler
+enum class Device : uint8_t {
+    Vic,
+    Cia1,
+    Cia2
+};
+
+/// The next event of every device, a binary min-heap of deadlines on the
+/// CPU clock. A device has at most one event queued, posting again moves it.
+///
+/// The CPU runs uninterrupted up to next() and devices are only brought up
+/// to the clock when their event is due or when they are accessed, so an
+/// instruction boundary with nothing due costs a single compare.
+class Scheduler {
+public:
+    static constexpr int device_count = 3;
+
+    static constexpr uint64_t never = UINT64_MAX;
+
+    Scheduler();
+
+    /// Queues the event of `device` at `due`, replacing the one it had.
+    /// `never` takes it out of the queue.
+    void post(Device device, uint64_t due);
+
+    /// The earliest deadline, `never` when nothing is queued
+    [[nodiscard]] uint64_t next() const { return size > 0 ? heap[0].due : never; }
+
+    /// Takes the earliest event off the queue if it is due by `now`
+    std::optional<Device> pop(uint64_t now);
+
+    /// When the event of `device` is due, `never` if it has none
+    [[nodiscard]] uint64_t due(Device device) const;
+
+    void clear();
+
+private:
+    struct Event {
+        uint64_t due;
+        Device device;
+    };
+
+    Event heap[device_count];
+    int size = 0;
+    int position[device_count]; // index into heap, -1 when not queued
+
+    void place(int index, Event event);
+
+    void sift_up(int index);
+
+    void sift_down(int index);
+
+    void remove(int index);
+};
+
+#endif //C64_SCHEDULER_HPP
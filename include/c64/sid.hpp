@@ -0,0 +1,162 @@
+#ifndef C64_SID_HPP
+#define C64_SID_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// A MOS 6581 SID: three voices (oscillator, waveform, ADSR envelope), the
+/// state-variable filter and the volume. Like the other chips it runs behind
+/// the CPU and is brought up to its clock with run_until(), which works in
+/// steps of 8 cycles and in blocks of steps rather than cycle by cycle.
+///
+/// Audio is only rendered once set_sample_rate() asked for it. Voices are
+/// rendered a block at a time at clock_rate / 8 (about 123 kHz), filtered and
+/// mixed, then brought down to the output rate by a polyphase resampler. The
+/// 6581's combined waveforms are approximated by ANDing them, its filter
+/// curve by a straight line, and the ADSR delay bug is not there.
+class Sid {
+public:
+    /// PAL φ2
+    static constexpr uint64_t clock_rate = 985248;
+
+    /// Cycles per internal sample. Register writes take effect on the step
+    /// boundary at or before the clock they were made at.
+    static constexpr uint32_t cycles_per_step = 8;
+
+    /// Steps rendered in one go
+    static constexpr int block_size = 64;
+
+    Sid();
+
+    /// Starts rendering audio at `rate` samples per second, 0 stops. The
+    /// voices run either way, for OSC3 and ENV3.
+    void set_sample_rate(uint32_t rate);
+
+    [[nodiscard]] uint32_t sample_rate() const { return output_rate; }
+
+    /// Moves the chip up to `now` and renders the audio on the way
+    void run_until(uint64_t now);
+
+    /// `reg` is the address within the chip, which repeats every 32 bytes.
+    /// Only POTX, POTY, OSC3 and ENV3 read back, the rest read 0.
+    [[nodiscard]] uint8_t read(uint8_t reg) const;
+
+    void write(uint8_t reg, uint8_t value);
+
+    /// The mono 16 bit samples rendered since the last call
+    [[nodiscard]] std::vector<int16_t> take_samples();
+
+    /// Samples waiting to be taken
+    [[nodiscard]] size_t available() const { return samples.size(); }
+
+    /// The registers, oscillators and envelopes. The filter and resampler
+    /// are part of the audio, not of the state.
+    struct State {
+        uint64_t clock;
+        uint32_t accumulator[3];
+        uint32_t noise[3];
+        uint16_t rate_counter[3];
+        uint8_t registers[0x20];
+        uint8_t level[3];
+        uint8_t envelope_state[3];
+        uint8_t exponential_counter[3];
+        uint8_t padding[9];
+    };
+
+    /// The state as of `now`, which may be ahead of the chip
+    [[nodiscard]] State save_state(uint64_t now) const;
+
+    void load_state(State const &state);
+
+private:
+    enum class EnvelopeState : uint8_t {
+        Attack,
+        DecaySustain,
+        Release
+    };
+
+    struct Voice {
+        uint32_t accumulator = 0; // 24 bits
+        uint32_t noise = 0x7FFFF8; // 23 bit shift register
+        uint16_t rate_counter = 0;
+        uint8_t level = 0;
+        uint8_t exponential_counter = 0;
+        EnvelopeState envelope_state = EnvelopeState::Release;
+
+        /// Whether the envelope holds its level, at the sustain level or at 0
+        [[nodiscard]] bool envelope_frozen(uint8_t sr) const;
+
+        /// Runs the envelope generator for one step, `ad` and `sr` are the
+        /// voice's registers
+        void step_envelope(uint8_t ad, uint8_t sr);
+
+        /// Clocks the noise shift register `count` times
+        void clock_noise(uint64_t count);
+
+        /// The 12 bit waveform output with `control`, `pw` and the
+        /// accumulator of the ring modulating voice
+        [[nodiscard]] uint16_t output(uint8_t control, uint16_t pw, uint32_t ring_source) const;
+    };
+
+    /// What the voices did in every step of a block, rendered by render()
+    struct Block {
+        uint32_t accumulator[3][block_size];
+        uint16_t noise[3][block_size]; // the noise waveform, if selected
+        uint8_t level[3][block_size];
+    };
+
+    /// The output side: filter, resampler and samples
+    struct Resampler {
+        static constexpr int taps = 64;
+        static constexpr int phases = 128;
+
+        uint64_t step = 0;     // input samples per output sample, 32.32 fixed point
+        uint64_t position = 0; // of the next output in `history`, 32.32 fixed point
+        std::vector<float> table; // phases x taps
+        std::vector<float> history;
+
+        void configure(double input_rate, double output_rate);
+
+        void push(float const *input, size_t count, std::vector<int16_t> &out);
+    };
+
+    uint64_t clock = 0;
+    uint8_t registers[0x20] = {};
+    Voice voices[3];
+
+    uint32_t output_rate = 0;
+    float low = 0.0f;  // filter state
+    float band = 0.0f;
+    Resampler resampler;
+    std::vector<int16_t> samples;
+
+    [[nodiscard]] uint32_t frequency(int voice) const { return registers[voice * 7] | registers[voice * 7 + 1] << 8; }
+
+    [[nodiscard]] uint16_t pulse_width(int voice) const {
+        return registers[voice * 7 + 2] | (registers[voice * 7 + 3] & 0x0F) << 8;
+    }
+
+    [[nodiscard]] uint8_t control(int voice) const { return registers[voice * 7 + 4]; }
+
+    /// Runs `state` for `steps` with the current registers. Records every
+    /// step in `block` when given, `steps` is at most block_size then.
+    /// Without a block and hard sync the oscillators jump ahead in one go,
+    /// the envelopes are always stepped until they hold their level.
+    void advance(Voice (&state)[3], uint64_t steps, Block *block) const;
+
+    /// Filters, mixes and resamples the `steps` recorded in `block`
+    void render(Block const &block, int steps);
+
+    /// Multiplies the waveform of `count` steps of a voice with its envelope,
+    /// `ring` are the accumulators of the ring modulating voice. Takes four
+    /// steps at a time with SSE2 where built, unless `vectorized` is false.
+    static void render_voice(uint32_t const *accumulators, uint32_t const *ring, uint16_t const *noise,
+                             uint8_t const *levels, uint8_t control, uint16_t pw, int count, int32_t *out,
+                             bool vectorized = true);
+};
+
+/// Writes mono 16 bit PCM `samples` to a WAV file at `path`
+void write_wav(std::string const &path, std::vector<int16_t> const &samples, uint32_t sample_rate);
+
+#endif //C64_SID_HPP
@@ -0,0 +1,37 @@
+#ifndef C64_SYMBOLS_HPP
+#define C64_SYMBOLS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RomSet;
+
+struct Symbol {
+    uint16_t addr;
+    uint16_t size; // 0 reaches up to the next symbol in the same 8 KB block
+    std::string name;
+};
+
+/// Names for code addresses, used to turn a PC into e.g. "CHROUT+3"
+class SymbolTable {
+public:
+    /// The routines behind the KERNAL jump table and vectors, BASIC's
+    /// statement and function dispatch tables and CHRGET. The addresses are
+    /// read from `roms`, so they follow patched ROMs.
+    static SymbolTable c64(RomSet const &roms);
+
+    /// Keeps the first name given to an address
+    void add(uint16_t addr, std::string name, uint16_t size = 0);
+
+    /// The symbol covering `addr`, or null
+    [[nodiscard]] Symbol const *find(uint16_t addr) const;
+
+    /// "NAME" or "NAME+offset" when a symbol covers `addr`, "$XXXX" otherwise
+    [[nodiscard]] std::string describe(uint16_t addr) const;
+
+private:
+    std::vector<Symbol> symbols; // sorted by address
+};
+
+#endif //C64_SYMBOLS_HPP
@@ -0,0 +1,79 @@
+#ifndef C64_TEXT_SCREEN_HPP
+#define C64_TEXT_SCREEN_HPP
+
+#include "vic_ii.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// The 40x25 character screen, as an RGBA image that is kept up to date
+/// cell by cell. The owner reports writes to screen and color RAM with
+/// written() and update() draws only the cells marked since the last one,
+/// so a screen where just the cursor blinks costs a cell or two per frame.
+///
+/// Only standard text mode is drawn, the border is left out. Changes to a
+/// character set in RAM are not tracked, see mark_all().
+class TextScreen {
+public:
+    static constexpr int columns = 40;
+    static constexpr int rows = 25;
+    static constexpr int cells = columns * rows;
+    static constexpr int width = columns * 8;
+    static constexpr int height = rows * 8;
+    static constexpr uint16_t color_ram = 0xD800;
+
+    /// Where the VIC-II takes the screen from
+    struct Source {
+        uint16_t screen;    // screen RAM in the CPU's address space
+        uint16_t chars;     // the character set within the VIC-II's bank
+        uint8_t background; // $D021
+    };
+
+    TextScreen();
+
+    /// Marks the cell at `addr` if it is in screen or color RAM
+    void written(uint16_t addr) {
+        uint16_t offset = addr - source.screen;
+        if (offset >= cells) {
+            offset = addr - color_ram;
+            if (offset >= cells) {
+                return;
+            }
+        }
+        dirty[offset >> 6] |= uint64_t(1) << (offset & 63);
+    }
+
+    void mark_all();
+
+    /// Draws the marked cells, or all of them when `from` differs from the
+    /// last update. Returns the number of cells drawn.
+    size_t update(VicMemory const &memory, Source const &from);
+
+    /// The screen RAM the last update() read, written() watches it
+    [[nodiscard]] uint16_t screen_address() const { return source.screen; }
+
+    /// width x height pixels, 4 bytes each
+    [[nodiscard]] uint8_t const *rgba() const { return pixels.data(); }
+
+    /// The screen codes as of the last update
+    [[nodiscard]] uint8_t const *codes() const { return screen; }
+
+    /// The screen as PETSCII, rows ending in RETURN ($0D). Reversed
+    /// characters come out as their plain code.
+    [[nodiscard]] std::string petscii() const;
+
+    /// The screen as ASCII, rows ending in '\n'. Graphics characters become
+    /// '?' and letters are upper case.
+    [[nodiscard]] std::string ascii() const;
+
+private:
+    Source source{0x0400, 0x1000, 6};
+    uint64_t dirty[(cells + 63) / 64];
+    uint8_t screen[cells];
+    std::vector<uint8_t> pixels;
+
+    void draw(int cell, VicMemory const &memory);
+};
+
+#endif //C64_TEXT_SCREEN_HPP
@@ -0,0 +1,70 @@
+#ifndef C64_THREAD_POOL_HPP
+#define C64_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work-stealing thread pool. Every worker has its own queue and takes work
+/// from the back of it, an idle worker steals from the front of the others.
+/// Each queue has its own lock, the pool's lock is only taken to put an idle
+/// worker to sleep, to wake one up and to wait for the tasks to finish.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// Zero threads means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+    void submit(Task task);
+
+    /// Blocks until every submitted task has finished. Rethrows the first
+    /// exception a task threw since the previous wait(), the other tasks
+    /// run to the end either way.
+    void wait();
+
+    /// Runs fn(0) ... fn(count - 1) on the pool and waits for all of them,
+    /// see wait()
+    void parallel_for(size_t count, std::function<void(size_t)> const &fn);
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue = 0;
+
+    std::atomic<size_t> queued = 0;     // tasks in the queues
+    std::atomic<size_t> unfinished = 0; // tasks submitted and not done
+    std::atomic<size_t> sleeping = 0;   // workers waiting for work
+
+    std::mutex state_lock;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    bool stopping = false;
+    std::exception_ptr error; // the first one since wait()
+
+    void work(size_t index);
+
+    bool take(size_t index, Task &task);
+};
+
+#endif //C64_THREAD_POOL_HPP
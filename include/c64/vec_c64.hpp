@@ -0,0 +1,54 @@
+#ifndef C64_VEC_C64_HPP
+#define C64_VEC_C64_HPP
+
+#include "c64.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// A number of machines stepped together on a thread pool, e.g. the
+/// environments of a reinforcement learning run. Observations are written
+/// stacked with one row per machine, pyc64 hands them out as NumPy arrays.
+class VecC64 {
+public:
+    static constexpr size_t screen_size = 1000;
+    static constexpr size_t register_count = 6;
+
+    /// Zero threads means one per hardware thread
+    explicit VecC64(size_t count, size_t threads = 0);
+
+    [[nodiscard]] size_t size() const { return machines.size(); }
+
+    C64 &operator[](size_t index) { return *machines[index]; }
+
+    void reset();
+
+    /// Puts every machine in the state saved by C64::save_state
+    void load_state(std::vector<uint8_t> const &state);
+
+    /// Puts machine i in states[i], one state per machine
+    void load_states(std::vector<std::vector<uint8_t>> const &states);
+
+    /// Runs every machine for `cycles`, see C64::run_for_cycles. A machine
+    /// that fails is reported once all are done, naming the first one.
+    void step(uint64_t cycles);
+
+    /// The screen RAM ($0400-$07E7) of every machine, size() * screen_size bytes
+    void screens(uint8_t *out) const;
+
+    /// The frame of every machine as palette indices, one VicII::frame after
+    /// the other
+    void frames(uint8_t *out);
+
+    /// A, X, Y, SP, P and PC of every machine, size() * register_count values
+    void registers(uint16_t *out) const;
+
+private:
+    std::vector<std::unique_ptr<C64>> machines;
+    ThreadPool pool;
+};
+
+#endif //C64_VEC_C64_HPP
@@ -0,0 +1,119 @@
+#ifndef C64_VIC_II_HPP
+#define C64_VIC_II_HPP
+
+#include <cstdint>
+#include <vector>
+
+/// The 16 KB the VIC-II sees, as page pointers, with the character ROM at
+/// $1000-$1FFF in banks 0 and 2. Color RAM is its own 1 KB of nybbles.
+struct VicMemory {
+    const uint8_t *pages[0x40];
+    const uint8_t *color[4];
+
+    [[nodiscard]] uint8_t read(uint16_t addr) const { return pages[(addr >> 8) & 0x3F][addr & 0xFF]; }
+
+    [[nodiscard]] uint8_t color_at(uint16_t offset) const { return color[(offset >> 8) & 3][offset & 0xFF] & 0x0F; }
+};
+
+/// The PAL VIC-II (6569): 312 raster lines of 63 cycles. The beam is not
+/// clocked along with the CPU, the owner runs it up to the current cycle
+/// with run_until() before touching a register and whenever it needs the
+/// frame. Each line is rendered in one go once the beam has left it, with
+/// the registers as they were then, into a frame of palette indices.
+///
+/// Bad lines and sprite DMA do not steal cycles from the CPU.
+class VicII {
+public:
+    static constexpr int cycles_per_line = 63;
+    static constexpr int lines_per_frame = 312;
+    static constexpr uint64_t cycles_per_frame = cycles_per_line * lines_per_frame;
+
+    /// The visible part of the frame: the 320x200 display window and the
+    /// border around it, raster lines 16 to 287
+    static constexpr int frame_width = 384;
+    static constexpr int frame_height = 272;
+    static constexpr int first_visible_line = 16;
+
+    /// RGB of each of the 16 colors
+    static const uint8_t palette[16][3];
+
+    VicII();
+
+    /// Moves the beam up to `now`, the clock it started at being cycle 0 of
+    /// line 0. Lines it reaches may raise the raster interrupt, lines it
+    /// leaves are rendered from `memory` (only read when a line is left, see
+    /// renders_by()).
+    void run_until(uint64_t now, VicMemory const &memory);
+
+    /// Whether run_until(now) renders anything
+    [[nodiscard]] bool renders_by(uint64_t now) const { return (next_render + 1) * cycles_per_line <= now; }
+
+    /// The clock at which the raster interrupt is next raised, UINT64_MAX if
+    /// it is disabled. Only valid right after run_until().
+    [[nodiscard]] uint64_t next_irq() const;
+
+    /// Whether the IRQ line is held low
+    [[nodiscard]] bool irq() const { return (irq_latch & registers[0x1A] & 0x0F) != 0; }
+
+    /// `reg` is the address within $D000-$D03F, the register file repeats
+    /// every 64 bytes. Reading the collision registers clears them unless
+    /// `read_only`.
+    uint8_t read(uint8_t reg, uint64_t now, bool read_only);
+
+    void write(uint8_t reg, uint8_t value, uint64_t now);
+
+    /// The raster line the beam is on at `now`
+    [[nodiscard]] static int raster_line(uint64_t now) { return static_cast<int>(now / cycles_per_line % lines_per_frame); }
+
+    /// frame_width x frame_height palette indices, line by line. Lines the
+    /// beam has not left yet still hold the previous frame, or black.
+    [[nodiscard]] uint8_t const *frame() const;
+
+    /// The frame as RGBA, 4 bytes a pixel
+    void frame_rgba(uint8_t *out) const;
+
+    /// Frames the beam has completed
+    [[nodiscard]] uint64_t frames() const { return next_render / lines_per_frame; }
+
+    /// What a snapshot keeps, the beam position follows from the clock
+    struct State {
+        uint8_t registers[0x40];
+        uint8_t irq_latch;
+        uint8_t sprite_sprite;
+        uint8_t sprite_data;
+        uint8_t padding[5];
+    };
+
+    /// The state as of `now`, which may be ahead of the beam
+    [[nodiscard]] State save_state(uint64_t now) const;
+
+    /// Restores registers and puts the beam at `now` without rendering or
+    /// raising anything for the lines in between
+    void load_state(State const &state, uint64_t now);
+
+private:
+    uint8_t registers[0x40];
+    uint8_t irq_latch = 0;     // $D019 bits 0-3
+    uint8_t sprite_sprite = 0; // $D01E
+    uint8_t sprite_data = 0;   // $D01F
+
+    uint64_t next_line = 0;   // the next line whose start raises the raster interrupt
+    uint64_t next_render = 0; // the next line to render, counted from power on
+
+    std::vector<uint8_t> framebuffer; // allocated by the first line rendered
+
+    [[nodiscard]] int raster_compare() const { return registers[0x12] | (registers[0x11] & 0x80) << 1; }
+
+    void raise(uint8_t bits) { irq_latch |= bits; }
+
+    /// The raster interrupt bit if the beam raises it on its way to `now`
+    [[nodiscard]] uint8_t raster_raised_by(uint64_t now) const;
+
+    void render_line(int raster, VicMemory const &memory);
+
+    void render_graphics(int raster, VicMemory const &memory, uint8_t *line, uint8_t *foreground) const;
+
+    void render_sprites(int raster, VicMemory const &memory, uint8_t *line, uint8_t const *foreground);
+};
+
+#endif //C64_VIC_II_HPP
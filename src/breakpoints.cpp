@@ -0,0 +1,74 @@
+#include "c64/breakpoints.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr uint8_t kind_bit(BreakKind kind) {
+    return 1u << static_cast<uint8_t>(kind);
+}
+
+int Breakpoints::add_breakpoint(uint16_t addr, BreakCondition condition) {
+    points.push_back({next_id, addr, addr, kind_bit(BreakKind::Breakpoint), std::move(condition)});
+    rebuild();
+    return next_id++;
+}
+
+int Breakpoints::add_watchpoint(uint16_t first, uint16_t last, Access access, BreakCondition condition) {
+    if (first > last) {
+        throw std::out_of_range("watchpoint range ends before it starts");
+    }
+    uint8_t kinds = 0;
+    if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Read)) {
+        kinds |= kind_bit(BreakKind::Read);
+    }
+    if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Write)) {
+        kinds |= kind_bit(BreakKind::Write);
+    }
+    points.push_back({next_id, first, last, kinds, std::move(condition)});
+    rebuild();
+    return next_id++;
+}
+
+bool Breakpoints::remove(int id) {
+    auto it = std::find_if(points.begin(), points.end(), [id](Point const &point) { return point.id == id; });
+    if (it == points.end()) {
+        return false;
+    }
+    points.erase(it);
+    rebuild();
+    return true;
+}
+
+std::optional<BreakEvent> Breakpoints::match(C64 &c64, BreakKind kind, uint16_t addr, uint8_t value) const {
+    for (auto const &point: points) {
+        if ((point.kinds & kind_bit(kind)) && point.first <= addr && addr <= point.last &&
+            (!point.condition || point.condition(c64))) {
+            return BreakEvent{kind, point.id, addr, value};
+        }
+    }
+    return std::nullopt;
+}
+
+void Breakpoints::rebuild() {
+    std::memset(exec_bits, 0, sizeof(exec_bits));
+    std::memset(read_bits, 0, sizeof(read_bits));
+    std::memset(write_bits, 0, sizeof(write_bits));
+    std::memset(watched_pages, 0, sizeof(watched_pages));
+
+    for (auto const &point: points) {
+        for (uint32_t addr = point.first; addr <= point.last; addr++) {
+            if (point.kinds & kind_bit(BreakKind::Breakpoint)) {
+                exec_bits[addr >> 3] |= 1u << (addr & 7);
+            }
+            if (point.kinds & kind_bit(BreakKind::Read)) {
+                read_bits[addr >> 3] |= 1u << (addr & 7);
+                watched_pages[addr >> 8] = true;
+            }
+            if (point.kinds & kind_bit(BreakKind::Write)) {
+                write_bits[addr >> 3] |= 1u << (addr & 7);
+                watched_pages[addr >> 8] = true;
+            }
+        }
+    }
+}
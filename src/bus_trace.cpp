@@ -0,0 +1,57 @@
+#include "c64/bus_trace.hpp"
+#include <fmt/format.h>
+
+#include <chrono>
+
+const char *bus_region_name(BusRegion region) {
+    switch (region) {
+        case BusRegion::CPUPort: return "CPU IO";
+        case BusRegion::VIC: return "VIC-II";
+        case BusRegion::SID: return "SID";
+        case BusRegion::ColorRAM: return "COLOR RAM";
+        case BusRegion::CIA1: return "CIA 1";
+        case BusRegion::CIA2: return "CIA 2";
+        case BusRegion::IO1: return "I/O 1";
+        case BusRegion::IO2: return "I/O 2";
+        default: return "RAM";
+    }
+}
+
+void BusTracer::print_record(FILE *out, BusTraceRecord const &record) {
+    auto region = bus_region_name(record.region);
+    if (record.write) {
+        fmt::print(out, "{:>10} [{}] Writing I/O: ${:04X} <- {:02X}\n", record.cycle, region, record.addr, record.value);
+    } else {
+        fmt::print(out, "{:>10} [{}] Reading I/O: ${:04X} -> {:02X}\n", record.cycle, region, record.addr, record.value);
+    }
+}
+
+BusTracer::BusTracer(FILE *out, size_t capacity) :
+        BusTracer([out](BusTraceRecord const &record) { print_record(out, record); }, capacity) {
+}
+
+BusTracer::BusTracer(Consumer consumer, size_t capacity) :
+        ring(capacity), consumer(std::move(consumer)) {
+    drain_thread = std::thread([this] {
+        while (running.load(std::memory_order_acquire)) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+}
+
+BusTracer::~BusTracer() {
+    running.store(false, std::memory_order_release);
+    drain_thread.join();
+    while (drain() > 0) {}
+}
+
+size_t BusTracer::drain() {
+    BusTraceRecord batch[256];
+    size_t count = ring.pop(batch, 256);
+    for (size_t i = 0; i < count; i++) {
+        consumer(batch[i]);
+    }
+    return count;
+}
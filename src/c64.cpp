@@ -1,101 +1,996 @@
 #include "c64/c64.hpp"
+#include "c64/cpu_6502_impl.hpp"
 #include "c64/basic.hpp"
 #include "c64/kernal.hpp"
 #include "c64/characters.hpp"
 
-C64::C64() : ram{} {
-    std::copy(std::begin(basic_bin), std::end(basic_bin), std::begin(basic_rom));
-    std::copy(std::begin(chars_bin), std::end(chars_bin), std::begin(char_rom));
-    std::copy(std::begin(kernal_bin), std::end(kernal_bin), std::begin(kernal_rom));
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+// stamped with the cycle of the access, like the devices see it
+#ifdef C64_BUS_TRACE
+#define C64_TRACE_BUS(addr, value, write) \
+    do { if (tracer != nullptr) tracer->record(bus_clock(), addr, value, write); } while (0)
+#else
+#define C64_TRACE_BUS(addr, value, write) do {} while (0)
+#endif
+
+// The memory layout for each of the 8 LORAM/HIRAM/CHAREN combinations
+using BankLayout = std::array<MemoryRegion, 0x100>;
+
+static constexpr MemoryRegion region_for_page(uint8_t config, uint8_t page) {
+    bool charen = (config & 0b100u) == 0b100u;
+    bool hiram = (config & 0b010u) == 0b010u;
+    bool loram = (config & 0b001u) == 0b001u;
+
+    if ((hiram && loram) && (0xA0 <= page && page <= 0xBF)) {
+        return MemoryRegion::BASIC;
+    } else if (charen && (hiram || loram) && (0xD0 <= page && page <= 0xDF)) {
+        return MemoryRegion::IO;
+    } else if ((hiram || loram) && (0xD0 <= page && page <= 0xDF)) {
+        return MemoryRegion::CHAR;
+    } else if (hiram && (0xE0 <= page)) {
+        return MemoryRegion::KERNAL;
+    }
+    return MemoryRegion::RAM;
+}
+
+static constexpr std::array<BankLayout, 8> bank_layouts = [] {
+    std::array<BankLayout, 8> layouts{};
+    for (uint8_t config = 0; config < 8; config++) {
+        for (int page = 0; page < 0x100; page++) {
+            layouts[config][page] = region_for_page(config, page);
+        }
+    }
+    return layouts;
+}();
+
+// Snapshot layout: a StateHeader, the DeviceState, then either all of RAM
+// (full) or a bitmap of the pages that differ from the base and those pages
+// (delta). A delta names its base by clock and by a checksum of its RAM.
+static constexpr uint32_t state_magic = 0x53343643; // "C64S"
+static constexpr uint16_t state_version = 5;
+
+enum class StateKind : uint16_t {
+    Full,
+    Delta
+};
+
+struct StateHeader {
+    uint32_t magic;
+    uint16_t version;
+    StateKind kind;
+    uint64_t system_clock;
+    uint64_t clock_count;
+    uint64_t base_system_clock; // identifies the base of a delta
+    uint64_t base_checksum;     // with ram_checksum() of its RAM
+    uint16_t pc;
+    uint16_t addr_abs;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t stkp;
+    uint8_t status;
+    uint8_t addr_rel;
+    uint8_t cycles;
+    uint8_t opcode;
+    uint8_t implied;
+    uint8_t implied_has_value;
+    uint8_t interrupt_state;
+    uint8_t padding[9];
+};
+
+static_assert(sizeof(StateHeader) == 64);
+
+struct DeviceState {
+    VicII::State vic;
+    Cia::State cia1;
+    Cia::State cia2;
+    Sid::State sid;
+    uint8_t nmi_line;
+    uint8_t padding[7];
+};
+
+static constexpr size_t state_prefix = sizeof(StateHeader) + sizeof(DeviceState);
+
+static constexpr size_t page_bitmap_size = 0x100 / 8;
+
+/// FNV-1a over the 64 KB of RAM in a full state, a word at a time with the
+/// high half folded back in so that every bit reaches the whole hash
+static uint64_t ram_checksum(const uint8_t *ram) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (size_t offset = 0; offset < 0x10000; offset += 8) {
+        uint64_t word;
+        std::memcpy(&word, ram + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+static StateHeader read_state_header(std::vector<uint8_t> const &state, StateKind kind) {
+    StateHeader header{};
+    if (state.size() < sizeof(header)) {
+        throw std::runtime_error("state is too short");
+    }
+    std::memcpy(&header, state.data(), sizeof(header));
+    if (header.magic != state_magic || header.version != state_version) {
+        throw std::runtime_error("not a C64 state or unsupported version");
+    }
+    if (header.kind != kind) {
+        throw std::runtime_error(kind == StateKind::Full ? "expected a full state" : "expected a delta state");
+    }
+    return header;
+}
+
+std::shared_ptr<const RomSet> RomSet::stock() {
+    static const std::shared_ptr<const RomSet> roms = [] {
+        auto set = std::make_shared<RomSet>();
+        std::copy(std::begin(basic_bin), std::end(basic_bin), std::begin(set->basic));
+        std::copy(std::begin(chars_bin), std::end(chars_bin), std::begin(set->chars));
+        std::copy(std::begin(kernal_bin), std::end(kernal_bin), std::begin(set->kernal));
+        return set;
+    }();
+    return roms;
+}
+
+C64::C64() : C64(RomSet::stock()) {
+}
+
+C64::C64(std::shared_ptr<const RomSet> roms) : ram{}, roms(std::move(roms)) {
+    update_memory_map();
+}
+
+C64::C64(std::shared_ptr<const RomSet> roms, ForkTag) : roms(std::move(roms)) {
+}
+
+MemoryRegion C64::memory_region(uint8_t config, uint16_t addr) {
+    return bank_layouts[config & 0b111u][addr >> 8];
+}
+
+void C64::update_memory_map() {
+    uint8_t config = ram_page(0x00)[0x01] & 0b111u;
+    if (config == bank_config) {
+        return;
+    }
+    bank_config = config;
+
+    for (int page = 0; page < 0x100; page++) {
+        map_page(page);
+    }
+}
+
+void C64::map_page(uint8_t page) {
+    uint16_t base = page << 8;
+    auto region = bank_layouts[bank_config][page];
+    switch (region) {
+        case MemoryRegion::RAM: read_map[page] = ram_page(page); break;
+        case MemoryRegion::BASIC: read_map[page] = &roms->basic[base - 0xA000]; break;
+        case MemoryRegion::CHAR: read_map[page] = &roms->chars[base - 0xD000]; break;
+        case MemoryRegion::KERNAL: read_map[page] = &roms->kernal[base - 0xE000]; break;
+        case MemoryRegion::IO: read_map[page] = nullptr; break;
+    }
+    // writes to ROM land in the RAM beneath it, shared pages are copied first
+    bool writable = region != MemoryRegion::IO && shared_pages[page] == nullptr;
+    write_map[page] = writable ? &ram[base] : nullptr;
+
+    if (breakpoints != nullptr && breakpoints->watches_page(page)) {
+        read_map[page] = nullptr;
+        write_map[page] = nullptr;
+    }
+    if (text_screen != nullptr && uint8_t(page - (text_screen->screen_address() >> 8)) < 4) {
+        write_map[page] = nullptr;
+    }
+}
+
+void C64::own_page(uint8_t page) {
+    if (shared_pages[page] == nullptr) {
+        return;
+    }
+    std::memcpy(&ram[page << 8], shared_pages[page]->data, 0x100);
+    shared_pages[page].reset();
+    map_page(page);
+}
+
+const uint8_t *C64::ram_page(uint8_t page) const {
+    if (shared_pages[page] != nullptr) {
+        return shared_pages[page]->data;
+    }
+    return &ram[page << 8];
+}
+
+std::unique_ptr<C64> C64::fork() {
+    // freeze the pages written since the last fork, both sides then share them
+    for (int page = 0; page < 0x100; page++) {
+        if (shared_pages[page] == nullptr) {
+            auto frozen = std::make_shared<RamPage>();
+            std::memcpy(frozen->data, &ram[page << 8], 0x100);
+            shared_pages[page] = std::move(frozen);
+        }
+    }
+    bank_config = 0xFF;
+    update_memory_map();
+    // a patched ROM set is now shared as well
+    patched_roms = nullptr;
+
+    auto child = std::unique_ptr<C64>(new C64(roms, ForkTag{}));
+    static_cast<CPU6502Base &>(child->cpu) = cpu;
+    child->system_clock = system_clock;
+    child->interrupt_state = interrupt_state;
+    // the VIC-II and SID as a snapshot takes them, without the frame and
+    // the audio
+    child->vic.load_state(vic.save_state(cpu.clock_count), cpu.clock_count);
+    child->cia1 = cia1;
+    child->cia2 = cia2;
+    child->nmi_line = nmi_line;
+    child->sid.load_state(sid.save_state(cpu.clock_count));
+    child->scheduler = scheduler;
+    std::copy(std::begin(shared_pages), std::end(shared_pages), std::begin(child->shared_pages));
+    child->bank_config = 0xFF;
+    child->update_memory_map();
+    return child;
 }
 
 void C64::write(uint16_t addr, uint8_t value) {
-    if (addr == 0x0000) {
-        printf("[CPU IO $0] %02X\n", value);
-    } else if (addr == 0x0001) {
-        printf("[CPU IO $1] %02X\n", value);
-    } else if (0xD000 <= addr && addr <= 0xDFFF) {
-        if (0xD000 <= addr && addr <= 0xD3FF) {
-            printf("[VIC-II] ");
-        } else if (0xD400 <= addr && addr <= 0xD7FF) {
-            printf("[SID] ");
-        } else if (0xD800 <= addr && addr <= 0xDBFF) {
-            printf("[COLOR RAM] ");
-        } else if (0xDC00 <= addr && addr <= 0xDCFF) {
-            printf("[CIA 1] ");
-        } else if (0xDD00 <= addr && addr <= 0xDDFF) {
-            printf("[CIA 2] ");
-        } else if (0xDE00 <= addr && addr <= 0xDEFF) {
-            printf("[I/O 1] ");
-        } else if (0xDF00 <= addr && addr <= 0xDFFF) {
-            printf("[I/O 2] ");
+    uint8_t *page = write_map[addr >> 8];
+    if (page != nullptr && addr > 0x0001) {
+        page[addr & 0xFF] = value;
+        return;
+    }
+
+    if (breakpoints != nullptr) {
+        watch(BreakKind::Write, addr, value);
+    }
+    if (text_screen != nullptr) {
+        text_screen->written(addr);
+    }
+    own_page(addr >> 8);
+    if (addr > 0x0001 && memory_region(bank_config, addr) != MemoryRegion::IO) {
+        ram[addr] = value;
+    } else {
+        write_io(addr, value);
+    }
+}
+
+uint8_t C64::read(uint16_t addr, bool read_only) {
+    const uint8_t *page = read_map[addr >> 8];
+    if (page != nullptr) {
+        return page[addr & 0xFF];
+    }
+    if (breakpoints == nullptr) {
+        return read_io(addr, read_only);
+    }
+
+    // a watched page, see map_page
+    uint8_t value;
+    switch (memory_region(bank_config, addr)) {
+        case MemoryRegion::RAM: value = ram_page(addr >> 8)[addr & 0xFF]; break;
+        case MemoryRegion::BASIC: value = roms->basic[addr - 0xA000]; break;
+        case MemoryRegion::CHAR: value = roms->chars[addr - 0xD000]; break;
+        case MemoryRegion::KERNAL: value = roms->kernal[addr - 0xE000]; break;
+        default: value = read_io(addr, read_only); break;
+    }
+    if (!read_only) {
+        watch(BreakKind::Read, addr, value);
+    }
+    return value;
+}
+
+void C64::write_io(uint16_t addr, uint8_t value) {
+    C64_TRACE_BUS(addr, value, true);
+    if ((addr & 0xFC00) == 0xD000) {
+        uint64_t now = bus_clock();
+        update_vic(now);
+        vic.write(addr, value, now);
+        posted(Device::Vic, now);
+        return;
+    }
+    if ((addr & 0xFC00) == 0xD400) {
+        sid.run_until(bus_clock());
+        sid.write(addr & 0x1F, value);
+        return;
+    }
+    if ((addr & 0xFE00) == 0xDC00) {
+        uint64_t now = bus_clock();
+        Device device = addr < 0xDD00 ? Device::Cia1 : Device::Cia2;
+        auto &cia = device == Device::Cia1 ? cia1 : cia2;
+        if (device == Device::Cia2) {
+            update_vic(now); // it draws up to here with the bank selected so far
         }
-        printf("Writing I/O: $%04X <- %02X\n", addr, value);
-    } else if (0x0400 <= addr && addr <= 0x07E7) {
-//        printf("[Screen] $%04X <- %02X\n", addr, value);
+        cia.run_until(now);
+        cia.write(addr & 0x0F, value, now);
+        nmi_line = nmi_line && cia2.irq();
+        posted(device, now);
+        return;
     }
     ram[addr] = value;
+
+    if (addr == 0x0001) {
+        update_memory_map();
+    }
 }
 
-uint8_t C64::read(uint16_t addr, bool read_only) {
-    uint8_t port_reg = ram[0x0001];
-    bool charen = (port_reg & 0b100u) == 0b100u;
-    bool hiram = (port_reg & 0b010u) == 0b010u;
-    bool loram = (port_reg & 0b001u) == 0b001u;
-
-    if ((hiram && loram) && (0xA000 <= addr && addr <= 0xBFFF)) {
-        return basic_rom[addr - 0xA000];
-    } else if (charen && (hiram || loram) && (0xD000 <= addr && addr <= 0xDFFF)) {
-        if (0xD000 <= addr && addr <= 0xD3FF) {
-            printf("[VIC-II] ");
-            if (addr == 0xD012) { // raster counter
-                return 0x00;
-            }
-        } else if (0xD400 <= addr && addr <= 0xD7FF) {
-            printf("[SID] ");
-        } else if (0xD800 <= addr && addr <= 0xDBFF) {
-            printf("[COLOR RAM] ");
-        } else if (0xDC00 <= addr && addr <= 0xDCFF) {
-            printf("[CIA 1] ");
-        } else if (0xDD00 <= addr && addr <= 0xDDFF) {
-            printf("[CIA 2] ");
-        } else if (0xDE00 <= addr && addr <= 0xDEFF) {
-            printf("[I/O 1] ");
-        } else if (0xDF00 <= addr && addr <= 0xDFFF) {
-            printf("[I/O 2] ");
+uint8_t C64::read_io(uint16_t addr, bool read_only) {
+    uint8_t value;
+    if ((addr & 0xFC00) == 0xD000) {
+        uint64_t now = bus_clock();
+        update_vic(now);
+        value = vic.read(addr, now, read_only);
+    } else if ((addr & 0xFC00) == 0xD400) {
+        sid.run_until(bus_clock());
+        value = sid.read(addr & 0x1F);
+    } else if ((addr & 0xFE00) == 0xDC00) {
+        uint64_t now = bus_clock();
+        auto &cia = addr < 0xDD00 ? cia1 : cia2;
+        cia.run_until(now);
+        value = cia.read(addr & 0x0F, now, read_only);
+        // acknowledging CIA 2 releases the NMI line, the next interrupt is a new edge
+        nmi_line = nmi_line && cia2.irq();
+    } else {
+        value = ram_page(addr >> 8)[addr & 0xFF];
+    }
+    C64_TRACE_BUS(addr, value, false);
+    return value;
+}
+
+uint8_t C64::vic_bank() const {
+    // CIA 2 port A bits 0-1, inverted
+    return 3 - (cia2.port_a_out() & 0b11);
+}
+
+VicMemory C64::vic_memory() const {
+    uint8_t bank = vic_bank();
+    VicMemory memory{};
+    for (int page = 0; page < 0x40; page++) {
+        bool char_rom = (bank & 1) == 0 && (page & 0x30) == 0x10;
+        memory.pages[page] = char_rom ? &roms->chars[(page - 0x10) << 8] : ram_page(bank * 0x40 + page);
+    }
+    for (int page = 0; page < 4; page++) {
+        memory.color[page] = ram_page(0xD8 + page);
+    }
+    return memory;
+}
+
+void C64::update_vic(uint64_t now) {
+    if (vic.renders_by(now)) {
+        vic.run_until(now, vic_memory());
+    } else {
+        vic.run_until(now, VicMemory{});
+    }
+}
+
+void C64::post(Device device) {
+    uint64_t due = Scheduler::never;
+    switch (device) {
+        case Device::Vic: due = vic.next_irq(); break;
+        case Device::Cia1: due = cia1.next_irq(); break;
+        case Device::Cia2: due = cia2.next_irq(); break;
+    }
+    scheduler.post(device, due);
+}
+
+void C64::post_all() {
+    scheduler.clear();
+    for (auto device: {Device::Vic, Device::Cia1, Device::Cia2}) {
+        post(device);
+    }
+}
+
+void C64::posted(Device device, uint64_t now) {
+    post(device);
+    bool irq = irq_line();
+    if ((cia2.irq() && !nmi_line) || (irq && !cpu.is_status_flag_set(Flags6502::I))) {
+        cpu.end_run_at(now);
+        return;
+    }
+    cpu.hold_irq(irq);
+    if (scheduler.next() != Scheduler::never) {
+        cpu.end_run_at(scheduler.next());
+    }
+}
+
+void C64::run_events(uint64_t now) {
+    while (auto device = scheduler.pop(now)) {
+        switch (*device) {
+            case Device::Vic: update_vic(now); break;
+            case Device::Cia1: cia1.run_until(now); break;
+            case Device::Cia2: cia2.run_until(now); break;
         }
-        printf("Reading I/O: $%04X\n", addr);
-    } else if ((hiram || loram) && (0xD000 <= addr && addr <= 0xDFFF)) {
-        return char_rom[addr - 0xD000];
-    } else if (hiram && (0xE000 <= addr && addr <= 0xFFFF)) {
-        return kernal_rom[addr - 0xE000];
+        post(*device);
+    }
+}
+
+void C64::between_instructions() {
+    uint64_t now = cpu.clock_count;
+    if (scheduler.next() <= now) {
+        run_events(now);
+    }
+    if (interrupt_state != Interrupt::None || irq_line() || cia2.irq() != nmi_line) {
+        service_interrupt();
     }
-    return ram[addr];
 }
 
 void C64::reset() {
-    ram[0x0001] = 0b010;
+    own_page(0x00);
+    // the port's pins are inputs after a reset and read high, so the KERNAL
+    // reaches the CIAs before it sets up the port
+    ram[0x0001] = 0b111;
+    update_memory_map();
     cpu.reset(*this);
 }
 
 bool C64::clock() {
+    bool starting = cpu.complete();
+    uint16_t pc = cpu.pc;
+    if (starting) {
+        break_event.reset();
+        resume_pc = -1;
+        if (instruction_tracer != nullptr) {
+            instruction_tracer->record(trace_record(cpu, *this, cpu.clock_count));
+        }
+    }
     cpu.clock(*this);
+    if (starting && profiler != nullptr) {
+        profiler->record(pc, cpu.opcode, cpu.cycles + 1, cpu.pc);
+    }
+    if (cpu.complete()) {
+        between_instructions();
+    }
+    system_clock++;
+    return cpu.complete();
+}
+
+uint32_t C64::step_instruction() {
+    break_event.reset();
+    resume_pc = -1;
+    uint16_t pc = cpu.pc;
+    uint8_t pending = cpu.cycles;
+    if (instruction_tracer != nullptr) {
+        instruction_tracer->record(trace_record(cpu, *this, cpu.clock_count + pending));
+    }
+    uint32_t elapsed = cpu.step_instruction(*this);
+    if (profiler != nullptr) {
+        profiler->record(pc, cpu.opcode, elapsed - pending, cpu.pc);
+    }
+    between_instructions();
+    system_clock += elapsed;
+    return elapsed;
+}
+
+uint64_t C64::run_for_cycles(uint64_t budget) {
+    break_event.reset();
+    uint64_t elapsed = 0;
+    while (elapsed < budget) {
+        // interrupts are taken between instructions, finish the one in flight
+        elapsed += cpu.run_for_cycles(*this, std::min<uint64_t>(cpu.cycles, budget - elapsed));
+        if (elapsed == budget || break_event) {
+            break;
+        }
+        between_instructions();
+
+        // the CPU runs up to the next event, a device write moving one closer
+        // ends the run early (see posted). An IRQ held off by the I flag ends
+        // it once the flag is cleared.
+        uint64_t next = scheduler.next();
+        uint64_t slice = std::min(budget - elapsed, next > cpu.clock_count ? next - cpu.clock_count : 1);
+        cpu.hold_irq(irq_line());
+        elapsed += cpu.run_for_cycles(*this, slice);
+        if (break_event) {
+            break;
+        }
+    }
+
+    cpu.hold_irq(false);
+    system_clock += elapsed;
+    return elapsed;
+}
+
+uint64_t C64::run_until_pc(uint16_t addr, uint64_t max_cycles) {
+    // a breakpoint of our own stops the run, which keeps the CPU running
+    // whole slices instead of one instruction per call
+    int id = add_breakpoint(addr);
+    if (cpu.pc == addr) {
+        resume_pc = addr; // the instruction at `addr` runs first
+    }
+    uint64_t elapsed = 0;
+    try {
+        elapsed = run_for_cycles(max_cycles);
+    } catch (...) {
+        remove_breakpoint(id);
+        throw;
+    }
+
+    // removing a breakpoint forgets where the last one stopped
+    int stopped_at = resume_pc;
+    remove_breakpoint(id);
+    if (break_event && break_event->id == id) {
+        break_event.reset();
+    } else {
+        resume_pc = stopped_at;
+    }
+    return elapsed;
+}
+
+uint64_t C64::run_frames(uint64_t frames) {
+    return run_for_cycles(frames * cycles_per_frame);
+}
+
+int C64::add_breakpoint(uint16_t addr, BreakCondition condition) {
+    if (breakpoints == nullptr) {
+        breakpoints = std::make_unique<Breakpoints>();
+    }
+    return breakpoints->add_breakpoint(addr, std::move(condition));
+}
+
+int C64::add_watchpoint(uint16_t first, uint16_t last, Access access, BreakCondition condition) {
+    if (breakpoints == nullptr) {
+        breakpoints = std::make_unique<Breakpoints>();
+    }
+    int id = breakpoints->add_watchpoint(first, last, access, std::move(condition));
+    remap_breakpoints();
+    return id;
+}
+
+bool C64::remove_breakpoint(int id) {
+    if (breakpoints == nullptr || !breakpoints->remove(id)) {
+        return false;
+    }
+    if (breakpoints->empty()) {
+        breakpoints.reset();
+    }
+    remap_breakpoints();
+    return true;
+}
+
+void C64::clear_breakpoints() {
+    breakpoints.reset();
+    remap_breakpoints();
+}
+
+std::optional<BreakEvent> const &C64::last_break() const {
+    return break_event;
+}
+
+void C64::remap_breakpoints() {
+    resume_pc = -1;
+    bank_config = 0xFF;
+    update_memory_map();
+}
+
+void C64::watch(BreakKind kind, uint16_t addr, uint8_t value) {
+    if (!break_event && breakpoints->is_watched(addr, kind)) {
+        break_event = breakpoints->match(*this, kind, addr, value);
+    }
+}
+
+bool C64::stop_before(uint16_t pc) {
+    if (break_event) {
+        return true; // a watchpoint fired during the last instruction
+    }
+    if (breakpoints != nullptr && breakpoints->is_breakpoint(pc) && resume_pc != pc) {
+        break_event = breakpoints->match(*this, BreakKind::Breakpoint, pc, 0);
+        if (break_event) {
+            resume_pc = pc;
+            return true;
+        }
+    }
+    resume_pc = -1;
+
+    if (instruction_tracer != nullptr) {
+        instruction_tracer->record(trace_record(cpu, *this, cpu.clock_count));
+    }
+    return false;
+}
+
+void C64::set_instruction_tracer(InstructionTracer *tracer) {
+    instruction_tracer = tracer;
+}
+
+Profiler &C64::enable_profiler(bool call_graph) {
+    profiler = std::make_unique<Profiler>(call_graph);
+    return *profiler;
+}
+
+void C64::disable_profiler() {
+    profiler.reset();
+}
+
+Profiler const *C64::get_profiler() const {
+    return profiler.get();
+}
+
+void C64::service_interrupt() {
+    uint16_t pc = cpu.pc;
+    bool nmi = cia2.irq();
+    if (nmi && !nmi_line) {
+        interrupt_state = Interrupt::NMI;
+    }
+    nmi_line = nmi;
 
     if (interrupt_state == Interrupt::NMI) {
         cpu.nmi(*this);
-    } else if (interrupt_state == Interrupt::IRQ) {
+    } else if (interrupt_state == Interrupt::IRQ || irq_line()) {
         cpu.irq(*this);
     }
-
     interrupt_state = Interrupt::None;
-    system_clock++;
-    return cpu.complete();
+
+    if (profiler != nullptr && cpu.pc != pc) {
+        profiler->interrupt(pc, cpu.pc, cpu.cycles);
+    }
 }
 
 void C64::interrupt(Interrupt interrupt) {
     interrupt_state = interrupt;
 }
 
-CPU6502 const& C64::get_cpu() const {
+std::shared_ptr<const RomSet> const &C64::rom_set() const {
+    return roms;
+}
+
+void C64::patch_rom(uint16_t addr, uint8_t value) {
+    if (patched_roms == nullptr) {
+        auto copy = std::make_shared<RomSet>(*roms);
+        patched_roms = copy.get();
+        roms = std::move(copy);
+        bank_config = 0xFF; // the ROM pages moved
+        update_memory_map();
+    }
+
+    cpu.invalidate_code(addr);
+    if (0xA000 <= addr && addr <= 0xBFFF) {
+        patched_roms->basic[addr - 0xA000] = value;
+    } else if (0xD000 <= addr && addr <= 0xDFFF) {
+        patched_roms->chars[addr - 0xD000] = value;
+    } else if (0xE000 <= addr) {
+        patched_roms->kernal[addr - 0xE000] = value;
+    } else {
+        throw std::out_of_range("no ROM is mapped at this address");
+    }
+}
+
+StateHeader C64::state_header() const {
+    StateHeader header{};
+    header.magic = state_magic;
+    header.version = state_version;
+    header.kind = StateKind::Full;
+    header.system_clock = system_clock;
+    header.clock_count = cpu.clock_count;
+    header.pc = cpu.pc;
+    header.addr_abs = cpu.addr_abs;
+    header.a = cpu.a;
+    header.x = cpu.x;
+    header.y = cpu.y;
+    header.stkp = cpu.stkp;
+    header.status = cpu.status;
+    header.addr_rel = cpu.addr_rel;
+    header.cycles = cpu.cycles;
+    header.opcode = cpu.opcode;
+    header.implied = cpu.implied;
+    header.implied_has_value = cpu.implied_has_value;
+    header.interrupt_state = interrupt_state;
+    return header;
+}
+
+void C64::apply_state_header(StateHeader const &header) {
+    system_clock = header.system_clock;
+    cpu.clock_count = header.clock_count;
+    cpu.pc = header.pc;
+    cpu.addr_abs = header.addr_abs;
+    cpu.a = header.a;
+    cpu.x = header.x;
+    cpu.y = header.y;
+    cpu.stkp = header.stkp;
+    cpu.status = header.status;
+    cpu.addr_rel = header.addr_rel;
+    cpu.cycles = header.cycles;
+    cpu.opcode = header.opcode;
+    cpu.implied = header.implied;
+    cpu.implied_has_value = header.implied_has_value != 0;
+    interrupt_state = static_cast<Interrupt>(header.interrupt_state);
+}
+
+DeviceState C64::device_state() const {
+    DeviceState devices{};
+    // as of the CPU's clock, however far the chips were brought up
+    devices.vic = vic.save_state(cpu.clock_count);
+    devices.cia1 = cia1.save_state(cpu.clock_count);
+    devices.cia2 = cia2.save_state(cpu.clock_count);
+    devices.sid = sid.save_state(cpu.clock_count);
+    devices.nmi_line = nmi_line;
+    return devices;
+}
+
+void C64::apply_device_state(DeviceState const &devices) {
+    vic.load_state(devices.vic, cpu.clock_count);
+    cia1.load_state(devices.cia1);
+    cia2.load_state(devices.cia2);
+    sid.load_state(devices.sid);
+    nmi_line = devices.nmi_line != 0;
+    post_all();
+}
+
+std::vector<uint8_t> C64::save_state() const {
+    auto header = state_header();
+    auto devices = device_state();
+
+    std::vector<uint8_t> state(state_prefix + sizeof(ram));
+    std::memcpy(state.data(), &header, sizeof(header));
+    std::memcpy(state.data() + sizeof(header), &devices, sizeof(devices));
+    for (int page = 0; page < 0x100; page++) {
+        std::memcpy(state.data() + state_prefix + (page << 8), ram_page(page), 0x100);
+    }
+    return state;
+}
+
+std::vector<uint8_t> C64::save_state(std::vector<uint8_t> const &base) const {
+    auto base_header = read_state_header(base, StateKind::Full);
+    if (base.size() != state_prefix + sizeof(ram)) {
+        throw std::runtime_error("base state has the wrong size");
+    }
+    const uint8_t *base_ram = base.data() + state_prefix;
+
+    uint8_t bitmap[page_bitmap_size] = {};
+    size_t changed = 0;
+    for (int page = 0; page < 0x100; page++) {
+        if (std::memcmp(ram_page(page), &base_ram[page << 8], 0x100) != 0) {
+            bitmap[page >> 3] |= 1u << (page & 7);
+            changed++;
+        }
+    }
+
+    auto header = state_header();
+    header.kind = StateKind::Delta;
+    header.base_system_clock = base_header.system_clock;
+    header.base_checksum = ram_checksum(base_ram);
+    auto devices = device_state();
+
+    std::vector<uint8_t> state(state_prefix + sizeof(bitmap) + changed * 0x100);
+    uint8_t *out = state.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, &devices, sizeof(devices));
+    out += sizeof(devices);
+    std::memcpy(out, bitmap, sizeof(bitmap));
+    out += sizeof(bitmap);
+    for (int page = 0; page < 0x100; page++) {
+        if (bitmap[page >> 3] & (1u << (page & 7))) {
+            std::memcpy(out, ram_page(page), 0x100);
+            out += 0x100;
+        }
+    }
+    return state;
+}
+
+void C64::load_state(std::vector<uint8_t> const &state) {
+    auto header = read_state_header(state, StateKind::Full);
+    if (state.size() != state_prefix + sizeof(ram)) {
+        throw std::runtime_error("state has the wrong size");
+    }
+
+    DeviceState devices{};
+    std::memcpy(&devices, state.data() + sizeof(header), sizeof(devices));
+    apply_state_header(header);
+    apply_device_state(devices);
+    std::memcpy(ram, state.data() + state_prefix, sizeof(ram));
+    if (text_screen != nullptr) {
+        text_screen->mark_all();
+    }
+    cpu.flush_code_cache();
+    std::fill(std::begin(shared_pages), std::end(shared_pages), nullptr);
+    bank_config = 0xFF;
+    update_memory_map();
+}
+
+void C64::load_state(std::vector<uint8_t> const &state, std::vector<uint8_t> const &base) {
+    auto header = read_state_header(state, StateKind::Delta);
+    auto base_header = read_state_header(base, StateKind::Full);
+    if (base.size() != state_prefix + sizeof(ram)) {
+        throw std::runtime_error("base state has the wrong size");
+    }
+    if (header.base_system_clock != base_header.system_clock ||
+        header.base_checksum != ram_checksum(base.data() + state_prefix)) {
+        throw std::runtime_error("delta state was made against a different base");
+    }
+    if (state.size() < state_prefix + page_bitmap_size) {
+        throw std::runtime_error("state is too short");
+    }
+
+    const uint8_t *bitmap = state.data() + state_prefix;
+    size_t changed = 0;
+    for (int page = 0; page < 0x100; page++) {
+        changed += (bitmap[page >> 3] >> (page & 7)) & 1u;
+    }
+    if (state.size() != state_prefix + page_bitmap_size + changed * 0x100) {
+        throw std::runtime_error("state has the wrong size");
+    }
+
+    DeviceState devices{};
+    std::memcpy(&devices, state.data() + sizeof(header), sizeof(devices));
+    load_state(base);
+    apply_state_header(header);
+    apply_device_state(devices);
+
+    const uint8_t *pages = bitmap + page_bitmap_size;
+    for (int page = 0; page < 0x100; page++) {
+        if (bitmap[page >> 3] & (1u << (page & 7))) {
+            std::memcpy(&ram[page << 8], pages, 0x100);
+            pages += 0x100;
+        }
+    }
+    bank_config = 0xFF;
+    update_memory_map();
+}
+
+void C64::read_ram(uint16_t addr, uint8_t *out, size_t size) const {
+    if (addr + size > sizeof(ram)) {
+        throw std::out_of_range("read_ram past the end of RAM");
+    }
+    for (size_t i = 0; i < size;) {
+        uint16_t at = addr + i;
+        size_t count = std::min<size_t>(0x100 - (at & 0xFF), size - i);
+        std::copy_n(ram_page(at >> 8) + (at & 0xFF), count, out + i);
+        i += count;
+    }
+}
+
+void C64::write_ram(uint16_t addr, uint8_t const *data, size_t size) {
+    if (addr + size > sizeof(ram)) {
+        throw std::out_of_range("write_ram past the end of RAM");
+    }
+    for (size_t page = addr >> 8; page < (addr + size + 0xFF) >> 8; page++) {
+        own_page(page);
+        cpu.invalidate_code(page << 8);
+    }
+    std::copy_n(data, size, &ram[addr]);
+    if (text_screen != nullptr) {
+        for (size_t i = 0; i < size; i++) {
+            text_screen->written(addr + i);
+        }
+    }
+    if (addr <= 0x0001) {
+        update_memory_map();
+    }
+}
+
+uint8_t *C64::ram_data() {
+    for (int page = 0; page < 0x100; page++) {
+        own_page(page);
+    }
+    if (text_screen != nullptr) {
+        text_screen->mark_all(); // whatever is written through the pointer
+    }
+    return ram;
+}
+
+void C64::ram_written() {
+    cpu.flush_code_cache();
+    if (text_screen != nullptr) {
+        text_screen->mark_all();
+    }
+    update_memory_map();
+}
+
+uint16_t C64::load_prg(std::vector<uint8_t> const &prg) {
+    if (prg.size() < 2) {
+        throw std::runtime_error("PRG file is missing the load address");
+    }
+    uint16_t start = prg[0] | (prg[1] << 8);
+    write_ram(start, prg.data() + 2, prg.size() - 2);
+
+    if (start == 0x0801) {
+        // VARTAB, ARYTAB and STREND all point past the program
+        uint16_t end = start + prg.size() - 2;
+        own_page(0x00);
+        cpu.invalidate_code(0x0000);
+        for (uint16_t pointer = 0x2D; pointer <= 0x31; pointer += 2) {
+            ram[pointer] = end & 0xFF;
+            ram[pointer + 1] = end >> 8;
+        }
+    }
+    return start;
+}
+
+size_t C64::type(std::string const &text) {
+    own_page(0x00);
+    own_page(0x02);
+    cpu.invalidate_code(0x0000);
+    cpu.invalidate_code(0x0200);
+    uint8_t count = ram[0x00C6];
+    size_t typed = 0;
+    for (char c: text) {
+        if (count == 10) {
+            break;
+        }
+        uint8_t key = c == '\n' ? 0x0D : std::toupper(static_cast<unsigned char>(c));
+        ram[0x0277 + count] = key;
+        count++;
+        typed++;
+    }
+    ram[0x00C6] = count;
+    return typed;
+}
+
+void C64::set_tracer(BusTracer *bus_tracer) {
+    tracer = bus_tracer;
+}
+
+CPU6502Base const& C64::get_cpu() const {
     return cpu;
 }
+
+VicII const &C64::get_vic() {
+    update_vic(cpu.clock_count);
+    return vic;
+}
+
+void C64::set_key(uint8_t column, uint8_t row, bool pressed) {
+    if (column > 7 || row > 7) {
+        throw std::out_of_range("the keyboard matrix is 8x8");
+    }
+    cia1.set_key(column, row, pressed);
+}
+
+void C64::set_joystick(int port, uint8_t lines) {
+    if (port == 1) {
+        cia1.set_joystick_b(lines);
+    } else if (port == 2) {
+        cia1.set_joystick_a(lines);
+    } else {
+        throw std::out_of_range("joystick port must be 1 or 2");
+    }
+}
+
+void C64::enable_audio(uint32_t sample_rate) {
+    if (sample_rate == 0) {
+        throw std::out_of_range("the sample rate must not be 0");
+    }
+    // the sound starts now
+    sid.run_until(cpu.clock_count);
+    sid.set_sample_rate(sample_rate);
+}
+
+void C64::disable_audio() {
+    sid.set_sample_rate(0);
+}
+
+std::vector<int16_t> C64::take_audio() {
+    sid.run_until(cpu.clock_count);
+    return sid.take_samples();
+}
+
+TextScreen const &C64::render_text_screen() {
+    bool first = text_screen == nullptr;
+    if (first) {
+        text_screen = std::make_unique<TextScreen>();
+    }
+
+    uint64_t now = cpu.clock_count;
+    uint8_t memory_setup = vic.read(0x18, now, true);
+    TextScreen::Source source{};
+    source.screen = vic_bank() * 0x4000 + ((memory_setup & 0xF0) << 6);
+    source.chars = (memory_setup & 0x0E) << 10;
+    source.background = vic.read(0x21, now, true) & 0x0F;
+
+    bool moved = source.screen != text_screen->screen_address();
+    text_screen->update(vic_memory(), source);
+    if (first || moved) {
+        bank_config = 0xFF; // the watched pages moved
+        update_memory_map();
+    }
+    return *text_screen;
+}
+
+void C64::disable_text_screen() {
+    text_screen.reset();
+    bank_config = 0xFF;
+    update_memory_map();
+}
+
+void C64::set_dispatch(Dispatch dispatch) {
+    cpu.dispatch = dispatch;
+}
+
+template class CPU6502T<C64>;
@@ -0,0 +1,273 @@
+#include "c64/c64.hpp"
+#include "c64/instrumentation.hpp"
+#include "c64/thread_pool.hpp"
+#include <fmt/format.h>
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+// Runs many headless C64 jobs in parallel, one C64 instance per job.
+//
+//   c64_batch <manifest> [threads]
+//
+// Threads defaults to 0, one per hardware thread, and goes up to 1024.
+//
+// The manifest has one job per line, a name followed by key=value options.
+// Blank lines and lines starting with # are ignored.
+//
+//   boot=<cycles>   cycles to run after reset before loading (default 2500000)
+//   prg=<path>      PRG file to load after booting
+//   type=<text>     text typed after loading, \n is RETURN (e.g. type=RUN\n)
+//   cycles=<n>      cycles to run after loading (default 0)
+//   dump=<path>     file that receives the 64 KB of RAM at the end
+//   screen=<path>   file that receives the text screen at the end, as ASCII
+//   profile=<path>  file that receives a profile of the cycles run after loading
+//   trace=<path>    file that receives a binary trace of the instructions run
+//                   after loading, see c64_trace
+//   audio=<path>    WAV file that receives the sound of the cycles run after
+//                   loading, 44.1 kHz mono
+//
+// Example:
+//
+//   hello prg=hello.prg type=RUN\n cycles=1000000 dump=hello.ram
+
+static constexpr uint64_t max_threads = 1024;
+
+struct Job {
+    std::string name;
+    uint64_t boot_cycles = 2500000;
+    std::string prg_path;
+    std::string text;
+    uint64_t cycles = 0;
+    std::string dump_path;
+    std::string screen_path;
+    std::string profile_path;
+    std::string trace_path;
+    std::string audio_path;
+};
+
+struct JobResult {
+    uint64_t cycles = 0;
+    double seconds = 0.0;
+    std::string error;
+};
+
+static std::string unescape(std::string const &value) {
+    std::string result;
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '\\' && i + 1 < value.size() && value[i + 1] == 'n') {
+            result += '\n';
+            i++;
+        } else {
+            result += value[i];
+        }
+    }
+    return result;
+}
+
+/// Parses `text` as a decimal number up to `max`, nothing but digits. Signs,
+/// blanks, trailing characters and values that do not fit are errors.
+static bool parse_count(std::string const &text, uint64_t max, uint64_t &value) {
+    char const *end = text.data() + text.size();
+    auto [stop, error] = std::from_chars(text.data(), end, value);
+    return !text.empty() && error == std::errc() && stop == end && value <= max;
+}
+
+static std::vector<Job> read_manifest(std::string const &path) {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        throw std::runtime_error("Unable to open: " + path);
+    }
+
+    std::vector<Job> jobs;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(ifs, line)) {
+        line_number++;
+        std::istringstream tokens(line);
+        Job job;
+        if (!(tokens >> job.name) || job.name[0] == '#') {
+            continue;
+        }
+
+        std::string option;
+        while (tokens >> option) {
+            auto split = option.find('=');
+            if (split == std::string::npos) {
+                throw std::runtime_error(fmt::format("{}:{}: expected key=value, got '{}'", path, line_number, option));
+            }
+            auto key = option.substr(0, split);
+            auto value = option.substr(split + 1);
+            auto cycle_count = [&] {
+                uint64_t count = 0;
+                if (!parse_count(value, UINT64_MAX, count)) {
+                    throw std::runtime_error(fmt::format("{}:{}: {} expects a number of cycles, got '{}'",
+                                                         path, line_number, key, value));
+                }
+                return count;
+            };
+
+            if (key == "boot") {
+                job.boot_cycles = cycle_count();
+            } else if (key == "prg") {
+                job.prg_path = value;
+            } else if (key == "type") {
+                job.text = unescape(value);
+            } else if (key == "cycles") {
+                job.cycles = cycle_count();
+            } else if (key == "dump") {
+                job.dump_path = value;
+            } else if (key == "screen") {
+                job.screen_path = value;
+            } else if (key == "profile") {
+                job.profile_path = value;
+            } else if (key == "trace") {
+                job.trace_path = value;
+            } else if (key == "audio") {
+                job.audio_path = value;
+            } else {
+                throw std::runtime_error(fmt::format("{}:{}: unknown option '{}'", path, line_number, key));
+            }
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+static std::vector<uint8_t> read_file(std::string const &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw std::runtime_error("Unable to open: " + path);
+    }
+    return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+static void run_job(Job const &job, JobResult &result) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto c64 = std::make_unique<C64>();
+    c64->reset();
+    result.cycles += c64->run_for_cycles(job.boot_cycles);
+
+    if (!job.prg_path.empty()) {
+        c64->load_prg(read_file(job.prg_path));
+    }
+    if (!job.text.empty()) {
+        c64->type(job.text);
+    }
+    if (!job.profile_path.empty()) {
+        c64->enable_profiler(true);
+    }
+    if (!job.audio_path.empty()) {
+        c64->enable_audio(44100);
+    }
+    if (!job.trace_path.empty()) {
+        // closed on every path, after the tracer has flushed into it
+        auto out = std::unique_ptr<FILE, decltype(&std::fclose)>(std::fopen(job.trace_path.c_str(), "wb"),
+                                                                 &std::fclose);
+        if (out == nullptr) {
+            throw std::runtime_error("Unable to write: " + job.trace_path);
+        }
+        auto tracer = InstructionTracer(out.get());
+        c64->set_instruction_tracer(&tracer);
+        result.cycles += c64->run_for_cycles(job.cycles);
+        c64->set_instruction_tracer(nullptr);
+    } else {
+        result.cycles += c64->run_for_cycles(job.cycles);
+    }
+
+    if (!job.profile_path.empty()) {
+        auto symbols = SymbolTable::c64(*c64->rom_set());
+        auto report = c64tools::profile_report(*c64->get_profiler(), symbols, c64->get_cpu(), *c64);
+        std::ofstream ofs(job.profile_path);
+        ofs << report;
+        if (!ofs) {
+            throw std::runtime_error("Unable to write: " + job.profile_path);
+        }
+    }
+
+    if (!job.dump_path.empty()) {
+        std::vector<uint8_t> ram(0x10000);
+        c64->read_ram(0x0000, ram.data(), ram.size());
+        std::ofstream ofs(job.dump_path, std::ios::binary);
+        ofs.write(reinterpret_cast<const char *>(ram.data()), ram.size());
+        if (!ofs) {
+            throw std::runtime_error("Unable to write: " + job.dump_path);
+        }
+    }
+
+    if (!job.screen_path.empty()) {
+        std::ofstream ofs(job.screen_path);
+        ofs << c64->render_text_screen().ascii();
+        if (!ofs) {
+            throw std::runtime_error("Unable to write: " + job.screen_path);
+        }
+    }
+
+    if (!job.audio_path.empty()) {
+        write_wav(job.audio_path, c64->take_audio(), c64->audio_sample_rate());
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: {} <manifest> [threads]\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t threads = 0;
+    if (argc > 2 && !parse_count(argv[2], max_threads, threads)) {
+        fmt::print(stderr, "threads must be a number from 0 to {}, got '{}'\n", max_threads, argv[2]);
+        fmt::print(stderr, "usage: {} <manifest> [threads]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Job> jobs;
+    try {
+        jobs = read_manifest(argv[1]);
+    } catch (std::exception const &e) {
+        fmt::print(stderr, "{}\n", e.what());
+        return 2;
+    }
+
+    std::vector<JobResult> results(jobs.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto pool = ThreadPool(threads);
+        pool.parallel_for(jobs.size(), [&](size_t index) {
+            try {
+                run_job(jobs[index], results[index]);
+            } catch (std::exception const &e) {
+                results[index].error = e.what();
+            }
+        });
+    }
+    auto stop = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(stop - start).count();
+
+    uint64_t total_cycles = 0;
+    int failed = 0;
+    fmt::print("{:<20} {:>14} {:>10} {:>8}\n", "job", "cycles", "ms", "MHz");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto &result = results[i];
+        if (!result.error.empty()) {
+            failed++;
+            fmt::print("{:<20} failed: {}\n", jobs[i].name, result.error);
+            continue;
+        }
+        total_cycles += result.cycles;
+        fmt::print("{:<20} {:>14} {:>10.1f} {:>8.2f}\n", jobs[i].name, result.cycles,
+                   result.seconds * 1000.0, result.cycles / result.seconds / 1e6);
+    }
+    fmt::print("{} jobs ({} failed), {} cycles in {:.1f} ms, {:.2f} MHz emulated\n",
+               jobs.size(), failed, total_cycles, seconds * 1000.0, total_cycles / seconds / 1e6);
+
+    return failed == 0 ? 0 : 1;
+}
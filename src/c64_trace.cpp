@@ -0,0 +1,42 @@
+#include "c64/instruction_trace.hpp"
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <exception>
+#include <string>
+
+// Prints an instruction trace written by InstructionTracer (e.g. c64_batch's
+// trace= option) as text, one numbered line per instruction.
+//
+//   c64_trace <trace> [first] [count]
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: {} <trace> [first] [count]\n", argv[0]);
+        return 2;
+    }
+    uint64_t first = argc > 2 ? std::stoull(argv[2]) : 0;
+    uint64_t count = argc > 3 ? std::stoull(argv[3]) : UINT64_MAX;
+
+    FILE *in = std::fopen(argv[1], "rb");
+    if (in == nullptr) {
+        fmt::print(stderr, "Unable to open: {}\n", argv[1]);
+        return 2;
+    }
+
+    int status = 0;
+    try {
+        auto reader = TraceReader(in);
+        TraceRecord record{};
+        for (uint64_t index = 0; index - first < count && reader.next(record); index++) {
+            if (index >= first) {
+                fmt::print("{:d} -> {}\n", index + 1, format_trace_record(record));
+            }
+        }
+    } catch (std::exception const &e) {
+        fmt::print(stderr, "{}\n", e.what());
+        status = 1;
+    }
+    std::fclose(in);
+    return status;
+}
@@ -0,0 +1,320 @@
+#include "c64/cia.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint32_t tenths_per_day = 24 * 60 * 60 * 10;
+
+static uint8_t to_bcd(uint32_t value) {
+    return uint8_t((value / 10) << 4 | value % 10);
+}
+
+static uint32_t from_bcd(uint8_t value) {
+    return (value >> 4) * 10 + (value & 0x0F);
+}
+
+uint64_t Cia::Timer::count(uint64_t ticks) {
+    if (!running() || ticks <= counter) {
+        if (running()) {
+            counter -= ticks;
+        }
+        return 0;
+    }
+    // it reads 0 for a tick, then underflows and reloads the latch
+    ticks -= counter + 1;
+    if (one_shot()) {
+        counter = latch;
+        control &= ~0x01;
+        return 1;
+    }
+    uint64_t period = uint64_t(latch) + 1;
+    counter = latch - ticks % period;
+    return 1 + ticks / period;
+}
+
+void Cia::run_until(uint64_t now) {
+    if (now <= clock) {
+        return;
+    }
+    uint64_t cycles = now - clock;
+
+    uint64_t a_underflows = (timer_a.control & 0x20) ? 0 : timer_a.count(cycles);
+    if (a_underflows > 0) {
+        flags |= 0x01;
+    }
+    uint64_t b_ticks = b_counts_a() ? a_underflows : (timer_b.control & 0x20) ? 0 : cycles;
+    if (timer_b.count(b_ticks) > 0) {
+        flags |= 0x02;
+    }
+    if (tod_running && alarm_after(clock) <= now) {
+        flags |= 0x04;
+    }
+    clock = now;
+}
+
+uint64_t Cia::next_irq() const {
+    uint64_t due = UINT64_MAX;
+    bool a_counts = timer_a.running() && (timer_a.control & 0x20) == 0;
+    // an underflow comes one cycle after the counter reads 0
+    uint64_t a_next = clock + timer_a.counter + 1;
+    if ((mask & 0x01) && a_counts) {
+        due = std::min(due, a_next);
+    }
+    if ((mask & 0x02) && timer_b.running()) {
+        if (!b_counts_a() && (timer_b.control & 0x20) == 0) {
+            due = std::min(due, clock + timer_b.counter + 1);
+        } else if (b_counts_a() && a_counts && (timer_b.counter == 0 || !timer_a.one_shot())) {
+            due = std::min(due, a_next + uint64_t(timer_b.counter) * (uint64_t(timer_a.latch) + 1));
+        }
+    }
+    if ((mask & 0x04) && tod_running) {
+        due = std::min(due, alarm_after(clock));
+    }
+    return due;
+}
+
+uint8_t Cia::read(uint8_t reg, uint64_t now, bool read_only) {
+    switch (reg & 0x0F) {
+        case 0x0: return port_a_in();
+        case 0x1: return port_b_in();
+        case 0x2: return ddra;
+        case 0x3: return ddrb;
+        case 0x4: return timer_a.counter & 0xFF;
+        case 0x5: return timer_a.counter >> 8;
+        case 0x6: return timer_b.counter & 0xFF;
+        case 0x7: return timer_b.counter >> 8;
+        case 0x8:
+        case 0x9:
+        case 0xA:
+        case 0xB: {
+            uint32_t tenths = tod_latched ? tod_latch : time_of_day(now);
+            if (!read_only) {
+                if ((reg & 0x0F) == 0xB) {
+                    tod_latched = true;
+                    tod_latch = tenths;
+                } else if ((reg & 0x0F) == 0x8) {
+                    tod_latched = false;
+                }
+            }
+            return read_tod(reg & 0x0F, tenths);
+        }
+        case 0xC: return sdr;
+        case 0xD: {
+            uint8_t value = flags | (irq() ? 0x80 : 0x00);
+            if (!read_only) {
+                flags = 0;
+            }
+            return value;
+        }
+        case 0xE: return timer_a.control & ~0x10;
+        default: return timer_b.control & ~0x10;
+    }
+}
+
+void Cia::write(uint8_t reg, uint8_t value, uint64_t now) {
+    switch (reg & 0x0F) {
+        case 0x0: pra = value; break;
+        case 0x1: prb = value; break;
+        case 0x2: ddra = value; break;
+        case 0x3: ddrb = value; break;
+        case 0x4:
+        case 0x6: {
+            auto &timer = (reg & 0x0F) == 0x4 ? timer_a : timer_b;
+            timer.latch = (timer.latch & 0xFF00) | value;
+            break;
+        }
+        case 0x5:
+        case 0x7: {
+            auto &timer = (reg & 0x0F) == 0x5 ? timer_a : timer_b;
+            timer.latch = (timer.latch & 0x00FF) | value << 8;
+            // a stopped timer loads the latch with its high byte
+            if (!timer.running()) {
+                timer.counter = timer.latch;
+            }
+            break;
+        }
+        case 0x8:
+        case 0x9:
+        case 0xA:
+        case 0xB:
+            if (timer_b.control & 0x80) {
+                alarm = write_tod(reg & 0x0F, value, alarm);
+            } else {
+                // writing the hours stops the clock until the tenths are written
+                uint32_t tenths = write_tod(reg & 0x0F, value, time_of_day(now));
+                set_time_of_day(tenths, now, (reg & 0x0F) == 0x8 ? true : (reg & 0x0F) == 0xB ? false : tod_running);
+            }
+            break;
+        case 0xC: sdr = value; break;
+        case 0xD:
+            if (value & 0x80) {
+                mask |= value & 0x1F;
+            } else {
+                mask &= ~(value & 0x1F);
+            }
+            break;
+        case 0xE:
+        case 0xF: {
+            bool is_a = (reg & 0x0F) == 0xE;
+            auto &timer = is_a ? timer_a : timer_b;
+            if (is_a && ((value ^ timer.control) & 0x80)) {
+                // TODIN changes how fast the clock goes from here on
+                set_time_of_day(time_of_day(now), now, tod_running);
+            }
+            timer.control = value & ~0x10;
+            if (value & 0x10) {
+                timer.counter = timer.latch; // force load strobe
+            }
+            break;
+        }
+    }
+}
+
+void Cia::set_key(uint8_t column, uint8_t row, bool pressed) {
+    if (pressed) {
+        keys[column & 7] |= 1u << (row & 7);
+    } else {
+        keys[column & 7] &= ~(1u << (row & 7));
+    }
+}
+
+uint8_t Cia::port_a_in() const {
+    // a row driven low through a pressed key pulls its column low as well
+    uint8_t rows_out = (prb | ~ddrb) & ~joystick_b;
+    uint8_t value = port_a_out() & ~joystick_a;
+    for (int column = 0; column < 8; column++) {
+        if (keys[column] & ~rows_out) {
+            value &= ~(1u << column);
+        }
+    }
+    return value;
+}
+
+uint8_t Cia::port_b_in() const {
+    uint8_t columns_out = port_a_out() & ~joystick_a;
+    uint8_t value = (prb | ~ddrb) & ~joystick_b;
+    for (int column = 0; column < 8; column++) {
+        if ((columns_out & (1u << column)) == 0) {
+            value &= ~keys[column];
+        }
+    }
+    return value;
+}
+
+uint32_t Cia::time_of_day(uint64_t now) const {
+    if (!tod_running) {
+        return tod_base;
+    }
+    uint64_t ticks = (now - tod_clock) * 50 / clock_rate / tod_divider();
+    return uint32_t((tod_base + ticks) % tenths_per_day);
+}
+
+void Cia::set_time_of_day(uint32_t tenths, uint64_t now, bool running) {
+    tod_base = tenths % tenths_per_day;
+    tod_clock = now;
+    tod_running = running;
+}
+
+uint64_t Cia::alarm_after(uint64_t after) const {
+    if (!tod_running) {
+        return UINT64_MAX;
+    }
+    // tenth k starts at the first cycle where k * divider 50 Hz ticks have passed
+    uint64_t cycles_per_tick = tod_divider() * clock_rate;
+    uint64_t k = (alarm + tenths_per_day - tod_base) % tenths_per_day;
+    if (k == 0) {
+        k = tenths_per_day;
+    }
+    uint64_t passed = after >= tod_clock ? after - tod_clock : 0;
+    uint64_t k_passed = passed * 50 / cycles_per_tick;
+    if (k <= k_passed) {
+        k += (k_passed - k) / tenths_per_day * tenths_per_day + tenths_per_day;
+    }
+    return tod_clock + (k * cycles_per_tick + 49) / 50;
+}
+
+uint8_t Cia::read_tod(uint8_t reg, uint32_t tenths) const {
+    switch (reg) {
+        case 0x8: return tenths % 10;
+        case 0x9: return to_bcd(tenths / 10 % 60);
+        case 0xA: return to_bcd(tenths / 600 % 60);
+        default: {
+            uint32_t hours = tenths / 36000;
+            uint32_t twelve = hours % 12 == 0 ? 12 : hours % 12;
+            return to_bcd(twelve) | (hours >= 12 ? 0x80 : 0x00);
+        }
+    }
+}
+
+uint32_t Cia::write_tod(uint8_t reg, uint8_t value, uint32_t tenths) {
+    uint32_t fraction = tenths % 10;
+    uint32_t seconds = tenths / 10 % 60;
+    uint32_t minutes = tenths / 600 % 60;
+    uint32_t hours = tenths / 36000;
+    switch (reg) {
+        case 0x8: fraction = std::min<uint32_t>(value & 0x0F, 9); break;
+        case 0x9: seconds = std::min<uint32_t>(from_bcd(value & 0x7F), 59); break;
+        case 0xA: minutes = std::min<uint32_t>(from_bcd(value & 0x7F), 59); break;
+        default: hours = std::min<uint32_t>(from_bcd(value & 0x1F), 12) % 12 + ((value & 0x80) ? 12 : 0); break;
+    }
+    return ((hours * 60 + minutes) * 60 + seconds) * 10 + fraction;
+}
+
+Cia::State Cia::save_state(uint64_t now) const {
+    if (now > clock) {
+        Cia ahead = *this;
+        ahead.run_until(now);
+        return ahead.save_state(now);
+    }
+    State state{};
+    state.clock = clock;
+    state.tod_clock = tod_clock;
+    state.tod_base = tod_base;
+    state.alarm = alarm;
+    state.tod_latch = tod_latch;
+    state.latch_a = timer_a.latch;
+    state.counter_a = timer_a.counter;
+    state.latch_b = timer_b.latch;
+    state.counter_b = timer_b.counter;
+    state.control_a = timer_a.control;
+    state.control_b = timer_b.control;
+    state.pra = pra;
+    state.prb = prb;
+    state.ddra = ddra;
+    state.ddrb = ddrb;
+    state.flags = flags;
+    state.mask = mask;
+    state.sdr = sdr;
+    state.tod_running = tod_running;
+    state.tod_latched = tod_latched;
+    state.joystick_a = joystick_a;
+    state.joystick_b = joystick_b;
+    std::memcpy(state.keys, keys, sizeof(keys));
+    return state;
+}
+
+void Cia::load_state(State const &state) {
+    clock = state.clock;
+    tod_clock = state.tod_clock;
+    tod_base = state.tod_base % tenths_per_day;
+    alarm = state.alarm % tenths_per_day;
+    tod_latch = state.tod_latch % tenths_per_day;
+    timer_a.latch = state.latch_a;
+    timer_a.counter = state.counter_a;
+    timer_b.latch = state.latch_b;
+    timer_b.counter = state.counter_b;
+    timer_a.control = state.control_a;
+    timer_b.control = state.control_b;
+    pra = state.pra;
+    prb = state.prb;
+    ddra = state.ddra;
+    ddrb = state.ddrb;
+    flags = state.flags & 0x1F;
+    mask = state.mask & 0x1F;
+    sdr = state.sdr;
+    tod_running = state.tod_running != 0;
+    tod_latched = state.tod_latched != 0;
+    joystick_a = state.joystick_a;
+    joystick_b = state.joystick_b;
+    std::memcpy(keys, state.keys, sizeof(keys));
+}
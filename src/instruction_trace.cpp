@@ -0,0 +1,395 @@
+#include "c64/instruction_trace.hpp"
+#include "c64/instrumentation.hpp"
+#include "c64/opcodes.hpp"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+// File layout: an 8 byte header, then blocks of a u32 raw size and a u32
+// stored size (equal when the block did not compress) followed by the data.
+// The blocks hold one encoded record after the other:
+//
+//   flags      which of the fields below follow
+//   pc         2 bytes, unless it is the previous PC plus the instruction's length
+//   bytes      3 bytes, unless they are what was last recorded at this PC
+//   a x y sp p 1 byte each, for those that changed
+//   cycle      the distance to the previous record, LEB128
+static constexpr char trace_magic[4] = {'C', '6', '4', 'T'};
+static constexpr uint16_t trace_version = 1;
+static constexpr size_t block_size = 0x10000;
+static constexpr size_t max_record_size = 1 + 2 + 3 + 5 + 10;
+
+enum TraceFlags : uint8_t {
+    HasPC = 0x01,
+    HasBytes = 0x02,
+    HasA = 0x04,
+    HasX = 0x08,
+    HasY = 0x10,
+    HasSP = 0x20,
+    HasP = 0x40
+};
+
+static constexpr std::array<uint8_t, 256> instruction_lengths = [] {
+    std::array<uint8_t, 256> lengths{};
+    enum Mode { IMP, IMM, ZP0, ZPX, ZPY, REL, ABS, ABX, ABY, IND, IZX, IZY };
+    constexpr auto length = [](Mode mode) {
+        return mode == IMP ? 1 : (mode == ABS || mode == ABX || mode == ABY || mode == IND) ? 3 : 2;
+    };
+#define C64_LENGTH_ENTRY(op, mode, inst, cyc) lengths[op] = length(mode);
+    C64_OPCODES(C64_LENGTH_ENTRY)
+#undef C64_LENGTH_ENTRY
+    return lengths;
+}();
+
+TraceRecord trace_record(CPU6502Base const &cpu, CPUIO &bus, uint64_t cycle) {
+    TraceRecord record{};
+    record.cycle = cycle;
+    record.pc = cpu.pc;
+    for (int i = 0; i < 3; i++) {
+        record.bytes[i] = bus.read(cpu.pc + i, true);
+    }
+    record.a = cpu.a;
+    record.x = cpu.x;
+    record.y = cpu.y;
+    record.sp = cpu.stkp;
+    record.p = cpu.status;
+    return record;
+}
+
+InstructionTracer::InstructionTracer(FILE *out, size_t capacity) :
+        ring(capacity), out(out), code(std::make_unique<uint8_t[]>(0x10000 * 3)) {
+    uint8_t header[8] = {};
+    std::memcpy(header, trace_magic, 4);
+    std::memcpy(header + 4, &trace_version, 2);
+    std::fwrite(header, 1, sizeof(header), out);
+    written.store(sizeof(header), std::memory_order_relaxed);
+    block.reserve(block_size);
+
+    write_thread = std::thread([this] {
+        while (running.load(std::memory_order_acquire)) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+}
+
+InstructionTracer::~InstructionTracer() {
+    running.store(false, std::memory_order_release);
+    write_thread.join();
+    while (drain() > 0) {}
+    flush_block();
+    std::fflush(out);
+}
+
+size_t InstructionTracer::drain() {
+    TraceRecord batch[256];
+    size_t count = ring.pop(batch, 256);
+    for (size_t i = 0; i < count; i++) {
+        encode(batch[i]);
+    }
+    return count;
+}
+
+void InstructionTracer::encode(TraceRecord const &record) {
+    if (block.size() + max_record_size > block_size) {
+        flush_block();
+    }
+
+    size_t flags_at = block.size();
+    block.push_back(0);
+    uint8_t flags = 0;
+
+    uint16_t expected_pc = previous.pc + instruction_lengths[previous.bytes[0]];
+    if (record.pc != expected_pc) {
+        flags |= HasPC;
+        block.push_back(record.pc & 0xFF);
+        block.push_back(record.pc >> 8);
+    }
+    uint8_t *known = &code[record.pc * 3];
+    if (std::memcmp(known, record.bytes, 3) != 0) {
+        flags |= HasBytes;
+        block.insert(block.end(), record.bytes, record.bytes + 3);
+        std::memcpy(known, record.bytes, 3);
+    }
+
+    const std::pair<uint8_t, uint8_t> registers[] = {
+            {record.a, previous.a}, {record.x, previous.x}, {record.y, previous.y},
+            {record.sp, previous.sp}, {record.p, previous.p},
+    };
+    for (int i = 0; i < 5; i++) {
+        if (registers[i].first != registers[i].second) {
+            flags |= HasA << i;
+            block.push_back(registers[i].first);
+        }
+    }
+
+    uint64_t delta = record.cycle - previous.cycle;
+    do {
+        block.push_back((delta & 0x7F) | (delta >= 0x80 ? 0x80 : 0x00));
+        delta >>= 7;
+    } while (delta != 0);
+
+    block[flags_at] = flags;
+    previous = record;
+}
+
+void InstructionTracer::flush_block() {
+    if (block.empty()) {
+        return;
+    }
+    compressed.clear();
+    lz_compress(block.data(), block.size(), compressed);
+    bool stored = compressed.size() >= block.size();
+    auto &data = stored ? block : compressed;
+
+    uint32_t sizes[2] = {uint32_t(block.size()), uint32_t(data.size())};
+    std::fwrite(sizes, sizeof(uint32_t), 2, out);
+    std::fwrite(data.data(), 1, data.size(), out);
+    written.fetch_add(sizeof(sizes) + data.size(), std::memory_order_relaxed);
+    block.clear();
+}
+
+TraceReader::TraceReader(FILE *in) : in(in), code(std::make_unique<uint8_t[]>(0x10000 * 3)) {
+    uint8_t header[8];
+    uint16_t version;
+    if (std::fread(header, 1, sizeof(header), in) != sizeof(header) || std::memcmp(header, trace_magic, 4) != 0) {
+        throw std::runtime_error("not an instruction trace");
+    }
+    std::memcpy(&version, header + 4, 2);
+    if (version != trace_version) {
+        throw std::runtime_error("unsupported instruction trace version");
+    }
+}
+
+bool TraceReader::read_block() {
+    uint32_t sizes[2];
+    size_t got = std::fread(sizes, sizeof(uint32_t), 2, in);
+    if (got == 0) {
+        return false;
+    }
+    if (got != 2 || sizes[0] > block_size || sizes[1] > sizes[0]) {
+        throw std::runtime_error("corrupt instruction trace block");
+    }
+    block.resize(sizes[0]);
+    compressed.resize(sizes[1]);
+    if (std::fread(compressed.data(), 1, sizes[1], in) != sizes[1]) {
+        throw std::runtime_error("instruction trace is truncated");
+    }
+    if (sizes[0] == sizes[1]) {
+        block.swap(compressed);
+    } else {
+        lz_decompress(compressed.data(), compressed.size(), block.data(), block.size());
+    }
+    position = 0;
+    return true;
+}
+
+uint8_t TraceReader::byte() {
+    if (position == block.size()) {
+        throw std::runtime_error("instruction trace record crosses a block");
+    }
+    return block[position++];
+}
+
+bool TraceReader::next(TraceRecord &record) {
+    while (position == block.size()) {
+        if (!read_block()) {
+            return false;
+        }
+    }
+
+    uint8_t flags = byte();
+    record = previous;
+    record.pc = previous.pc + instruction_lengths[previous.bytes[0]];
+    if (flags & HasPC) {
+        record.pc = byte();
+        record.pc |= byte() << 8;
+    }
+    uint8_t *known = &code[record.pc * 3];
+    if (flags & HasBytes) {
+        for (int i = 0; i < 3; i++) {
+            known[i] = byte();
+        }
+    }
+    std::memcpy(record.bytes, known, 3);
+
+    uint8_t *registers[] = {&record.a, &record.x, &record.y, &record.sp, &record.p};
+    for (int i = 0; i < 5; i++) {
+        if (flags & (HasA << i)) {
+            *registers[i] = byte();
+        }
+    }
+
+    uint64_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t value = byte();
+        if (shift > 63) {
+            throw std::runtime_error("corrupt cycle delta in instruction trace");
+        }
+        delta |= uint64_t(value & 0x7F) << shift;
+        if ((value & 0x80) == 0) {
+            break;
+        }
+    }
+    record.cycle = previous.cycle + delta;
+
+    previous = record;
+    return true;
+}
+
+namespace {
+    /// Serves the instruction bytes of a record to c64tools::address
+    class RecordBus : public CPUIO {
+    public:
+        explicit RecordBus(TraceRecord const &record) : record(record) {}
+
+        uint8_t read(uint16_t addr, bool) override {
+            uint16_t offset = addr - record.pc;
+            return offset < 3 ? record.bytes[offset] : 0x00;
+        }
+
+        void write(uint16_t, uint8_t) override {}
+
+        void interrupt(Interrupt) override {}
+
+    private:
+        TraceRecord const &record;
+    };
+}
+
+std::string format_trace_record(TraceRecord const &record) {
+    static const CPU6502Base cpu;
+    auto info = cpu.instruction_info(record.bytes[0]);
+    auto bus = RecordBus(record);
+
+    std::string bytes = fmt::format("{:02X}", record.bytes[0]);
+    for (int i = 1; i < instruction_lengths[record.bytes[0]]; i++) {
+        bytes += fmt::format(" {:02X}", record.bytes[i]);
+    }
+    auto flags = c64tools::cpu_flags_to_string(record.p);
+    return fmt::format("{:04X}  {:<9}{}{} {:<28}A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{} {} {}",
+                       record.pc, bytes, info.non_standard ? "*" : " ", info.instruction,
+                       c64tools::address(cpu, bus, record.pc), record.a, record.x, record.y, record.p, record.sp,
+                       record.cycle, info.addr_mode, flags);
+}
+
+static constexpr size_t min_match = 4;
+static constexpr int hash_bits = 14;
+
+static uint32_t hash4(uint8_t const *p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+static void put_length(std::vector<uint8_t> &out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(uint8_t(length));
+}
+
+void lz_compress(uint8_t const *data, size_t size, std::vector<uint8_t> &out) {
+    std::vector<uint32_t> table(size_t(1) << hash_bits, UINT32_MAX);
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    auto emit = [&](size_t literals, size_t match, size_t offset) {
+        uint8_t token = uint8_t(std::min<size_t>(literals, 15) << 4);
+        if (match != 0) {
+            token |= uint8_t(std::min<size_t>(match - min_match, 15));
+        }
+        out.push_back(token);
+        if (literals >= 15) {
+            put_length(out, literals - 15);
+        }
+        out.insert(out.end(), data + anchor, data + anchor + literals);
+        if (match != 0) {
+            out.push_back(offset & 0xFF);
+            out.push_back(offset >> 8);
+            if (match - min_match >= 15) {
+                put_length(out, match - min_match - 15);
+            }
+        }
+    };
+
+    while (pos + min_match <= size) {
+        uint32_t h = hash4(data + pos);
+        size_t candidate = table[h];
+        table[h] = uint32_t(pos);
+        if (candidate == UINT32_MAX || pos - candidate > 0xFFFF ||
+            std::memcmp(data + candidate, data + pos, min_match) != 0) {
+            pos++;
+            continue;
+        }
+        size_t match = min_match;
+        while (pos + match < size && data[candidate + match] == data[pos + match]) {
+            match++;
+        }
+        emit(pos - anchor, match, pos - candidate);
+        pos += match;
+        anchor = pos;
+    }
+    // whatever is left goes out as literals, the decoder stops after them
+    emit(size - anchor, 0, 0);
+}
+
+void lz_decompress(uint8_t const *data, size_t size, uint8_t *out, size_t out_size) {
+    size_t in = 0;
+    size_t pos = 0;
+    auto length = [&](size_t value) {
+        uint8_t extra;
+        do {
+            if (in == size) {
+                throw std::runtime_error("truncated LZ length");
+            }
+            extra = data[in++];
+            value += extra;
+        } while (extra == 255);
+        return value;
+    };
+
+    while (in < size) {
+        uint8_t token = data[in++];
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals = length(literals);
+        }
+        if (literals > size - in || literals > out_size - pos) {
+            throw std::runtime_error("LZ literals out of bounds");
+        }
+        std::memcpy(out + pos, data + in, literals);
+        in += literals;
+        pos += literals;
+        if (in == size) {
+            break;
+        }
+
+        if (size - in < 2) {
+            throw std::runtime_error("truncated LZ offset");
+        }
+        size_t offset = data[in] | data[in + 1] << 8;
+        in += 2;
+        size_t match = token & 0x0F;
+        if (match == 15) {
+            match = length(match);
+        }
+        match += min_match;
+        if (offset == 0 || offset > pos || match > out_size - pos) {
+            throw std::runtime_error("LZ match out of bounds");
+        }
+        // byte by byte, matches may overlap what they produce
+        for (size_t i = 0; i < match; i++, pos++) {
+            out[pos] = out[pos - offset];
+        }
+    }
+    if (pos != out_size) {
+        throw std::runtime_error("LZ block has the wrong size");
+    }
+}
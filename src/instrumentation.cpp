@@ -2,6 +2,9 @@
 #include "c64/instrumentation.hpp"
 #include "c64/cpu_6502.hpp"
 
+#include <algorithm>
+#include <map>
+
 
 std::string c64tools::cpu_flags_to_string(uint8_t flags) {
     auto c = is_flag_set(Flags6502::C, flags) ? "C" : ".";
@@ -19,9 +22,13 @@ constexpr unsigned int hash(const char* str, int h = 0) {
     return !str[h] ? 5381 : (hash(str, h + 1) * 33) ^ str[h];
 }
 
-std::string c64tools::address(CPU6502 const& cpu, CPUIO& bus) {
-    auto opcode = bus.read(cpu.pc, true);
-    uint16_t addr = cpu.pc + 1;
+std::string c64tools::address(CPU6502Base const& cpu, CPUIO& bus) {
+    return address(cpu, bus, cpu.pc);
+}
+
+std::string c64tools::address(CPU6502Base const& cpu, CPUIO& bus, uint16_t pc) {
+    auto opcode = bus.read(pc, true);
+    uint16_t addr = pc + 1;
     auto instruction_info = cpu.instruction_info(opcode);
     auto addr_mode_name = instruction_info.addr_mode;
     auto instruction_name = instruction_info.instruction;
@@ -100,4 +107,53 @@ std::string c64tools::address(CPU6502 const& cpu, CPUIO& bus) {
             return fmt::format("Unknown {}", addr_mode_name);
         }
     }
-}
\ No newline at end of file
+}
+std::string c64tools::profile_report(Profiler const& profiler, SymbolTable const& symbols,
+                                     CPU6502Base const& cpu, CPUIO& bus, size_t top) {
+    uint64_t total = std::max<uint64_t>(profiler.total_cycles(), 1);
+    auto percent = [total](uint64_t cycles) { return 100.0 * double(cycles) / double(total); };
+
+    // routines without a symbol are grouped by page
+    std::map<std::string, uint64_t> routines;
+    std::vector<uint16_t> hot;
+    for (uint32_t pc = 0; pc < 0x10000; pc++) {
+        if (profiler.cycles(pc) == 0) {
+            continue;
+        }
+        auto symbol = symbols.find(pc);
+        auto name = symbol != nullptr ? symbol->name : fmt::format("${:02X}xx", pc >> 8);
+        routines[name] += profiler.cycles(pc);
+        hot.push_back(pc);
+    }
+
+    std::string report = fmt::format("{} cycles\n\nRoutines\n", profiler.total_cycles());
+    std::vector<std::pair<std::string, uint64_t>> by_cycles(routines.begin(), routines.end());
+    std::sort(by_cycles.begin(), by_cycles.end(), [](auto const &a, auto const &b) { return a.second > b.second; });
+    for (size_t i = 0; i < by_cycles.size() && i < top; i++) {
+        report += fmt::format("{:>12d} {:>6.2f}%  {}\n", by_cycles[i].second, percent(by_cycles[i].second),
+                              by_cycles[i].first);
+    }
+
+    report += "\nInstructions\n";
+    std::sort(hot.begin(), hot.end(), [&](uint16_t a, uint16_t b) { return profiler.cycles(a) > profiler.cycles(b); });
+    for (size_t i = 0; i < hot.size() && i < top; i++) {
+        uint16_t pc = hot[i];
+        auto info = cpu.instruction_info(bus.read(pc, true));
+        report += fmt::format("{:>12d} {:>6.2f}% {:>10d}x  ${:04X} {:<3} {:<9} {}\n",
+                              profiler.cycles(pc), percent(profiler.cycles(pc)), profiler.instructions(pc),
+                              pc, info.instruction, address(cpu, bus, pc), symbols.describe(pc));
+    }
+
+    if (profiler.has_call_graph()) {
+        report += "\nCalls\n";
+        auto edges = profiler.call_edges();
+        for (size_t i = 0; i < edges.size() && i < top; i++) {
+            auto &edge = edges[i];
+            auto caller = edge.caller == Profiler::root ? std::string("-") : symbols.describe(edge.caller);
+            report += fmt::format("{:>12d} {:>6.2f}% {:>10d}x  {} -> {}{}\n",
+                                  edge.cycles, percent(edge.cycles), edge.calls, caller,
+                                  symbols.describe(edge.callee), edge.interrupt ? " (interrupt)" : "");
+        }
+    }
+    return report;
+}
@@ -0,0 +1,97 @@
+#include "c64/jit_x64.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef C64_JIT_X64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool JitBuffer::supported() {
+#ifdef C64_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+JitBuffer::JitBuffer(size_t size) {
+#ifdef C64_JIT_X64
+    page_size = sysconf(_SC_PAGESIZE);
+    capacity = (size + page_size - 1) / page_size * page_size;
+    void *mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("unable to map memory for the JIT");
+    }
+    memory = static_cast<uint8_t *>(mapping);
+#endif
+}
+
+JitBuffer::~JitBuffer() {
+#ifdef C64_JIT_X64
+    if (memory != nullptr) {
+        munmap(memory, capacity);
+    }
+#endif
+}
+
+bool JitBuffer::protect(size_t from, size_t to, bool executable) {
+#ifdef C64_JIT_X64
+    size_t first = from / page_size * page_size;
+    size_t last = (to + page_size - 1) / page_size * page_size;
+    if (last > first &&
+        mprotect(memory + first, last - first, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) != 0) {
+        // e.g. a W^X policy refusing PROT_EXEC, nothing can run from here on
+        failed = true;
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool JitBuffer::begin(size_t max_size) {
+    if (memory == nullptr || failed || used + max_size > capacity) {
+        return false;
+    }
+    start = used;
+    return protect(start, start + max_size, false);
+}
+
+void *JitBuffer::finish() {
+    // the tail of the last page may be reused by the next function
+    if (!protect(start, used, true)) {
+        return nullptr;
+    }
+    return memory + start;
+}
+
+void JitBuffer::reset() {
+    used = 0;
+    start = 0;
+}
+
+void JitBuffer::emit(std::initializer_list<uint8_t> bytes) {
+    for (uint8_t byte: bytes) {
+        memory[used++] = byte;
+    }
+}
+
+void JitBuffer::emit8(uint8_t value) {
+    memory[used++] = value;
+}
+
+void JitBuffer::emit32(uint32_t value) {
+    std::memcpy(memory + used, &value, sizeof(value));
+    used += sizeof(value);
+}
+
+void JitBuffer::emit64(uint64_t value) {
+    std::memcpy(memory + used, &value, sizeof(value));
+    used += sizeof(value);
+}
+
+void JitBuffer::patch_rel32(size_t at, size_t target) {
+    auto rel = static_cast<int32_t>(target - (at + 4));
+    std::memcpy(memory + at, &rel, sizeof(rel));
+}
@@ -0,0 +1,85 @@
+#include "c64/profiler.hpp"
+
+#include <algorithm>
+
+Profiler::Profiler(bool call_graph)
+        : instruction_counts(std::make_unique<uint64_t[]>(0x10000)),
+          cycle_counts(std::make_unique<uint64_t[]>(0x10000)),
+          call_graph(call_graph) {
+}
+
+void Profiler::interrupt(uint16_t pc, uint16_t handler, uint8_t cycles) {
+    cycle_counts[handler] += cycles;
+    total += cycles;
+    if (call_graph) {
+        enter(handler, pc, true);
+    }
+}
+
+void Profiler::clear() {
+    std::fill_n(instruction_counts.get(), 0x10000, 0);
+    std::fill_n(cycle_counts.get(), 0x10000, 0);
+    total = 0;
+    stack.clear();
+    edges.clear();
+}
+
+std::vector<CallEdge> Profiler::call_edges() const {
+    std::vector<CallEdge> result;
+    result.reserve(edges.size());
+    for (auto const &[key, edge]: edges) {
+        if (edge.calls > 0) {
+            result.push_back(edge);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](CallEdge const &a, CallEdge const &b) {
+        return a.cycles > b.cycles;
+    });
+    return result;
+}
+
+void Profiler::follow_call(uint16_t pc, uint8_t opcode, uint16_t next_pc) {
+    switch (opcode) {
+        case 0x20: // JSR
+            enter(next_pc, pc + 3, false);
+            break;
+        case 0x00: // BRK skips a padding byte
+            enter(next_pc, pc + 2, true);
+            break;
+        case 0x60: // RTS
+        case 0x40: // RTI
+            leave(next_pc);
+            break;
+        default:
+            break;
+    }
+}
+
+void Profiler::enter(uint16_t callee, uint16_t return_to, bool interrupt) {
+    uint32_t caller = stack.empty() ? root : edges.at(stack.back().edge).callee;
+    uint64_t key = uint64_t(caller) << 17 | uint64_t(interrupt) << 16 | callee;
+    edges.try_emplace(key, CallEdge{caller, callee, interrupt, 0, 0});
+
+    if (stack.size() == max_depth) {
+        stack.erase(stack.begin());
+    }
+    stack.push_back({key, return_to, total});
+}
+
+void Profiler::leave(uint16_t return_to) {
+    // code that drops return addresses or jumps through an RTS leaves frames
+    // behind, they end with the first one returned from further down
+    auto it = std::find_if(stack.rbegin(), stack.rend(), [return_to](Frame const &frame) {
+        return frame.return_to == return_to;
+    });
+    if (it == stack.rend()) {
+        return;
+    }
+    size_t depth = stack.rend() - it - 1;
+    while (stack.size() > depth) {
+        auto &edge = edges.at(stack.back().edge);
+        edge.calls++;
+        edge.cycles += total - stack.back().entered;
+        stack.pop_back();
+    }
+}
@@ -1,23 +1,28 @@
 #include <c64/instrumentation.hpp>
 #include <fmt/core.h>
 #include "c64/pyc64.hpp"
+#include "c64/vec_c64.hpp"
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <algorithm>
+#include <stdexcept>
 namespace py = pybind11;
 
 pyC64::pyC64() : c64() {
 
 }
 
-const CPU6502& pyC64::cpu() const {
+const CPU6502Base& pyC64::cpu() const {
     return c64.get_cpu();
 }
 
 std::string pyC64::disassemble(uint16_t addr) {
-    auto cpu = c64.get_cpu();
+    auto &cpu = c64.get_cpu();
     auto opcode = c64.read(addr, true);
     auto info = cpu.instruction_info(opcode);
-    auto addr_str = c64tools::address(cpu, c64);
+    auto addr_str = c64tools::address(cpu, c64, addr);
     auto instruction = info.instruction;
     auto ns = info.non_standard ? "*" : " ";
     auto addr_mode = info.addr_mode;
@@ -26,28 +31,300 @@ std::string pyC64::disassemble(uint16_t addr) {
                        addr, ns, instruction, addr_str, addr_mode);
 }
 
+void pyC64::sync_ram() {
+    if (ram_shared) {
+        c64.ram_written();
+    }
+}
+
 bool pyC64::clock() {
-    return c64.clock();;
+    sync_ram();
+    return c64.clock();
+}
+
+uint32_t pyC64::step_instruction() {
+    sync_ram();
+    return c64.step_instruction();
+}
+
+uint64_t pyC64::run_cycles(uint64_t cycles) {
+    sync_ram();
+    return c64.run_for_cycles(cycles);
+}
+
+uint64_t pyC64::run_until_pc(uint16_t addr, uint64_t max_cycles) {
+    sync_ram();
+    return c64.run_until_pc(addr, max_cycles);
+}
+
+uint64_t pyC64::run_frames(uint64_t frames) {
+    sync_ram();
+    return c64.run_frames(frames);
 }
 
 void pyC64::reset() {
     c64.reset();
 }
 
-PYBIND11_MODULE(pyC64, m) {
-    auto cpu = py::class_<CPU6502>(m, "_cpu");
-    cpu.def_readonly("a", &CPU6502::a);
-    cpu.def_readonly("x", &CPU6502::x);
-    cpu.def_readonly("y", &CPU6502::y);
-    cpu.def_readonly("pc", &CPU6502::pc);
-    cpu.def_readonly("stkp", &CPU6502::stkp);
-    cpu.def_readonly("status", &CPU6502::status);
+void pyC64::set_dispatch(Dispatch dispatch) {
+    c64.set_dispatch(dispatch);
+}
+
+py::bytes pyC64::save_state() const {
+    auto state = c64.save_state();
+    return {reinterpret_cast<const char *>(state.data()), state.size()};
+}
+
+void pyC64::load_state(py::bytes const &state) {
+    auto data = std::string(state);
+    c64.load_state(std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+/// Calls back into Python from a run, which has released the GIL
+static BreakCondition python_condition(py::object const &condition) {
+    if (condition.is_none()) {
+        return {};
+    }
+    return [condition](C64 &) {
+        py::gil_scoped_acquire gil;
+        return condition().cast<bool>();
+    };
+}
+
+int pyC64::add_breakpoint(uint16_t addr, py::object const &condition) {
+    return c64.add_breakpoint(addr, python_condition(condition));
+}
+
+int pyC64::add_watchpoint(uint16_t first, uint16_t last, Access access, py::object const &condition) {
+    return c64.add_watchpoint(first, last, access, python_condition(condition));
+}
+
+bool pyC64::remove_breakpoint(int id) {
+    return c64.remove_breakpoint(id);
+}
+
+void pyC64::clear_breakpoints() {
+    c64.clear_breakpoints();
+}
+
+std::optional<BreakEvent> pyC64::last_break() const {
+    return c64.last_break();
+}
+
+void pyC64::enable_profiler(bool call_graph) {
+    c64.enable_profiler(call_graph);
+}
+
+void pyC64::disable_profiler() {
+    c64.disable_profiler();
+}
+
+std::string pyC64::profile_report(size_t top) {
+    auto profiler = c64.get_profiler();
+    if (profiler == nullptr) {
+        return {};
+    }
+    auto symbols = SymbolTable::c64(*c64.rom_set());
+    return c64tools::profile_report(*profiler, symbols, c64.get_cpu(), c64, top);
+}
+
+py::array_t<uint8_t> pyC64::frame() {
+    auto &vic = c64.get_vic();
+    auto result = py::array_t<uint8_t>({py::ssize_t(VicII::frame_height), py::ssize_t(VicII::frame_width)});
+    std::copy_n(vic.frame(), VicII::frame_width * VicII::frame_height, result.mutable_data());
+    return result;
+}
+
+py::array_t<uint8_t> pyC64::frame_rgba() {
+    auto &vic = c64.get_vic();
+    auto result = py::array_t<uint8_t>({py::ssize_t(VicII::frame_height), py::ssize_t(VicII::frame_width), py::ssize_t(4)});
+    vic.frame_rgba(result.mutable_data());
+    return result;
+}
+
+std::string pyC64::screen_text() {
+    sync_ram();
+    return c64.render_text_screen().ascii();
+}
+
+py::array_t<uint8_t> pyC64::screen_rgba() {
+    sync_ram();
+    auto &screen = c64.render_text_screen();
+    auto result = py::array_t<uint8_t>({py::ssize_t(TextScreen::height), py::ssize_t(TextScreen::width), py::ssize_t(4)});
+    std::copy_n(screen.rgba(), TextScreen::width * TextScreen::height * 4, result.mutable_data());
+    return result;
+}
+
+void pyC64::set_key(uint8_t column, uint8_t row, bool pressed) {
+    c64.set_key(column, row, pressed);
+}
+
+void pyC64::set_joystick(int port, uint8_t lines) {
+    c64.set_joystick(port, lines);
+}
+
+void pyC64::enable_audio(uint32_t sample_rate) {
+    c64.enable_audio(sample_rate);
+}
+
+void pyC64::disable_audio() {
+    c64.disable_audio();
+}
+
+py::array_t<int16_t> pyC64::audio() {
+    auto samples = c64.take_audio();
+    auto result = py::array_t<int16_t>({py::ssize_t(samples.size())});
+    std::copy(samples.begin(), samples.end(), result.mutable_data());
+    return result;
+}
+
+uint8_t *pyC64::ram() {
+    ram_shared = true;
+    return c64.ram_data();
+}
+
+RomSet const &pyC64::roms() const {
+    return *c64.rom_set();
+}
+
+/// A uint8 array over `size` bytes at `data` without copying them. The array
+/// keeps `owner` alive.
+static py::array_t<uint8_t> memory_array(py::handle owner, const uint8_t *data, size_t size, bool writeable) {
+    auto array = py::array_t<uint8_t>({static_cast<py::ssize_t>(size)}, {1}, data, owner);
+    if (!writeable) {
+        array.attr("flags").attr("writeable") = false;
+    }
+    return array;
+}
+
+PYBIND11_MODULE(pyc64, m) {
+    auto cpu = py::class_<CPU6502Base>(m, "_cpu");
+    cpu.def_readonly("a", &CPU6502Base::a);
+    cpu.def_readonly("x", &CPU6502Base::x);
+    cpu.def_readonly("y", &CPU6502Base::y);
+    cpu.def_readonly("pc", &CPU6502Base::pc);
+    cpu.def_readonly("stkp", &CPU6502Base::stkp);
+    cpu.def_property_readonly("status", [](CPU6502Base const &self) { return uint8_t(self.status); });
+
+    py::enum_<Dispatch>(m, "Dispatch")
+            .value("Switch", Dispatch::Switch)
+            .value("Table", Dispatch::Table)
+            .value("Threaded", Dispatch::Threaded)
+            .value("Cached", Dispatch::Cached)
+            .value("Jit", Dispatch::Jit);
+
+    py::enum_<Access>(m, "Access")
+            .value("Read", Access::Read)
+            .value("Write", Access::Write)
+            .value("ReadWrite", Access::ReadWrite);
+
+    py::enum_<BreakKind>(m, "BreakKind")
+            .value("Breakpoint", BreakKind::Breakpoint)
+            .value("Read", BreakKind::Read)
+            .value("Write", BreakKind::Write);
+
+    auto event = py::class_<BreakEvent>(m, "BreakEvent");
+    event.def_readonly("kind", &BreakEvent::kind);
+    event.def_readonly("id", &BreakEvent::id);
+    event.def_readonly("addr", &BreakEvent::addr);
+    event.def_readonly("value", &BreakEvent::value);
 
     auto pyc64 = py::class_<pyC64>(m, "pyC64");
+    pyc64.def(py::init<>());
     pyc64.def("clock", &pyC64::clock);
+    pyc64.def("step_instruction", &pyC64::step_instruction);
+    // these run without the GIL so that threads can drive separate instances
+    // at the same time, an instance must not be used by two threads at once
+    pyc64.def("run_cycles", &pyC64::run_cycles, py::arg("cycles"),
+              py::call_guard<py::gil_scoped_release>());
+    pyc64.def("run_until_pc", &pyC64::run_until_pc, py::arg("addr"), py::arg("max_cycles"),
+              py::call_guard<py::gil_scoped_release>());
+    pyc64.def("run_frames", &pyC64::run_frames, py::arg("frames"),
+              py::call_guard<py::gil_scoped_release>());
     pyc64.def("cpu", &pyC64::cpu);
     pyc64.def("disassemble", &pyC64::disassemble);
     pyc64.def("reset", &pyC64::reset);
+    pyc64.def("set_dispatch", &pyC64::set_dispatch, py::arg("dispatch"));
+    pyc64.def("save_state", &pyC64::save_state);
+    pyc64.def("load_state", &pyC64::load_state);
+    pyc64.def("add_breakpoint", &pyC64::add_breakpoint, py::arg("addr"), py::arg("condition") = py::none());
+    pyc64.def("add_watchpoint", &pyC64::add_watchpoint, py::arg("first"), py::arg("last"),
+              py::arg("access") = Access::Write, py::arg("condition") = py::none());
+    pyc64.def("remove_breakpoint", &pyC64::remove_breakpoint);
+    pyc64.def("clear_breakpoints", &pyC64::clear_breakpoints);
+    pyc64.def("last_break", &pyC64::last_break);
+    pyc64.def("enable_profiler", &pyC64::enable_profiler, py::arg("call_graph") = false);
+    pyc64.def("disable_profiler", &pyC64::disable_profiler);
+    pyc64.def("profile_report", &pyC64::profile_report, py::arg("top") = 20);
+    pyc64.def("frame", &pyC64::frame);
+    pyc64.def("frame_rgba", &pyC64::frame_rgba);
+    pyc64.def("screen_text", &pyC64::screen_text);
+    pyc64.def("screen_rgba", &pyC64::screen_rgba);
+    pyc64.def("set_key", &pyC64::set_key, py::arg("column"), py::arg("row"), py::arg("pressed") = true);
+    pyc64.def("set_joystick", &pyC64::set_joystick, py::arg("port"), py::arg("lines"));
+    pyc64.def("enable_audio", &pyC64::enable_audio, py::arg("sample_rate") = 44100);
+    pyc64.def("disable_audio", &pyC64::disable_audio);
+    pyc64.def("audio", &pyC64::audio);
+
+    // views of the emulator's memory, RAM ignores the bank configuration and
+    // the ROMs are shared between instances so they can't be written. Writes
+    // to RAM drop the cached code before the next run, see pyC64::ram
+    pyc64.def_property_readonly("ram", [](py::object self) {
+        return memory_array(self, self.cast<pyC64 &>().ram(), 0x10000, true);
+    });
+    pyc64.def_property_readonly("basic_rom", [](py::object self) {
+        return memory_array(self, self.cast<pyC64 &>().roms().basic, sizeof(RomSet::basic), false);
+    });
+    pyc64.def_property_readonly("kernal_rom", [](py::object self) {
+        return memory_array(self, self.cast<pyC64 &>().roms().kernal, sizeof(RomSet::kernal), false);
+    });
+    pyc64.def_property_readonly("char_rom", [](py::object self) {
+        return memory_array(self, self.cast<pyC64 &>().roms().chars, sizeof(RomSet::chars), false);
+    });
+
+    auto vec = py::class_<VecC64>(m, "VecC64");
+    vec.def(py::init<size_t, size_t>(), py::arg("count"), py::arg("threads") = 0);
+    vec.def("__len__", &VecC64::size);
+    vec.def("reset", &VecC64::reset);
+    vec.def("load_state", [](VecC64 &self, py::bytes const &state) {
+        auto data = std::string(state);
+        auto blob = std::vector<uint8_t>(data.begin(), data.end());
+        py::gil_scoped_release release;
+        self.load_state(blob);
+    });
+    vec.def("load_states", [](VecC64 &self, std::vector<py::bytes> const &states) {
+        std::vector<std::vector<uint8_t>> blobs;
+        for (auto &state: states) {
+            auto data = std::string(state);
+            blobs.emplace_back(data.begin(), data.end());
+        }
+        py::gil_scoped_release release;
+        self.load_states(blobs);
+    });
+    vec.def("save_state", [](VecC64 &self, size_t index) {
+        if (index >= self.size()) {
+            throw py::index_error("no machine " + std::to_string(index));
+        }
+        auto state = self[index].save_state();
+        return py::bytes(reinterpret_cast<const char *>(state.data()), state.size());
+    }, py::arg("index"));
+    vec.def("step", &VecC64::step, py::arg("cycles"), py::call_guard<py::gil_scoped_release>());
+    vec.def("screens", [](VecC64 const &self) {
+        auto result = py::array_t<uint8_t>({py::ssize_t(self.size()), py::ssize_t(VecC64::screen_size)});
+        self.screens(result.mutable_data());
+        return result;
+    });
+    vec.def("frames", [](VecC64 &self) {
+        auto result = py::array_t<uint8_t>({py::ssize_t(self.size()), py::ssize_t(VicII::frame_height),
+                                            py::ssize_t(VicII::frame_width)});
+        self.frames(result.mutable_data());
+        return result;
+    });
+    vec.def("registers", [](VecC64 const &self) {
+        auto result = py::array_t<uint16_t>({py::ssize_t(self.size()), py::ssize_t(VecC64::register_count)});
+        self.registers(result.mutable_data());
+        return result;
+    });
 
     m.doc() = "C64 Emulator Module";
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "c64/scheduler.hpp"
+
+Scheduler::Scheduler() : heap{} {
+    clear();
+}
+
+void Scheduler::post(Device device, uint64_t due) {
+    int index = position[static_cast<int>(device)];
+    if (due == never) {
+        if (index >= 0) {
+            remove(index);
+        }
+        return;
+    }
+    if (index < 0) {
+        index = size++;
+        place(index, Event{due, device});
+        sift_up(index);
+        return;
+    }
+    uint64_t was = heap[index].due;
+    heap[index].due = due;
+    if (due < was) {
+        sift_up(index);
+    } else {
+        sift_down(index);
+    }
+}
+
+std::optional<Device> Scheduler::pop(uint64_t now) {
+    if (size == 0 || heap[0].due > now) {
+        return std::nullopt;
+    }
+    Device device = heap[0].device;
+    remove(0);
+    return device;
+}
+
+uint64_t Scheduler::due(Device device) const {
+    int index = position[static_cast<int>(device)];
+    return index >= 0 ? heap[index].due : never;
+}
+
+void Scheduler::clear() {
+    size = 0;
+    for (int &index: position) {
+        index = -1;
+    }
+}
+
+void Scheduler::place(int index, Event event) {
+    heap[index] = event;
+    position[static_cast<int>(event.device)] = index;
+}
+
+void Scheduler::sift_up(int index) {
+    Event event = heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent].due <= event.due) {
+            break;
+        }
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, event);
+}
+
+void Scheduler::sift_down(int index) {
+    Event event = heap[index];
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && heap[child + 1].due < heap[child].due) {
+            child++;
+        }
+        if (event.due <= heap[child].due) {
+            break;
+        }
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, event);
+}
+
+void Scheduler::remove(int index) {
+    position[static_cast<int>(heap[index].device)] = -1;
+    size--;
+    if (index == size) {
+        return;
+    }
+    Event last = heap[size];
+    place(index, last);
+    sift_up(index);
+    sift_down(position[static_cast<int>(last.device)]);
+}
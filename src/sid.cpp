@@ -0,0 +1,513 @@
+#include "c64/sid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define C64_SID_SSE2
+#endif
+
+static constexpr uint32_t accumulator_mask = 0xFFFFFF;
+
+// Cycles per envelope step for each attack, decay and release setting
+static constexpr uint16_t rate_periods[16] = {
+        9, 32, 63, 95, 149, 220, 267, 313, 392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+};
+
+// Rate steps per level step while decaying and releasing, slower as it gets quieter
+static uint8_t exponential_period(uint8_t level) {
+    if (level >= 0x5D) return 1;
+    if (level >= 0x36) return 2;
+    if (level >= 0x1A) return 4;
+    if (level >= 0x0E) return 8;
+    if (level >= 0x06) return 16;
+    if (level > 0x00) return 30;
+    return 1;
+}
+
+// Voices and the DC offset of the volume DAC in float units, 1.0 a voice at full level
+static constexpr float voice_scale = 1.0f / (2048.0f * 255.0f);
+static constexpr float volume_offset = 0.15f;
+static constexpr float output_gain = 0.25f;
+
+/// Times the accumulator passes a value with bit 19 rising going from `from`
+/// up by `delta`, the shift register is clocked on each
+static uint64_t noise_clocks(uint32_t from, uint64_t delta) {
+    uint64_t start = uint64_t(from) + 0x80000;
+    return ((start + delta) >> 20) - (start >> 20);
+}
+
+/// The top 8 of the 12 bit noise waveform, taken from bits of the shift register
+static uint16_t noise_output(uint32_t noise) {
+    return uint16_t(((noise >> 9) & 0x800) | ((noise >> 8) & 0x400) | ((noise >> 5) & 0x200) |
+                    ((noise >> 3) & 0x100) | ((noise >> 2) & 0x080) | ((noise << 1) & 0x040) |
+                    ((noise << 3) & 0x020) | ((noise << 4) & 0x010));
+}
+
+/// The selected waveforms ANDed together, 0 when none is
+static uint16_t waveform(uint32_t accumulator, uint32_t ring_source, uint16_t noise, uint8_t control, uint16_t pw) {
+    if ((control & 0xF0) == 0) {
+        return 0;
+    }
+    uint32_t wave = 0xFFF;
+    if (control & 0x10) {
+        uint32_t msb = (control & 0x04) ? accumulator ^ ring_source : accumulator;
+        uint32_t folded = (msb & 0x800000) ? ~accumulator : accumulator;
+        wave &= (folded >> 11) & 0xFFF;
+    }
+    if (control & 0x20) {
+        wave &= accumulator >> 12;
+    }
+    if (control & 0x40) {
+        wave &= (accumulator >> 12) >= pw ? 0xFFF : 0;
+    }
+    if (control & 0x80) {
+        wave &= noise;
+    }
+    return uint16_t(wave);
+}
+
+bool Sid::Voice::envelope_frozen(uint8_t sr) const {
+    switch (envelope_state) {
+        case EnvelopeState::Attack: return false;
+        case EnvelopeState::DecaySustain: return level <= (sr >> 4) * 0x11;
+        case EnvelopeState::Release: return level == 0;
+    }
+    return true;
+}
+
+void Sid::Voice::step_envelope(uint8_t ad, uint8_t sr) {
+    uint8_t rate;
+    switch (envelope_state) {
+        case EnvelopeState::Attack: rate = ad >> 4; break;
+        case EnvelopeState::DecaySustain: rate = ad & 0x0F; break;
+        default: rate = sr & 0x0F; break;
+    }
+    uint16_t period = rate_periods[rate];
+    rate_counter += cycles_per_step;
+    if (rate_counter < period) {
+        return;
+    }
+    // a faster rate written over a slow count starts over
+    rate_counter = rate_counter - period < period ? rate_counter - period : 0;
+
+    if (envelope_state == EnvelopeState::Attack) {
+        if (++level == 0xFF) {
+            envelope_state = EnvelopeState::DecaySustain;
+            exponential_counter = 0;
+        }
+        return;
+    }
+    if (++exponential_counter < exponential_period(level)) {
+        return;
+    }
+    exponential_counter = 0;
+    level--;
+}
+
+void Sid::Voice::clock_noise(uint64_t count) {
+    uint32_t value = noise;
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t bit = ((value >> 22) ^ (value >> 17)) & 1;
+        value = ((value << 1) | bit) & 0x7FFFFF;
+    }
+    noise = value;
+}
+
+uint16_t Sid::Voice::output(uint8_t control, uint16_t pw, uint32_t ring_source) const {
+    return waveform(accumulator, ring_source, noise_output(noise), control, pw);
+}
+
+Sid::Sid() = default;
+
+void Sid::set_sample_rate(uint32_t rate) {
+    output_rate = rate;
+    low = 0.0f;
+    band = 0.0f;
+    samples.clear();
+    if (rate != 0) {
+        resampler.configure(double(clock_rate) / cycles_per_step, rate);
+    } else {
+        resampler = Resampler();
+    }
+}
+
+void Sid::run_until(uint64_t now) {
+    if (now <= clock) {
+        return;
+    }
+    uint64_t steps = (now - clock) / cycles_per_step;
+    if (output_rate == 0) {
+        advance(voices, steps, nullptr);
+        clock += steps * cycles_per_step;
+        return;
+    }
+    Block block;
+    while (steps > 0) {
+        int count = int(std::min<uint64_t>(steps, block_size));
+        advance(voices, count, &block);
+        render(block, count);
+        clock += uint64_t(count) * cycles_per_step;
+        steps -= count;
+    }
+}
+
+void Sid::advance(Voice (&state)[3], uint64_t steps, Block *block) const {
+    if (steps == 0) {
+        return;
+    }
+    bool synced = false;
+    for (int voice = 0; voice < 3; voice++) {
+        synced = synced || ((control(voice) & 0x0A) == 0x02 && frequency((voice + 2) % 3) != 0);
+    }
+
+    if (synced) {
+        // each sync depends on where the source was a step before
+        uint32_t delta[3];
+        for (int voice = 0; voice < 3; voice++) {
+            delta[voice] = (control(voice) & 0x08) ? 0 : frequency(voice) * cycles_per_step;
+        }
+        for (uint64_t step = 0; step < steps; step++) {
+            uint32_t before[3];
+            for (int voice = 0; voice < 3; voice++) {
+                Voice &v = state[voice];
+                before[voice] = v.accumulator;
+                v.clock_noise(noise_clocks(v.accumulator, delta[voice]));
+                v.accumulator = (v.accumulator + delta[voice]) & accumulator_mask;
+            }
+            for (int voice = 0; voice < 3; voice++) {
+                int source = (voice + 2) % 3;
+                bool rose = (before[source] & 0x800000) == 0 && (state[source].accumulator & 0x800000) != 0;
+                if ((control(voice) & 0x02) && rose) {
+                    state[voice].accumulator = 0;
+                }
+            }
+            if (block != nullptr) {
+                for (int voice = 0; voice < 3; voice++) {
+                    block->accumulator[voice][step] = state[voice].accumulator;
+                    block->noise[voice][step] = noise_output(state[voice].noise);
+                }
+            }
+        }
+    } else {
+        for (int voice = 0; voice < 3; voice++) {
+            Voice &v = state[voice];
+            uint32_t delta = (control(voice) & 0x08) ? 0 : frequency(voice) * cycles_per_step;
+            if (block == nullptr) {
+                v.clock_noise(noise_clocks(v.accumulator, steps * delta));
+                v.accumulator = uint32_t((v.accumulator + steps * delta) & accumulator_mask);
+                continue;
+            }
+
+            uint32_t *out = block->accumulator[voice];
+            int count = int(steps);
+            int step = 0;
+#ifdef C64_SID_SSE2
+            __m128i mask = _mm_set1_epi32(accumulator_mask);
+            // lanes step + 1 to step + 4
+            __m128i next = _mm_add_epi32(_mm_set1_epi32(int(v.accumulator)),
+                                         _mm_set_epi32(int(4 * delta), int(3 * delta), int(2 * delta), int(delta)));
+            __m128i stride = _mm_set1_epi32(int(4 * delta));
+            for (; step + 4 <= count; step += 4) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + step), _mm_and_si128(next, mask));
+                next = _mm_add_epi32(next, stride);
+            }
+#endif
+            for (; step < count; step++) {
+                out[step] = (v.accumulator + uint32_t(step + 1) * delta) & accumulator_mask;
+            }
+
+            if (control(voice) & 0x80) {
+                uint32_t from = v.accumulator;
+                for (step = 0; step < count; step++) {
+                    v.clock_noise(noise_clocks(from, delta));
+                    block->noise[voice][step] = noise_output(v.noise);
+                    from = out[step];
+                }
+            } else {
+                v.clock_noise(noise_clocks(v.accumulator, steps * delta));
+            }
+            v.accumulator = out[count - 1];
+        }
+    }
+
+    for (int voice = 0; voice < 3; voice++) {
+        Voice &v = state[voice];
+        uint8_t ad = registers[voice * 7 + 5];
+        uint8_t sr = registers[voice * 7 + 6];
+        uint64_t step = 0;
+        for (; step < steps && !v.envelope_frozen(sr); step++) {
+            v.step_envelope(ad, sr);
+            if (block != nullptr) {
+                block->level[voice][step] = v.level;
+            }
+        }
+        if (block != nullptr) {
+            std::fill(block->level[voice] + step, block->level[voice] + steps, v.level);
+        }
+    }
+}
+
+void Sid::render_voice(uint32_t const *accumulators, uint32_t const *ring, uint16_t const *noise,
+                       uint8_t const *levels, uint8_t control, uint16_t pw, int count, int32_t *out,
+                       bool vectorized) {
+    if ((control & 0xF0) == 0) {
+        std::fill(out, out + count, 0);
+        return;
+    }
+    int i = 0;
+#ifdef C64_SID_SSE2
+    __m128i twelve_bits = _mm_set1_epi32(0xFFF);
+    __m128i sixteen_bits = _mm_set1_epi32(0xFFFF);
+    __m128i middle = _mm_set1_epi32(0x800);
+    __m128i below_pw = _mm_set1_epi32(int(pw) - 1);
+    __m128i zero = _mm_setzero_si128();
+    for (; vectorized && i + 4 <= count; i += 4) {
+        __m128i accumulator = _mm_loadu_si128(reinterpret_cast<__m128i const *>(accumulators + i));
+        __m128i saw = _mm_srli_epi32(accumulator, 12);
+        __m128i wave = twelve_bits;
+        if (control & 0x10) {
+            __m128i msb = accumulator;
+            if (control & 0x04) {
+                msb = _mm_xor_si128(msb, _mm_loadu_si128(reinterpret_cast<__m128i const *>(ring + i)));
+            }
+            __m128i fold = _mm_srai_epi32(_mm_slli_epi32(msb, 8), 31);
+            __m128i triangle = _mm_srli_epi32(_mm_xor_si128(accumulator, fold), 11);
+            wave = _mm_and_si128(wave, triangle);
+        }
+        if (control & 0x20) {
+            wave = _mm_and_si128(wave, saw);
+        }
+        if (control & 0x40) {
+            wave = _mm_and_si128(wave, _mm_cmpgt_epi32(saw, below_pw));
+        }
+        if (control & 0x80) {
+            __m128i bits = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(noise + i));
+            wave = _mm_and_si128(wave, _mm_unpacklo_epi16(bits, zero));
+        }
+        wave = _mm_and_si128(wave, twelve_bits);
+        // both in the low halves of the lanes, madd multiplies them as 16 bit values
+        __m128i centered = _mm_and_si128(_mm_sub_epi32(wave, middle), sixteen_bits);
+        int32_t four_levels;
+        std::memcpy(&four_levels, levels + i, 4);
+        __m128i level = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(four_levels), zero), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_madd_epi16(centered, level));
+    }
+#endif
+    for (; i < count; i++) {
+        uint16_t wave = waveform(accumulators[i], ring[i], (control & 0x80) ? noise[i] : 0, control, pw);
+        out[i] = (int32_t(wave) - 0x800) * levels[i];
+    }
+}
+
+void Sid::render(Block const &block, int steps) {
+    alignas(16) int32_t voice_out[3][block_size];
+    for (int voice = 0; voice < 3; voice++) {
+        int source = (voice + 2) % 3;
+        render_voice(block.accumulator[voice], block.accumulator[source], block.noise[voice], block.level[voice],
+                     control(voice), pulse_width(voice), steps, voice_out[voice]);
+    }
+
+    uint8_t routing = registers[0x17];
+    uint8_t mode = registers[0x18];
+    float volume = float(mode & 0x0F) / 15.0f;
+    bool voice3_off = (mode & 0x80) != 0 && (routing & 0x04) == 0;
+
+    // a Chamberlin state variable filter, the 6581's curve made a straight line
+    uint16_t fc = (registers[0x15] & 0x07) | registers[0x16] << 3;
+    double cutoff = 30.0 + fc * (12000.0 / 2047.0);
+    auto f = float(2.0 * std::sin(M_PI * cutoff * cycles_per_step / clock_rate));
+    float damping = 1.4f - float(routing >> 4) * (1.1f / 15.0f);
+
+    float mixed[block_size];
+    for (int step = 0; step < steps; step++) {
+        int32_t filtered = 0;
+        int32_t direct = 0;
+        for (int voice = 0; voice < 3; voice++) {
+            if (routing & (1 << voice)) {
+                filtered += voice_out[voice][step];
+            } else if (voice != 2 || !voice3_off) {
+                direct += voice_out[voice][step];
+            }
+        }
+        low += f * band;
+        float high = float(filtered) * voice_scale - low - damping * band;
+        band += f * high;
+
+        float out = float(direct) * voice_scale + volume_offset;
+        if (mode & 0x10) out += low;
+        if (mode & 0x20) out += band;
+        if (mode & 0x40) out += high;
+        mixed[step] = out * volume * output_gain;
+    }
+    resampler.push(mixed, steps, samples);
+}
+
+uint8_t Sid::read(uint8_t reg) const {
+    switch (reg & 0x1F) {
+        case 0x19:
+        case 0x1A:
+            return 0xFF; // no paddles
+        case 0x1B:
+            return uint8_t(voices[2].output(control(2), pulse_width(2), voices[1].accumulator) >> 4);
+        case 0x1C:
+            return voices[2].level;
+        default:
+            return 0x00;
+    }
+}
+
+void Sid::write(uint8_t reg, uint8_t value) {
+    reg &= 0x1F;
+    if (reg >= 0x19) {
+        return;
+    }
+    if (reg == 0x04 || reg == 0x0B || reg == 0x12) {
+        Voice &voice = voices[reg / 7];
+        uint8_t was = registers[reg];
+        if ((value & 0x01) && !(was & 0x01)) {
+            voice.envelope_state = EnvelopeState::Attack;
+        } else if (!(value & 0x01) && (was & 0x01)) {
+            voice.envelope_state = EnvelopeState::Release;
+        }
+        if (value & 0x08) {
+            voice.accumulator = 0;
+        }
+    }
+    registers[reg] = value;
+}
+
+std::vector<int16_t> Sid::take_samples() {
+    std::vector<int16_t> taken;
+    taken.swap(samples);
+    return taken;
+}
+
+Sid::State Sid::save_state(uint64_t now) const {
+    Voice ahead[3] = {voices[0], voices[1], voices[2]};
+    uint64_t at = clock;
+    if (now > clock) {
+        uint64_t steps = (now - clock) / cycles_per_step;
+        advance(ahead, steps, nullptr);
+        at += steps * cycles_per_step;
+    }
+    State state{};
+    state.clock = at;
+    std::memcpy(state.registers, registers, sizeof(registers));
+    for (int voice = 0; voice < 3; voice++) {
+        state.accumulator[voice] = ahead[voice].accumulator;
+        state.noise[voice] = ahead[voice].noise;
+        state.rate_counter[voice] = ahead[voice].rate_counter;
+        state.level[voice] = ahead[voice].level;
+        state.envelope_state[voice] = static_cast<uint8_t>(ahead[voice].envelope_state);
+        state.exponential_counter[voice] = ahead[voice].exponential_counter;
+    }
+    return state;
+}
+
+static_assert(sizeof(Sid::State) == 88);
+
+void Sid::load_state(State const &state) {
+    clock = state.clock - state.clock % cycles_per_step;
+    std::memcpy(registers, state.registers, sizeof(registers));
+    for (int voice = 0; voice < 3; voice++) {
+        voices[voice].accumulator = state.accumulator[voice] & accumulator_mask;
+        voices[voice].noise = state.noise[voice] & 0x7FFFFF;
+        voices[voice].rate_counter = std::min<uint16_t>(state.rate_counter[voice], rate_periods[15]);
+        voices[voice].level = state.level[voice];
+        voices[voice].envelope_state = static_cast<EnvelopeState>(std::min<uint8_t>(state.envelope_state[voice], 2));
+        voices[voice].exponential_counter = state.exponential_counter[voice];
+    }
+}
+
+void Sid::Resampler::configure(double input_rate, double output_rate) {
+    step = uint64_t(std::llround(input_rate / output_rate * 4294967296.0));
+    position = uint64_t(taps / 2 - 1) << 32;
+    history.clear();
+
+    // a Blackman windowed sinc, one row of taps per fraction of an input sample
+    double cutoff = std::min(0.45 * output_rate, 20000.0) / input_rate;
+    table.assign(phases * taps, 0.0f);
+    for (int phase = 0; phase < phases; phase++) {
+        float *row = &table[phase * taps];
+        double sum = 0.0;
+        for (int tap = 0; tap < taps; tap++) {
+            double x = double(phase) / phases + taps / 2 - 1 - tap;
+            double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+            double w = (x + taps / 2) / taps;
+            double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * w) + 0.08 * std::cos(4.0 * M_PI * w);
+            row[tap] = float(sinc * window);
+            sum += row[tap];
+        }
+        for (int tap = 0; tap < taps; tap++) {
+            row[tap] = float(row[tap] / sum);
+        }
+    }
+}
+
+void Sid::Resampler::push(float const *input, size_t count, std::vector<int16_t> &out) {
+    history.insert(history.end(), input, input + count);
+    while ((position >> 32) + taps / 2 < history.size()) {
+        size_t first = size_t(position >> 32) - (taps / 2 - 1);
+        float const *x = &history[first];
+        float const *h = &table[((position >> (32 - 7)) & (phases - 1)) * taps];
+        float value;
+#ifdef C64_SID_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (int tap = 0; tap < taps; tap += 4) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + tap), _mm_loadu_ps(h + tap)));
+        }
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        value = _mm_cvtss_f32(sum);
+#else
+        value = 0.0f;
+        for (int tap = 0; tap < taps; tap++) {
+            value += x[tap] * h[tap];
+        }
+#endif
+        float scaled = std::clamp(value * 32767.0f, -32768.0f, 32767.0f);
+        out.push_back(int16_t(std::lrint(scaled)));
+        position += step;
+    }
+    // keep the taps the next output needs
+    size_t used = std::min(size_t(position >> 32) - (taps / 2 - 1), history.size());
+    history.erase(history.begin(), history.begin() + long(used));
+    position -= uint64_t(used) << 32;
+}
+
+static void put_le(std::ofstream &file, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put(char(value >> (8 * i)));
+    }
+}
+
+void write_wav(std::string const &path, std::vector<int16_t> const &samples, uint32_t sample_rate) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Unable to write: " + path);
+    }
+    auto data_size = uint32_t(samples.size() * 2);
+    file.write("RIFF", 4);
+    put_le(file, 36 + data_size, 4);
+    file.write("WAVEfmt ", 8);
+    put_le(file, 16, 4);
+    put_le(file, 1, 2); // PCM
+    put_le(file, 1, 2); // mono
+    put_le(file, sample_rate, 4);
+    put_le(file, sample_rate * 2, 4);
+    put_le(file, 2, 2);
+    put_le(file, 16, 2);
+    file.write("data", 4);
+    put_le(file, data_size, 4);
+    for (int16_t sample: samples) {
+        put_le(file, uint16_t(sample), 2);
+    }
+    if (!file) {
+        throw std::runtime_error("Unable to write: " + path);
+    }
+}
@@ -0,0 +1,114 @@
+#include "c64/symbols.hpp"
+#include "c64/c64.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+// The KERNAL jump table, three bytes per entry from $FF81
+static const char *const kernal_jump_table[] = {
+        "SCINIT", "IOINIT", "RAMTAS", "RESTOR", "VECTOR", "SETMSG", "LSTNSA", "TALKSA",
+        "MEMTOP", "MEMBOT", "SCNKEY", "SETTMO", "IECIN", "IECOUT", "UNTALK", "UNLSTN",
+        "LISTEN", "TALK", "READST", "SETLFS", "SETNAM", "OPEN", "CLOSE", "CHKIN",
+        "CHKOUT", "CLRCHN", "CHRIN", "CHROUT", "LOAD", "SAVE", "SETTIM", "RDTIM",
+        "STOP", "GETIN", "CLALL", "UDTIM", "SCREEN", "PLOT", "IOBASE",
+};
+
+// The RAM vectors at $0314-$0333, RESTOR copies their defaults from $FD30
+static const char *const kernal_vectors[] = {
+        "IRQ", "BRK", "NMI", "IOPEN", "ICLOSE", "ICHKIN", "ICKOUT", "ICLRCH",
+        "IBASIN", "IBSOUT", "ISTOP", "IGETIN", "ICLALL", "USRCMD", "ILOAD", "ISAVE",
+};
+
+static constexpr uint16_t basic_statements = 0xA00C; // END to NEW, address - 1
+static constexpr uint16_t basic_functions = 0xA052;  // SGN to MID$
+static constexpr uint16_t basic_keywords = 0xA09E;   // last character has bit 7 set
+static constexpr int basic_statement_count = 0x23;
+static constexpr int basic_first_function = 0x34;    // SGN's index among the keywords
+static constexpr int basic_function_count = 0x17;
+
+SymbolTable SymbolTable::c64(RomSet const &roms) {
+    auto kernal_word = [&](uint16_t addr) {
+        return uint16_t(roms.kernal[addr - 0xE000] | roms.kernal[addr - 0xE000 + 1] << 8);
+    };
+    auto basic_word = [&](uint16_t addr) {
+        return uint16_t(roms.basic[addr - 0xA000] | roms.basic[addr - 0xA000 + 1] << 8);
+    };
+
+    SymbolTable table;
+    table.add(kernal_word(0xFFFC), "RESET");
+    table.add(kernal_word(0xFFFE), "IRQ_ENTRY");
+    table.add(kernal_word(0xFFFA), "NMI_ENTRY");
+
+    for (int i = 0; i < int(std::size(kernal_jump_table)); i++) {
+        uint16_t entry = 0xFF81 + 3 * i;
+        uint16_t target = kernal_word(entry + 1);
+        if (roms.kernal[entry - 0xE000] == 0x6C) { // JMP (vector)
+            target = kernal_word(0xFD30 + target - 0x0314);
+        }
+        table.add(entry, kernal_jump_table[i]);
+        table.add(target, kernal_jump_table[i]);
+    }
+    for (int i = 0; i < int(std::size(kernal_vectors)); i++) {
+        table.add(kernal_word(0xFD30 + 2 * i), kernal_vectors[i]);
+    }
+
+    table.add(basic_word(0xA000), "BASIC_COLD");
+    table.add(basic_word(0xA002), "BASIC_WARM");
+
+    std::vector<std::string> keywords;
+    std::string keyword;
+    for (uint16_t addr = basic_keywords; roms.basic[addr - 0xA000] != 0x00; addr++) {
+        uint8_t c = roms.basic[addr - 0xA000];
+        keyword += char(c & 0x7F);
+        if (c & 0x80) {
+            keywords.push_back("BASIC_" + keyword);
+            keyword.clear();
+        }
+    }
+    for (int i = 0; i < basic_statement_count && i < int(keywords.size()); i++) {
+        table.add(basic_word(basic_statements + 2 * i) + 1, keywords[i]);
+    }
+    for (int i = 0; i < basic_function_count && basic_first_function + i < int(keywords.size()); i++) {
+        uint16_t target = basic_word(basic_functions + 2 * i);
+        if (target >= 0xA000) { // USR jumps through RAM
+            table.add(target, keywords[basic_first_function + i]);
+        }
+    }
+
+    // copied to zero page by BASIC's cold start
+    table.add(0x0073, "CHRGET", 6);
+    table.add(0x0079, "CHRGOT", 18);
+    return table;
+}
+
+void SymbolTable::add(uint16_t addr, std::string name, uint16_t size) {
+    auto it = std::lower_bound(symbols.begin(), symbols.end(), addr,
+                               [](Symbol const &symbol, uint16_t value) { return symbol.addr < value; });
+    if (it != symbols.end() && it->addr == addr) {
+        return;
+    }
+    symbols.insert(it, {addr, size, std::move(name)});
+}
+
+Symbol const *SymbolTable::find(uint16_t addr) const {
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), addr,
+                               [](uint16_t value, Symbol const &symbol) { return value < symbol.addr; });
+    if (it == symbols.begin()) {
+        return nullptr;
+    }
+    auto &symbol = *(it - 1);
+    bool covered = symbol.size != 0 ? addr - symbol.addr < symbol.size : (addr >> 13) == (symbol.addr >> 13);
+    return covered ? &symbol : nullptr;
+}
+
+std::string SymbolTable::describe(uint16_t addr) const {
+    auto symbol = find(addr);
+    if (symbol == nullptr) {
+        return fmt::format("${:04X}", addr);
+    }
+    if (symbol->addr == addr) {
+        return symbol->name;
+    }
+    return fmt::format("{}+{}", symbol->name, addr - symbol->addr);
+}
@@ -0,0 +1,100 @@
+#include "c64/text_screen.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+TextScreen::TextScreen() : dirty{}, screen{}, pixels(width * height * 4, 0) {
+    mark_all();
+}
+
+void TextScreen::mark_all() {
+    std::fill(std::begin(dirty), std::end(dirty), ~uint64_t(0));
+}
+
+size_t TextScreen::update(VicMemory const &memory, Source const &from) {
+    if (from.screen != source.screen || from.chars != source.chars || from.background != source.background) {
+        source = from;
+        mark_all();
+    }
+
+    size_t drawn = 0;
+    for (int word = 0; word < int(std::size(dirty)); word++) {
+        while (dirty[word] != 0) {
+            int cell = word * 64 + std::countr_zero(dirty[word]);
+            dirty[word] &= dirty[word] - 1;
+            if (cell < cells) {
+                draw(cell, memory);
+                drawn++;
+            }
+        }
+    }
+    return drawn;
+}
+
+void TextScreen::draw(int cell, VicMemory const &memory) {
+    uint8_t code = memory.read(source.screen + cell);
+    screen[cell] = code;
+
+    uint8_t const *fg = VicII::palette[memory.color_at(cell)];
+    uint8_t const *bg = VicII::palette[source.background & 0x0F];
+    uint32_t fg_pixel, bg_pixel;
+    uint8_t fg_rgba[4] = {fg[0], fg[1], fg[2], 0xFF};
+    uint8_t bg_rgba[4] = {bg[0], bg[1], bg[2], 0xFF};
+    std::memcpy(&fg_pixel, fg_rgba, 4);
+    std::memcpy(&bg_pixel, bg_rgba, 4);
+
+    int x = cell % columns * 8;
+    int y = cell / columns * 8;
+    for (int line = 0; line < 8; line++) {
+        uint8_t pattern = memory.read(source.chars + code * 8 + line);
+        uint32_t row[8];
+        for (int pixel = 0; pixel < 8; pixel++) {
+            row[pixel] = (pattern << pixel) & 0x80 ? fg_pixel : bg_pixel;
+        }
+        std::memcpy(&pixels[((y + line) * width + x) * 4], row, sizeof(row));
+    }
+}
+
+std::string TextScreen::petscii() const {
+    std::string text;
+    text.reserve(cells + rows);
+    for (int cell = 0; cell < cells; cell++) {
+        uint8_t code = screen[cell] & 0x7F;
+        if (code < 0x20) {
+            code += 0x40;
+        } else if (code >= 0x60) {
+            code += 0x40;
+        } else if (code >= 0x40) {
+            code += 0x80;
+        }
+        text += char(code);
+        if (cell % columns == columns - 1) {
+            text += '\x0D';
+        }
+    }
+    return text;
+}
+
+std::string TextScreen::ascii() const {
+    std::string text;
+    text.reserve(cells + rows);
+    for (int cell = 0; cell < cells; cell++) {
+        uint8_t code = screen[cell] & 0x7F;
+        char c = '?';
+        if (code == 0x00) {
+            c = '@';
+        } else if (code <= 0x1A) {
+            c = char('A' + code - 1);
+        } else if (code == 0x1B || code == 0x1D) {
+            c = code == 0x1B ? '[' : ']';
+        } else if (0x20 <= code && code < 0x40) {
+            c = char(code); // space, digits and punctuation match ASCII
+        }
+        text += c;
+        if (cell % columns == columns - 1) {
+            text += '\n';
+        }
+    }
+    return text;
+}
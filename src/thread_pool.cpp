@@ -0,0 +1,112 @@
+#include "c64/thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    unfinished.fetch_add(1);
+    auto &queue = *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+        queued.fetch_add(1);
+    }
+    // a worker counts itself as sleeping before it checks `queued` one last
+    // time, so either it sees the task or we see it
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> guard(state_lock);
+        work_available.notify_one();
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> guard(state_lock);
+    all_done.wait(guard, [this] { return unfinished.load() == 0; });
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, std::function<void(size_t)> const &fn) {
+    for (size_t i = 0; i < count; i++) {
+        submit([&fn, i] { fn(i); });
+    }
+    wait();
+}
+
+bool ThreadPool::take(size_t index, Task &task) {
+    {
+        auto &own = *queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        auto &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(size_t index) {
+    while (true) {
+        Task task;
+        if (!take(index, task)) {
+            std::unique_lock<std::mutex> guard(state_lock);
+            sleeping.fetch_add(1);
+            work_available.wait(guard, [this] { return stopping || queued.load() > 0; });
+            sleeping.fetch_sub(1);
+            if (stopping && queued.load() == 0) {
+                return;
+            }
+            continue;
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(state_lock);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        if (unfinished.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> guard(state_lock);
+            all_done.notify_all();
+        }
+    }
+}
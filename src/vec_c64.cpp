@@ -0,0 +1,79 @@
+#include "c64/vec_c64.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+VecC64::VecC64(size_t count, size_t threads) : pool(threads) {
+    if (count == 0) {
+        throw std::runtime_error("VecC64 needs at least one machine");
+    }
+    for (size_t i = 0; i < count; i++) {
+        machines.push_back(std::make_unique<C64>());
+    }
+}
+
+void VecC64::reset() {
+    for (auto &machine: machines) {
+        machine->reset();
+    }
+}
+
+void VecC64::load_state(std::vector<uint8_t> const &state) {
+    for (auto &machine: machines) {
+        machine->load_state(state);
+    }
+}
+
+void VecC64::load_states(std::vector<std::vector<uint8_t>> const &states) {
+    if (states.size() != machines.size()) {
+        throw std::runtime_error(fmt::format("expected {} states, got {}", machines.size(), states.size()));
+    }
+    for (size_t index = 0; index < machines.size(); index++) {
+        machines[index]->load_state(states[index]);
+    }
+}
+
+void VecC64::step(uint64_t cycles) {
+    // the pool only keeps the first exception, this names the machine
+    std::vector<std::string> errors(machines.size());
+    pool.parallel_for(machines.size(), [&](size_t index) {
+        try {
+            machines[index]->run_for_cycles(cycles);
+        } catch (std::exception const &e) {
+            errors[index] = e.what();
+        }
+    });
+    for (size_t index = 0; index < errors.size(); index++) {
+        if (!errors[index].empty()) {
+            throw std::runtime_error(fmt::format("machine {}: {}", index, errors[index]));
+        }
+    }
+}
+
+void VecC64::screens(uint8_t *out) const {
+    for (size_t index = 0; index < machines.size(); index++) {
+        machines[index]->read_ram(0x0400, out + index * screen_size, screen_size);
+    }
+}
+
+void VecC64::frames(uint8_t *out) {
+    constexpr size_t frame_size = VicII::frame_width * VicII::frame_height;
+    for (size_t index = 0; index < machines.size(); index++) {
+        std::copy_n(machines[index]->get_vic().frame(), frame_size, out + index * frame_size);
+    }
+}
+
+void VecC64::registers(uint16_t *out) const {
+    for (auto &machine: machines) {
+        auto &cpu = machine->get_cpu();
+        *out++ = cpu.a;
+        *out++ = cpu.x;
+        *out++ = cpu.y;
+        *out++ = cpu.stkp;
+        *out++ = uint8_t(cpu.status);
+        *out++ = cpu.pc;
+    }
+}
@@ -0,0 +1,396 @@
+#include "c64/vic_ii.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define C64_VIC_SSE2
+#endif
+
+// Pepto's PAL palette
+const uint8_t VicII::palette[16][3] = {
+        {0x00, 0x00, 0x00}, {0xFF, 0xFF, 0xFF}, {0x68, 0x37, 0x2B}, {0x70, 0xA4, 0xB2},
+        {0x6F, 0x3D, 0x86}, {0x58, 0x8D, 0x43}, {0x35, 0x28, 0x79}, {0xB8, 0xC7, 0x6F},
+        {0x6F, 0x4F, 0x25}, {0x43, 0x39, 0x00}, {0x9A, 0x67, 0x59}, {0x44, 0x44, 0x44},
+        {0x6C, 0x6C, 0x6C}, {0x9A, 0xD2, 0x84}, {0x6C, 0x5E, 0xB5}, {0x95, 0x95, 0x95}
+};
+
+// The display window, in raster lines and frame columns (sprite X + 8)
+static constexpr int first_display_line = 0x30;
+static constexpr int display_left = 32;
+static constexpr int display_columns = 40;
+static constexpr int display_rows = 25;
+
+/// Expands `count` cells of hires graphics, 8 pixels each: set bits of
+/// `patterns[i]` become `fg[i]`, clear ones `bg[i]`. `foreground` gets 0xFF
+/// for set bits, sprites need it for priority and collisions.
+static void expand_hires(uint8_t const *patterns, uint8_t const *fg, uint8_t const *bg, int count,
+                         uint8_t *out, uint8_t *foreground) {
+    int i = 0;
+#ifdef C64_VIC_SSE2
+    // two cells per register: every byte of a cell's half holds its pattern,
+    // masking it with the bit of each pixel (bit 7 leftmost) gives the pixels
+    constexpr uint64_t spread = 0x0101010101010101;
+    const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, char(0x80), 1, 2, 4, 8, 16, 32, 64, char(0x80));
+    for (; i + 2 <= count; i += 2) {
+        __m128i pattern = _mm_set_epi64x(int64_t(patterns[i + 1] * spread), int64_t(patterns[i] * spread));
+        __m128i set = _mm_cmpeq_epi8(_mm_and_si128(pattern, bits), bits);
+        __m128i fgs = _mm_set_epi64x(int64_t(fg[i + 1] * spread), int64_t(fg[i] * spread));
+        __m128i bgs = _mm_set_epi64x(int64_t(bg[i + 1] * spread), int64_t(bg[i] * spread));
+        __m128i pixels = _mm_or_si128(_mm_and_si128(set, fgs), _mm_andnot_si128(set, bgs));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 8), pixels);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(foreground + i * 8), set);
+    }
+#endif
+    for (; i < count; i++) {
+        for (int pixel = 0; pixel < 8; pixel++) {
+            bool set = (patterns[i] << pixel) & 0x80;
+            out[i * 8 + pixel] = set ? fg[i] : bg[i];
+            foreground[i * 8 + pixel] = set ? 0xFF : 0x00;
+        }
+    }
+}
+
+/// One cell of multicolor graphics, 4 double wide pixels picked from
+/// `colors` by bit pairs. Pairs 10 and 11 count as foreground.
+static void expand_multicolor(uint8_t pattern, uint8_t const colors[4], uint8_t *out, uint8_t *foreground) {
+    for (int pixel = 0; pixel < 8; pixel += 2) {
+        uint8_t pair = (pattern >> (6 - pixel)) & 0b11;
+        out[pixel] = out[pixel + 1] = colors[pair];
+        foreground[pixel] = foreground[pixel + 1] = (pair & 0b10) ? 0xFF : 0x00;
+    }
+}
+
+VicII::VicII() : registers{} {
+}
+
+uint8_t VicII::raster_raised_by(uint64_t now) const {
+    // the raster interrupt is raised at the start of the compared line
+    uint64_t started = now / cycles_per_line + 1;
+    int compare = raster_compare();
+    if (next_line >= started || compare >= lines_per_frame) {
+        return 0x00;
+    }
+    uint64_t match = next_line + (compare - int(next_line % lines_per_frame) + lines_per_frame) % lines_per_frame;
+    return match < started ? 0x01 : 0x00;
+}
+
+void VicII::run_until(uint64_t now, VicMemory const &memory) {
+    uint64_t started = now / cycles_per_line + 1;
+    if (next_line < started) {
+        raise(raster_raised_by(now));
+        next_line = started;
+    }
+
+    uint64_t left = now / cycles_per_line;
+    if (left > next_render + lines_per_frame) {
+        // only the last frame's worth would survive
+        next_render = left - lines_per_frame;
+    }
+    for (; next_render < left; next_render++) {
+        int raster = static_cast<int>(next_render % lines_per_frame);
+        if (first_visible_line <= raster && raster < first_visible_line + frame_height) {
+            render_line(raster, memory);
+        }
+    }
+}
+
+uint64_t VicII::next_irq() const {
+    int compare = raster_compare();
+    if ((registers[0x1A] & 0x01) == 0 || compare >= lines_per_frame) {
+        return UINT64_MAX;
+    }
+    uint64_t match = next_line + (compare - int(next_line % lines_per_frame) + lines_per_frame) % lines_per_frame;
+    return match * cycles_per_line;
+}
+
+uint8_t VicII::read(uint8_t reg, uint64_t now, bool read_only) {
+    reg &= 0x3F;
+    int raster = raster_line(now);
+    switch (reg) {
+        case 0x11:
+            return (registers[0x11] & 0x7F) | (raster & 0x100) >> 1;
+        case 0x12:
+            return raster & 0xFF;
+        case 0x13:
+        case 0x14:
+            return 0x00; // no light pen
+        case 0x16:
+            return registers[0x16] | 0xC0;
+        case 0x18:
+            return registers[0x18] | 0x01;
+        case 0x19:
+            return irq_latch | 0x70 | (irq() ? 0x80 : 0x00);
+        case 0x1A:
+            return registers[0x1A] | 0xF0;
+        case 0x1E: {
+            uint8_t value = sprite_sprite;
+            if (!read_only) {
+                sprite_sprite = 0;
+            }
+            return value;
+        }
+        case 0x1F: {
+            uint8_t value = sprite_data;
+            if (!read_only) {
+                sprite_data = 0;
+            }
+            return value;
+        }
+        default:
+            if (reg >= 0x2F) {
+                return 0xFF;
+            } else if (reg >= 0x20) {
+                return registers[reg] | 0xF0;
+            }
+            return registers[reg];
+    }
+}
+
+void VicII::write(uint8_t reg, uint8_t value, uint64_t now) {
+    reg &= 0x3F;
+    switch (reg) {
+        case 0x11:
+        case 0x12: {
+            int before = raster_compare();
+            registers[reg] = value;
+            // moving the compare onto the current line raises it right away
+            if (raster_compare() != before && raster_compare() == raster_line(now)) {
+                raise(0x01);
+            }
+            break;
+        }
+        case 0x19:
+            irq_latch &= ~value & 0x0F; // writing 1 acknowledges
+            break;
+        case 0x1A:
+            registers[0x1A] = value & 0x0F;
+            break;
+        case 0x1E:
+        case 0x1F:
+            break;
+        default:
+            if (reg < 0x2F) {
+                registers[reg] = value;
+            }
+            break;
+    }
+}
+
+uint8_t const *VicII::frame() const {
+    // a VIC-II that has not rendered anything yet, e.g. a fork's, shows black
+    static const std::vector<uint8_t> blank(frame_width * frame_height, 0);
+    return framebuffer.empty() ? blank.data() : framebuffer.data();
+}
+
+void VicII::frame_rgba(uint8_t *out) const {
+    uint8_t const *pixels = frame();
+    for (int i = 0; i < frame_width * frame_height; i++) {
+        uint8_t color = pixels[i];
+        out[0] = palette[color & 0x0F][0];
+        out[1] = palette[color & 0x0F][1];
+        out[2] = palette[color & 0x0F][2];
+        out[3] = 0xFF;
+        out += 4;
+    }
+}
+
+VicII::State VicII::save_state(uint64_t now) const {
+    State state{};
+    std::memcpy(state.registers, registers, sizeof(registers));
+    state.irq_latch = irq_latch | raster_raised_by(now);
+    state.sprite_sprite = sprite_sprite;
+    state.sprite_data = sprite_data;
+    return state;
+}
+
+void VicII::load_state(State const &state, uint64_t now) {
+    std::memcpy(registers, state.registers, sizeof(registers));
+    irq_latch = state.irq_latch & 0x0F;
+    sprite_sprite = state.sprite_sprite;
+    sprite_data = state.sprite_data;
+    next_line = now / cycles_per_line + 1;
+    next_render = now / cycles_per_line;
+}
+
+void VicII::render_line(int raster, VicMemory const &memory) {
+    if (framebuffer.empty()) {
+        framebuffer.assign(frame_width * frame_height, 0);
+    }
+    uint8_t *out = &framebuffer[(raster - first_visible_line) * frame_width];
+    uint8_t border = registers[0x20] & 0x0F;
+
+    bool rsel = registers[0x11] & 0x08;
+    bool den = registers[0x11] & 0x10;
+    int top = rsel ? 51 : 55;
+    int bottom = rsel ? 251 : 247;
+    if (!den || raster < top || raster >= bottom) {
+        std::memset(out, border, frame_width);
+        return;
+    }
+
+    uint8_t foreground[frame_width];
+    render_graphics(raster, memory, out, foreground);
+    render_sprites(raster, memory, out, foreground);
+
+    bool csel = registers[0x16] & 0x08;
+    int left = csel ? 32 : 39;
+    int right = csel ? 352 : 343;
+    std::memset(out, border, left);
+    std::memset(out + right, border, frame_width - right);
+}
+
+void VicII::render_graphics(int raster, VicMemory const &memory, uint8_t *line, uint8_t *foreground) const {
+    uint8_t background = registers[0x21] & 0x0F;
+    std::memset(line, background, frame_width);
+    std::memset(foreground, 0, frame_width);
+
+    // rows start on the bad lines, where the low bits of the raster match YSCROLL
+    int first = first_display_line + (registers[0x11] & 0x07);
+    int row = (raster - first) >> 3;
+    if (raster < first || row >= display_rows) {
+        return;
+    }
+    int row_line = (raster - first) & 0x07;
+
+    uint16_t screen = (registers[0x18] & 0xF0) << 6;
+    uint16_t chars = (registers[0x18] & 0x0E) << 10;
+    uint16_t bitmap = (registers[0x18] & 0x08) << 10;
+    int x = display_left + (registers[0x16] & 0x07);
+    uint8_t *out = line + x;
+    uint8_t *fg_out = foreground + x;
+
+    uint8_t codes[display_columns], colors[display_columns], patterns[display_columns];
+    uint8_t fg[display_columns], bg[display_columns];
+    for (int column = 0; column < display_columns; column++) {
+        codes[column] = memory.read(screen + row * display_columns + column);
+        colors[column] = memory.color_at(row * display_columns + column);
+    }
+
+    uint8_t mode = (registers[0x11] & 0x60) | (registers[0x16] & 0x10); // ECM, BMM, MCM
+    switch (mode) {
+        case 0x00: // standard text
+            for (int column = 0; column < display_columns; column++) {
+                patterns[column] = memory.read(chars + codes[column] * 8 + row_line);
+                bg[column] = background;
+            }
+            expand_hires(patterns, colors, bg, display_columns, out, fg_out);
+            break;
+        case 0x40: // extended background color text
+            for (int column = 0; column < display_columns; column++) {
+                patterns[column] = memory.read(chars + (codes[column] & 0x3F) * 8 + row_line);
+                bg[column] = registers[0x21 + (codes[column] >> 6)] & 0x0F;
+            }
+            expand_hires(patterns, colors, bg, display_columns, out, fg_out);
+            break;
+        case 0x20: // standard bitmap, colors from screen RAM
+            for (int column = 0; column < display_columns; column++) {
+                patterns[column] = memory.read(bitmap + row * 320 + column * 8 + row_line);
+                fg[column] = codes[column] >> 4;
+                bg[column] = codes[column] & 0x0F;
+            }
+            expand_hires(patterns, fg, bg, display_columns, out, fg_out);
+            break;
+        case 0x10: { // multicolor text, per character by bit 3 of its color
+            uint8_t multicolors[4] = {background, uint8_t(registers[0x22] & 0x0F), uint8_t(registers[0x23] & 0x0F), 0};
+            for (int column = 0; column < display_columns; column++) {
+                uint8_t pattern = memory.read(chars + codes[column] * 8 + row_line);
+                uint8_t color = colors[column] & 0x07;
+                if (colors[column] & 0x08) {
+                    multicolors[3] = color;
+                    expand_multicolor(pattern, multicolors, out + column * 8, fg_out + column * 8);
+                } else {
+                    expand_hires(&pattern, &color, &background, 1, out + column * 8, fg_out + column * 8);
+                }
+            }
+            break;
+        }
+        case 0x30: // multicolor bitmap
+            for (int column = 0; column < display_columns; column++) {
+                uint8_t pattern = memory.read(bitmap + row * 320 + column * 8 + row_line);
+                uint8_t multicolors[4] = {background, uint8_t(codes[column] >> 4), uint8_t(codes[column] & 0x0F), colors[column]};
+                expand_multicolor(pattern, multicolors, out + column * 8, fg_out + column * 8);
+            }
+            break;
+        default: // the invalid modes show black
+            std::memset(out, 0, display_columns * 8);
+            break;
+    }
+}
+
+void VicII::render_sprites(int raster, VicMemory const &memory, uint8_t *line, uint8_t const *foreground) {
+    uint8_t enabled = registers[0x15];
+    if (enabled == 0) {
+        return;
+    }
+
+    uint8_t occupied[frame_width] = {}; // which sprites drew each pixel
+    uint8_t hit_sprite = 0;
+    uint8_t hit_data = 0;
+    uint16_t pointers = ((registers[0x18] & 0xF0) << 6) + 0x3F8;
+
+    // sprite 0 is in front, so it goes last
+    for (int n = 7; n >= 0; n--) {
+        uint8_t bit = 1u << n;
+        if ((enabled & bit) == 0) {
+            continue;
+        }
+        bool expand_y = registers[0x17] & bit;
+        int sprite_line = raster - (registers[1 + 2 * n] + 1);
+        if (sprite_line < 0 || sprite_line >= (expand_y ? 42 : 21)) {
+            continue;
+        }
+        uint16_t data = memory.read(pointers + n) * 64 + (expand_y ? sprite_line >> 1 : sprite_line) * 3;
+        uint32_t bits = memory.read(data) << 16 | memory.read(data + 1) << 8 | memory.read(data + 2);
+        if (bits == 0) {
+            continue;
+        }
+
+        int x = registers[2 * n] + ((registers[0x10] & bit) ? 0x100 : 0) + 8;
+        int width = (registers[0x1D] & bit) ? 2 : 1;
+        bool multicolor = registers[0x1C] & bit;
+        bool behind = registers[0x1B] & bit;
+        uint8_t colors[4] = {0, uint8_t(registers[0x25] & 0x0F), uint8_t(registers[0x27 + n] & 0x0F), uint8_t(registers[0x26] & 0x0F)};
+
+        for (int pixel = 0; pixel < 24; pixel++) {
+            uint8_t color;
+            if (multicolor) {
+                uint8_t pair = (bits >> (22 - (pixel & ~1))) & 0b11;
+                if (pair == 0) {
+                    continue;
+                }
+                color = colors[pair];
+            } else {
+                if (((bits >> (23 - pixel)) & 1) == 0) {
+                    continue;
+                }
+                color = colors[2];
+            }
+            for (int at = x + pixel * width; at < x + (pixel + 1) * width; at++) {
+                if (at >= frame_width) {
+                    break;
+                }
+                if (occupied[at] != 0) {
+                    hit_sprite |= occupied[at] | bit;
+                }
+                occupied[at] |= bit;
+                if (foreground[at] != 0) {
+                    hit_data |= bit;
+                }
+                if (!behind || foreground[at] == 0) {
+                    line[at] = color;
+                }
+            }
+        }
+    }
+
+    // only the first collision after the register was read interrupts
+    if (hit_sprite != 0 && sprite_sprite == 0) {
+        raise(0x04);
+    }
+    if (hit_data != 0 && sprite_data == 0) {
+        raise(0x02);
+    }
+    sprite_sprite |= hit_sprite;
+    sprite_data |= hit_data;
+}
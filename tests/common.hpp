@@ -8,7 +8,7 @@
 #define CHECK_MESSAGE(cond, msg) do { INFO(msg); CHECK(cond); } while((void)0, 0)
 #define REQUIRE_MESSAGE(cond, msg) do { INFO(msg); REQUIRE(cond); } while((void)0, 0)
 
-class MockBus : public CPUIO {
+class MockBus final : public CPUIO {
 
     uint8_t ram[0x10000] = {};
 
@@ -21,6 +21,10 @@ public:
         return ram[addr];
     }
 
+    uint8_t read(uint16_t addr) {
+        return ram[addr];
+    }
+
     void interrupt(Interrupt interrupt) override {
 
     }
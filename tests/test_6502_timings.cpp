@@ -9,8 +9,11 @@
 // I believe the timingtest.data has some errors e.x. STA at $10C4 is 6 instead of 5 ?
 
 TEST_CASE("Run Timing Test") {
+    auto dispatch = GENERATE(Dispatch::Table, Dispatch::Threaded, Dispatch::Cached);
+
     SECTION("Timing test") {
         auto cpu = CPU6502();
+        cpu.dispatch = dispatch;
         auto data = load_rom_file("roms/timingtest.bin");
         auto bus = MockBus();
         for (int index = 0; index < data.size(); index++) {
@@ -29,9 +32,6 @@ TEST_CASE("Run Timing Test") {
         while (true) {
             auto pc = cpu.pc;
             count++;
-            while (!cpu.complete()) {
-                cpu.clock(bus);
-            }
 
             auto opcode = bus.read(cpu.pc, true);
             auto info = cpu.instruction_info(opcode);
@@ -40,7 +40,7 @@ TEST_CASE("Run Timing Test") {
             if (cpu.pc == 0x1269) {
                 break;
             }
-            cpu.clock(bus);
+            cpu.step_instruction(bus);
         }
         auto stop = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
@@ -50,4 +50,24 @@ TEST_CASE("Run Timing Test") {
         REQUIRE(cpu.clock_count == 1141);
     }
 
+    SECTION("Timing test with the JIT") {
+        auto cpu = CPU6502();
+        cpu.dispatch = Dispatch::Jit;
+        cpu.jit_threshold = 0;
+        auto data = load_rom_file("roms/timingtest.bin");
+        auto bus = MockBus();
+        for (int index = 0; index < data.size(); index++) {
+            bus.write(0x1000 + index, data[index]);
+        }
+
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x10);
+        cpu.reset(bus);
+        cpu.cycles = 0;
+
+        REQUIRE(cpu.run_for_cycles(bus, 1141) == 1141);
+        REQUIRE(cpu.pc == 0x1269);
+        REQUIRE(cpu.complete());
+    }
+
 }
\ No newline at end of file
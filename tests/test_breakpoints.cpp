@@ -0,0 +1,107 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+// LDX #$00; loop: INX; STX $C100; LDA $E000; JMP loop
+static void load_loop(C64 &c64) {
+    const uint8_t program[] = {
+            0xA2, 0x00,
+            0xE8,
+            0x8E, 0x00, 0xC1,
+            0xAD, 0x00, 0xE0,
+            0x4C, 0x02, 0xC0,
+    };
+    c64.reset();
+    c64.write_ram(0xC000, program, sizeof(program));
+    c64.cpu.pc = 0xC000;
+    c64.cpu.cycles = 0;
+}
+
+TEST_CASE("Breakpoints") {
+    auto c64 = C64();
+    load_loop(c64);
+
+    SECTION("PC breakpoint") {
+        for (auto dispatch: {Dispatch::Table, Dispatch::Cached, Dispatch::Jit}) {
+            load_loop(c64);
+            c64.set_dispatch(dispatch);
+            int id = c64.add_breakpoint(0xC003);
+
+            REQUIRE(c64.run_for_cycles(1000) < 1000);
+            REQUIRE(c64.cpu.pc == 0xC003);
+            REQUIRE(c64.cpu.x == 1);
+            REQUIRE(c64.last_break()->kind == BreakKind::Breakpoint);
+            REQUIRE(c64.last_break()->id == id);
+
+            // resuming passes the breakpoint once
+            c64.run_for_cycles(1000);
+            REQUIRE(c64.cpu.pc == 0xC003);
+            REQUIRE(c64.cpu.x == 2);
+
+            REQUIRE(c64.remove_breakpoint(id));
+            REQUIRE(!c64.remove_breakpoint(id));
+            REQUIRE(c64.run_for_cycles(1000) == 1000);
+            REQUIRE(!c64.last_break());
+        }
+    }
+
+    SECTION("Conditional breakpoint") {
+        c64.add_breakpoint(0xC003, [](C64 &machine) { return machine.get_cpu().x == 5; });
+        c64.run_for_cycles(1000);
+        REQUIRE(c64.cpu.pc == 0xC003);
+        REQUIRE(c64.cpu.x == 5);
+    }
+
+    SECTION("Write watchpoint") {
+        int id = c64.add_watchpoint(0xC100, 0xC1FF, Access::Write);
+        c64.run_for_cycles(1000);
+        // after the STX
+        REQUIRE(c64.cpu.pc == 0xC006);
+        REQUIRE(c64.ram[0xC100] == 1);
+        auto event = *c64.last_break();
+        REQUIRE(event.kind == BreakKind::Write);
+        REQUIRE(event.id == id);
+        REQUIRE(event.addr == 0xC100);
+        REQUIRE(event.value == 1);
+
+        // reading the page does not fire it
+        c64.clear_breakpoints();
+        c64.add_watchpoint(0xC100, 0xC100, Access::Read);
+        REQUIRE(c64.run_for_cycles(1000) == 1000);
+    }
+
+    SECTION("Read watchpoint on ROM") {
+        c64.add_watchpoint(0xE000, 0xE000, Access::Read);
+        REQUIRE(c64.run_until_pc(0x0000, 1000) < 1000);
+        REQUIRE(c64.cpu.pc == 0xC009);
+        REQUIRE(c64.cpu.a == c64.roms->kernal[0]);
+        REQUIRE(c64.last_break()->kind == BreakKind::Read);
+        REQUIRE(c64.last_break()->value == c64.roms->kernal[0]);
+
+        // reads for the debugger do not count
+        c64.read(0xE000, true);
+        c64.step_instruction();
+        REQUIRE(!c64.last_break());
+    }
+
+    SECTION("Watched pages behave like the rest") {
+        auto watched = C64();
+        auto plain = C64();
+        watched.reset();
+        plain.reset();
+        watched.add_watchpoint(0x0000, 0xFFFF, Access::ReadWrite, [](C64 &) { return false; });
+
+        watched.run_for_cycles(3000000);
+        plain.run_for_cycles(3000000);
+        REQUIRE(!watched.last_break());
+        REQUIRE(watched.save_state() == plain.save_state());
+
+        watched.clear_breakpoints();
+        watched.type("PRINT 6*7\n");
+        plain.type("PRINT 6*7\n");
+        watched.run_for_cycles(500000);
+        plain.run_for_cycles(500000);
+        REQUIRE(watched.save_state() == plain.save_state());
+    }
+}
@@ -0,0 +1,125 @@
+#include "catch2.hpp"
+
+#include <mutex>
+#include <vector>
+
+#define private public
+#include <c64/bus_trace.hpp>
+#include <c64/c64.hpp>
+#include <c64/ring_buffer.hpp>
+
+TEST_CASE("Bus trace") {
+    SECTION("Ring buffer") {
+        auto ring = RingBuffer<int>(5);
+        REQUIRE(ring.capacity() == 8);
+
+        for (int i = 0; i < 8; i++) {
+            REQUIRE(ring.push(i));
+        }
+        REQUIRE(!ring.push(8));
+
+        int out[8] = {};
+        REQUIRE(ring.pop(out, 3) == 3);
+        REQUIRE(out[0] == 0);
+        REQUIRE(out[2] == 2);
+
+        REQUIRE(ring.push(8));
+        REQUIRE(ring.pop(out, 8) == 6);
+        REQUIRE(out[0] == 3);
+        REQUIRE(out[5] == 8);
+        REQUIRE(ring.pop(out, 8) == 0);
+    }
+
+    SECTION("Tracer delivers records in order") {
+        std::vector<BusTraceRecord> records;
+        std::mutex lock;
+        {
+            auto tracer = BusTracer([&](BusTraceRecord const &record) {
+                std::lock_guard<std::mutex> guard(lock);
+                records.push_back(record);
+            }, 1 << 16);
+
+            for (uint16_t i = 0; i < 1000; i++) {
+                tracer.record(i, 0xD000 + i * 2, i & 0xFF, (i & 1) == 1);
+            }
+            REQUIRE(tracer.dropped_records() == 0);
+        }
+
+        REQUIRE(records.size() == 1000);
+        REQUIRE(records[0].region == BusRegion::VIC);
+        REQUIRE(records[999].cycle == 999);
+        REQUIRE(records[999].addr == 0xD000 + 999 * 2);
+        REQUIRE(records[999].region == BusRegion::SID);
+        REQUIRE(records[999].write);
+    }
+
+    SECTION("Regions") {
+        REQUIRE(bus_region(0x0001) == BusRegion::CPUPort);
+        REQUIRE(bus_region(0xD020) == BusRegion::VIC);
+        REQUIRE(bus_region(0xD800) == BusRegion::ColorRAM);
+        REQUIRE(bus_region(0xDC0D) == BusRegion::CIA1);
+        REQUIRE(bus_region(0xDD00) == BusRegion::CIA2);
+        REQUIRE(bus_region(0xDFFF) == BusRegion::IO2);
+    }
+
+    SECTION("C64 reports I/O accesses") {
+        std::vector<BusTraceRecord> records;
+        {
+            auto tracer = BusTracer([&](BusTraceRecord const &record) {
+                records.push_back(record);
+            });
+            auto c64 = C64();
+            c64.set_tracer(&tracer);
+            c64.write(0x0001, 0b111);
+            c64.write(0x1000, 0x01);
+            c64.write(0xD020, 0x0E);
+            c64.read(0xD020, true);
+            c64.set_tracer(nullptr);
+        }
+
+#ifdef C64_BUS_TRACE
+        REQUIRE(records.size() == 3);
+        REQUIRE(records[0].region == BusRegion::CPUPort);
+        REQUIRE(records[1].addr == 0xD020);
+        REQUIRE(records[2].value == 0xFE); // the unused bits read 1
+        REQUIRE(!records[2].write);
+#else
+        REQUIRE(records.empty());
+#endif
+    }
+
+    SECTION("Accesses are stamped with the clock the devices see") {
+        // loop INC $D021 : INC $D021 : JMP loop, one block for the JIT
+        const uint8_t program[] = {0xEE, 0x21, 0xD0, 0xEE, 0x21, 0xD0, 0x4C, 0x00, 0xC0};
+        auto trace = [&](Dispatch dispatch) {
+            std::vector<BusTraceRecord> records;
+            {
+                auto tracer = BusTracer([&](BusTraceRecord const &record) {
+                    records.push_back(record);
+                });
+                auto c64 = C64();
+                c64.set_dispatch(dispatch);
+                c64.reset();
+                c64.write_ram(0xC000, program, sizeof(program));
+                c64.cpu.pc = 0xC000;
+                c64.cpu.cycles = 0;
+                c64.set_tracer(&tracer);
+                c64.run_for_cycles(10000);
+                c64.set_tracer(nullptr);
+            }
+            return records;
+        };
+
+        auto stepped = trace(Dispatch::Table);
+        auto native = trace(Dispatch::Jit);
+#ifdef C64_BUS_TRACE
+        REQUIRE(stepped.size() > 1000);
+#endif
+        REQUIRE(native.size() == stepped.size());
+        for (size_t i = 0; i < stepped.size(); i++) {
+            REQUIRE(native[i].cycle == stepped[i].cycle);
+            REQUIRE(native[i].addr == stepped[i].addr);
+            REQUIRE(native[i].value == stepped[i].value);
+        }
+    }
+}
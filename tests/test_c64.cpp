@@ -2,6 +2,8 @@
 #include "catch2.hpp"
 #include "common.hpp"
 
+#include <cstring>
+
 #define private public
 #include "c64/c64.hpp"
 
@@ -69,18 +71,49 @@ TEST_CASE("C64") {
         }
     }
 
+    SECTION("Memory map") {
+        c64.write(0x0001, 0b000);
+        c64.write(0xA000, 0x11);
+        c64.write(0xD000, 0x22);
+        c64.write(0xE000, 0x33);
+
+        for (uint8_t config = 0; config < 8; config++) {
+            c64.write(0x0001, config);
+            bool charen = config & 0b100;
+            bool hiram = config & 0b010;
+            bool loram = config & 0b001;
+
+            auto basic = (hiram && loram) ? c64.roms->basic[0] : 0x11;
+            REQUIRE(c64.read(0xA000, true) == basic);
+
+            auto kernal = hiram ? c64.roms->kernal[0] : 0x33;
+            REQUIRE(c64.read(0xE000, true) == kernal);
+
+            auto region = C64::memory_region(config, 0xD000);
+            if (!hiram && !loram) {
+                REQUIRE(region == MemoryRegion::RAM);
+                REQUIRE(c64.read(0xD000, true) == 0x22);
+            } else if (charen) {
+                REQUIRE(region == MemoryRegion::IO);
+            } else {
+                REQUIRE(region == MemoryRegion::CHAR);
+                REQUIRE(c64.read(0xD000, true) == c64.roms->chars[0]);
+            }
+
+            // writes always end up in RAM
+            c64.write(0xE001, config);
+            REQUIRE(c64.ram[0xE001] == config);
+        }
+    }
+
     SECTION("Run C64") {
         c64.reset();
 
         int count = 1;
         while (true) {
-            while(!c64.cpu.complete()) {
-                c64.cpu.clock(c64);
-            }
-
 //            std::string status = nestools::full_cpu_status_as_string(c64.cpu, c64);
 //            printf("%d -> %s\n", count, status.c_str());
-            c64.cpu.clock(c64);
+            c64.step_instruction();
 
             if(c64.read(0x04CD, true) == 0x2E) {
                 printf("Screen completed after %d instructions.\n", count);
@@ -99,4 +132,245 @@ TEST_CASE("C64") {
             printf("|\n");
         }
     }
-}
\ No newline at end of file
+
+    SECTION("Shared ROMs") {
+        auto other = C64();
+        REQUIRE(c64.rom_set() == other.rom_set());
+        REQUIRE(reinterpret_cast<uintptr_t>(c64.rom_set()->kernal) % 0x1000 == 0);
+
+        c64.write(0x0001, 0b111);
+        other.write(0x0001, 0b111);
+        auto original = other.read(0xE000, true);
+
+        c64.patch_rom(0xE000, original ^ 0xFF);
+        REQUIRE(c64.rom_set() != other.rom_set());
+        REQUIRE(c64.read(0xE000, true) == (original ^ 0xFF));
+        REQUIRE(other.read(0xE000, true) == original);
+        REQUIRE(c64.read(0xA000, true) == other.read(0xA000, true));
+
+        c64.patch_rom(0xA000, 0x42);
+        REQUIRE(c64.read(0xA000, true) == 0x42);
+        REQUIRE(RomSet::stock()->basic[0] == other.read(0xA000, true));
+    }
+
+    SECTION("Load PRG") {
+        // 10 PRINT "HI"
+        std::vector<uint8_t> prg = {0x01, 0x08, 0x0B, 0x08, 0x0A, 0x00, 0x99, 0x22, 0x48, 0x49, 0x22, 0x00, 0x00, 0x00};
+        REQUIRE(c64.load_prg(prg) == 0x0801);
+        REQUIRE(c64.ram[0x0801] == 0x0B);
+        REQUIRE(c64.ram[0x080E] == 0x00);
+        REQUIRE((c64.ram[0x2D] | (c64.ram[0x2E] << 8)) == 0x0801 + prg.size() - 2);
+
+        REQUIRE(c64.type("run\n") == 4);
+        REQUIRE(c64.ram[0xC6] == 4);
+        REQUIRE(c64.ram[0x0277] == 'R');
+        REQUIRE(c64.ram[0x027A] == 0x0D);
+    }
+
+    SECTION("Run for cycles") {
+        c64.reset();
+        c64.run_for_cycles(10000);
+        REQUIRE(c64.system_clock == 10000);
+        REQUIRE(c64.cpu.clock_count == 10000);
+
+        c64.run_for_cycles(1);
+        c64.run_for_cycles(12345);
+        REQUIRE(c64.system_clock == 10000 + 1 + 12345);
+        REQUIRE(c64.cpu.clock_count == c64.system_clock);
+
+        auto other = C64();
+        other.reset();
+        for (int i = 0; i < 10000 + 1 + 12345; i++) {
+            other.clock();
+        }
+        REQUIRE(other.cpu.pc == c64.cpu.pc);
+        REQUIRE(other.cpu.cycles == c64.cpu.cycles);
+        REQUIRE(other.cpu.a == c64.cpu.a);
+    }
+
+    SECTION("Run until PC") {
+        c64.reset();
+        // RAMTAS, called early on by the KERNAL's reset routine
+        uint64_t cycles = c64.run_until_pc(0xFD50, 100000);
+        REQUIRE(c64.cpu.pc == 0xFD50);
+        REQUIRE(c64.cpu.complete());
+
+        auto other = C64();
+        other.reset();
+        uint64_t stepped = 0;
+        do {
+            stepped += other.step_instruction();
+        } while (other.cpu.pc != 0xFD50);
+        REQUIRE(cycles == stepped);
+
+        REQUIRE(c64.run_until_pc(0x0000, 5000) == 5000);
+        REQUIRE(c64.system_clock == stepped + 5000);
+
+        // INX, JMP $C000, started at the PC it runs until
+        c64.reset();
+        const uint8_t loop[] = {0xE8, 0x4C, 0x00, 0xC0};
+        for (uint16_t i = 0; i < sizeof(loop); i++) {
+            c64.write(0xC000 + i, loop[i]);
+        }
+        c64.cpu.pc = 0xC000;
+        c64.cpu.cycles = 0;
+        c64.cpu.x = 0;
+        REQUIRE(c64.run_until_pc(0xC000, 1000) == 5);
+        REQUIRE(c64.cpu.pc == 0xC000);
+        REQUIRE(c64.cpu.x == 1);
+        REQUIRE(!c64.last_break());
+        REQUIRE(c64.breakpoints == nullptr);
+
+        // a breakpoint of the caller on the way stops it, and is passed when resuming
+        int id = c64.add_breakpoint(0xC001);
+        REQUIRE(c64.run_until_pc(0xC000, 1000) == 2);
+        REQUIRE(c64.cpu.pc == 0xC001);
+        REQUIRE(c64.last_break()->id == id);
+        REQUIRE(c64.run_until_pc(0xC000, 1000) == 3);
+        REQUIRE(c64.cpu.pc == 0xC000);
+        REQUIRE(c64.cpu.x == 2);
+        REQUIRE(!c64.last_break());
+
+        c64.reset();
+        REQUIRE(c64.run_frames(2) == 2 * C64::cycles_per_frame);
+    }
+
+    SECTION("Save and load state") {
+        c64.reset();
+        c64.run_for_cycles(100000);
+        auto base = c64.save_state();
+        REQUIRE(base.size() > 0x10000);
+
+        c64.run_for_cycles(20000);
+        auto full = c64.save_state();
+        auto delta = c64.save_state(base);
+        REQUIRE(delta.size() < full.size());
+
+        auto from_full = C64();
+        from_full.load_state(full);
+        auto from_delta = C64();
+        from_delta.load_state(delta, base);
+        REQUIRE(from_full.save_state() == full);
+        REQUIRE(from_delta.save_state() == full);
+
+        c64.run_for_cycles(5000);
+        from_delta.run_for_cycles(5000);
+        REQUIRE(from_delta.save_state() == c64.save_state());
+
+        REQUIRE_THROWS(from_full.load_state(delta));
+        REQUIRE_THROWS(from_full.load_state(full, base));
+
+        // a base from the same clock with other RAM is told apart
+        auto other = C64();
+        other.load_state(base);
+        const uint8_t byte = 0x55;
+        other.write_ram(0x8000, &byte, 1);
+        auto other_base = other.save_state();
+        REQUIRE_THROWS_WITH(from_full.load_state(delta, other_base),
+                            "delta state was made against a different base");
+        REQUIRE(from_full.save_state() == full);
+        REQUIRE_THROWS(from_full.load_state(std::vector<uint8_t>(16)));
+    }
+
+    SECTION("Fork") {
+        c64.reset();
+        c64.run_for_cycles(100000);
+        auto child = c64.fork();
+        REQUIRE(child->save_state() == c64.save_state());
+        REQUIRE(child->shared_pages[0x04] == c64.shared_pages[0x04]);
+
+        // writes are private to the side that made them
+        child->write(0x0400, 0x01);
+        c64.write(0x0400, 0x02);
+        REQUIRE(child->read(0x0400) == 0x01);
+        REQUIRE(c64.read(0x0400) == 0x02);
+        REQUIRE(child->shared_pages[0x04] == nullptr);
+        REQUIRE(child->shared_pages[0x05] == c64.shared_pages[0x05]);
+
+        // both sides keep running the same program
+        c64.write(0x0400, 0x01);
+        child->run_for_cycles(50000);
+        c64.run_for_cycles(50000);
+        REQUIRE(child->save_state() == c64.save_state());
+
+        auto grandchild = child->fork();
+        child.reset();
+        grandchild->run_for_cycles(1000);
+        c64.run_for_cycles(1000);
+        REQUIRE(grandchild->save_state() == c64.save_state());
+
+        // RAM in one piece takes the pages back
+        uint8_t *ram = grandchild->ram_data();
+        REQUIRE(grandchild->shared_pages[0x05] == nullptr);
+        REQUIRE(ram[0x0400] == 0x01);
+        ram[0x0401] = 0x07;
+        REQUIRE(grandchild->read(0x0401) == 0x07);
+        REQUIRE(c64.read(0x0401) != 0x07);
+
+        // the frame and the audio stay behind, the picture is back a frame later
+        c64.run_for_cycles(2500000);
+        c64.enable_audio();
+        auto drawing = c64.fork();
+        REQUIRE(drawing->audio_sample_rate() == 0);
+        REQUIRE(c64.get_vic().frame()[0] == 14); // light blue border
+        REQUIRE(drawing->get_vic().frame()[0] == 0);
+        drawing->run_frames(1);
+        c64.run_frames(1);
+        REQUIRE(std::memcmp(drawing->get_vic().frame(), c64.get_vic().frame(),
+                            VicII::frame_width * VicII::frame_height) == 0);
+        REQUIRE(drawing->save_state() == c64.save_state());
+    }
+
+    SECTION("Block cache") {
+        auto cached = C64();
+        cached.set_dispatch(Dispatch::Cached);
+        c64.reset();
+        cached.reset();
+
+        c64.run_for_cycles(3000000);
+        cached.run_for_cycles(3000000);
+        REQUIRE(cached.save_state() == c64.save_state());
+        REQUIRE(cached.read(0x04CD, true) == 0x2E); // READY.
+
+        c64.type("PRINT 6*7\n");
+        cached.type("PRINT 6*7\n");
+        c64.run_for_cycles(500000);
+        cached.run_for_cycles(500000);
+        REQUIRE(cached.save_state() == c64.save_state());
+
+        // the KERNAL's IRQ handler, called through $0314, first runs INC $C100
+        uint8_t *ram = cached.ram_data();
+        const uint8_t handler[] = {0xEE, 0x00, 0xC1, 0x4C, 0x31, 0xEA};
+        std::memcpy(ram + 0xC000, handler, sizeof(handler));
+        ram[0x0314] = 0x00;
+        ram[0x0315] = 0xC0;
+        cached.ram_written();
+        cached.run_frames(10);
+        uint8_t count = ram[0xC100];
+        REQUIRE(count > 0);
+
+        // now INC $C101, the cached INC $C100 has to go
+        ram[0xC001] = 0x01;
+        cached.ram_written();
+        cached.run_frames(10);
+        REQUIRE(ram[0xC100] == count);
+        REQUIRE(ram[0xC101] > 0);
+    }
+
+    SECTION("JIT") {
+        auto jit = C64();
+        jit.set_dispatch(Dispatch::Jit);
+        c64.reset();
+        jit.reset();
+
+        c64.run_for_cycles(3000000);
+        jit.run_for_cycles(3000000);
+        REQUIRE(jit.save_state() == c64.save_state());
+
+        c64.type("PRINT 6*7\n");
+        jit.type("PRINT 6*7\n");
+        c64.run_for_cycles(500000);
+        jit.run_for_cycles(500000);
+        REQUIRE(jit.save_state() == c64.save_state());
+    }
+}
@@ -0,0 +1,215 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+#include <string>
+
+// Counts NMIs from CIA 2 timer A, every 1000 cycles, with the ROMs banked out:
+//      SEI
+//      LDA #$35 : STA $01
+//      LDA #$40 : STA $FFFA
+//      LDA #$C0 : STA $FFFB    ; NMI vector -> handler
+//      LDA #$E7 : STA $DD04
+//      LDA #$03 : STA $DD05    ; latch 999
+//      LDA #$81 : STA $DD0D    ; timer A interrupt on
+//      LDA #$11 : STA $DD0E    ; load and start, continuous
+// loop JMP loop
+// handler ($C040):
+//      INC $02
+//      LDA $DD0D               ; acknowledge
+//      RTI
+static void load_timer_nmi(C64 &c64) {
+    const uint8_t program[] = {
+            0x78, 0xA9, 0x35, 0x85, 0x01, 0xA9, 0x40, 0x8D, 0xFA, 0xFF, 0xA9, 0xC0, 0x8D, 0xFB, 0xFF,
+            0xA9, 0xE7, 0x8D, 0x04, 0xDD, 0xA9, 0x03, 0x8D, 0x05, 0xDD, 0xA9, 0x81, 0x8D, 0x0D, 0xDD,
+            0xA9, 0x11, 0x8D, 0x0E, 0xDD, 0x4C, 0x23, 0xC0,
+    };
+    const uint8_t handler[] = {0xE6, 0x02, 0xAD, 0x0D, 0xDD, 0x40};
+    c64.reset();
+    c64.write_ram(0xC000, program, sizeof(program));
+    c64.write_ram(0xC040, handler, sizeof(handler));
+    c64.cpu.pc = 0xC000;
+    c64.cpu.cycles = 0;
+}
+
+static void boot(C64 &c64) {
+    c64.reset();
+    // the '.' of READY. on the screen
+    while (c64.read(0x04CD, true) != 0x2E) {
+        c64.run_for_cycles(10000);
+    }
+}
+
+TEST_CASE("CIA") {
+    auto cia = Cia();
+
+    SECTION("Timers") {
+        cia.write(0x04, 99, 0);
+        cia.write(0x05, 0, 0);
+        cia.write(0x0D, 0x83, 0);
+        cia.write(0x0E, 0x11, 0); // load and start, continuous
+        REQUIRE(cia.next_irq() == 100);
+
+        cia.run_until(99);
+        REQUIRE(cia.read(0x04, 99, true) == 0);
+        REQUIRE(!cia.irq());
+        cia.run_until(100);
+        REQUIRE(cia.irq());
+        REQUIRE(cia.read(0x04, 100, true) == 99);
+        REQUIRE(cia.read(0x0D, 100, false) == 0x81);
+        REQUIRE(!cia.irq());
+
+        // timer B counts timer A's underflows, the fifth one underflows it
+        cia.write(0x06, 4, 100);
+        cia.write(0x07, 0, 100);
+        cia.write(0x0F, 0x51, 100);
+        REQUIRE(cia.next_irq() == 200);
+        cia.run_until(599);
+        REQUIRE(cia.read(0x0D, 599, false) == 0x81);
+        cia.run_until(600);
+        REQUIRE(cia.read(0x0D, 600, false) == 0x83);
+
+        // many periods at once
+        cia.run_until(100050);
+        REQUIRE(cia.read(0x04, 100050, true) == 49);
+        REQUIRE(cia.read(0x0D, 100050, false) == 0x83);
+
+        // a one shot timer stops after it underflows
+        cia.write(0x0E, 0x00, 100050);
+        cia.write(0x0F, 0x19, 100050);
+        REQUIRE(cia.next_irq() == 100055);
+        cia.run_until(200000);
+        REQUIRE(cia.read(0x0D, 200000, false) == 0x82);
+        REQUIRE((cia.read(0x0F, 200000, true) & 0x01) == 0);
+        REQUIRE(cia.next_irq() == UINT64_MAX);
+    }
+
+    SECTION("Time of day") {
+        cia.write(0x0E, 0x80, 0); // 50 Hz
+        // 01:02:03.4, the clock stops on the hours and starts on the tenths
+        cia.write(0x0B, 0x01, 0);
+        cia.write(0x0A, 0x02, 0);
+        cia.write(0x09, 0x03, 1000);
+        REQUIRE(cia.read(0x09, 5000, true) == 0x03);
+        cia.write(0x08, 0x04, 5000);
+
+        uint64_t second = 5000 + Cia::clock_rate;
+        REQUIRE(cia.read(0x08, second - 1, true) == 0x03);
+        REQUIRE(cia.read(0x08, second, true) == 0x04);
+        REQUIRE(cia.read(0x09, second, true) == 0x04);
+
+        // reading the hours holds the time until the tenths are read
+        REQUIRE(cia.read(0x0B, second, false) == 0x01);
+        REQUIRE(cia.read(0x09, second + 2 * Cia::clock_rate, false) == 0x04);
+        REQUIRE(cia.read(0x08, second + 2 * Cia::clock_rate, false) == 0x04);
+        REQUIRE(cia.read(0x09, second + 2 * Cia::clock_rate, false) == 0x06);
+
+        // alarm at 01:02:05.0, 1.6 s after the clock started
+        cia.write(0x0F, 0x80, 0);
+        cia.write(0x0B, 0x01, 0);
+        cia.write(0x0A, 0x02, 0);
+        cia.write(0x09, 0x05, 0);
+        cia.write(0x08, 0x00, 0);
+        cia.write(0x0D, 0x84, 0);
+        uint64_t due = 5000 + (16 * 5 * Cia::clock_rate + 49) / 50;
+        REQUIRE(cia.next_irq() == due);
+        cia.run_until(due - 1);
+        REQUIRE(!cia.irq());
+        cia.run_until(due);
+        REQUIRE(cia.read(0x0D, due, false) == 0x84);
+        // the same time a day later
+        REQUIRE(cia.next_irq() == 5000 + ((16 + 864000) * 5 * Cia::clock_rate + 49) / 50);
+    }
+
+    SECTION("Keyboard matrix") {
+        cia.write(0x02, 0xFF, 0);
+        cia.write(0x03, 0x00, 0);
+        cia.set_key(1, 2, true);
+        cia.write(0x00, 0xFF, 0);
+        REQUIRE(cia.read(0x01, 0, false) == 0xFF);
+        cia.write(0x00, 0xFD, 0);
+        REQUIRE(cia.read(0x01, 0, false) == 0xFB);
+        cia.set_key(1, 2, false);
+        REQUIRE(cia.read(0x01, 0, false) == 0xFF);
+
+        cia.set_joystick_b(0x10);
+        cia.write(0x00, 0xFF, 0);
+        REQUIRE(cia.read(0x01, 0, false) == 0xEF);
+    }
+}
+
+TEST_CASE("CIA in the C64") {
+    auto c64 = C64();
+
+    SECTION("Jiffy clock") {
+        // the KERNAL's timer A interrupt counts TI 60 times a second
+        boot(c64);
+        auto jiffies = [&c64] {
+            return c64.ram[0xA0] << 16 | c64.ram[0xA1] << 8 | c64.ram[0xA2];
+        };
+        int before = jiffies();
+        c64.run_for_cycles(Cia::clock_rate);
+        int counted = jiffies() - before;
+        REQUIRE(59 <= counted);
+        REQUIRE(counted <= 61);
+    }
+
+    SECTION("Keyboard") {
+        boot(c64);
+        c64.render_text_screen();
+        c64.set_key(1, 2, true); // A
+        c64.run_frames(3);
+        c64.set_key(1, 2, false);
+        c64.run_frames(3);
+        REQUIRE(c64.render_text_screen().ascii().substr(6 * 41, 2) == "A ");
+        REQUIRE_THROWS_AS(c64.set_key(8, 0, true), std::out_of_range);
+        REQUIRE_THROWS_AS(c64.set_joystick(3, 0), std::out_of_range);
+    }
+
+    SECTION("Timer NMI") {
+        for (auto dispatch: {Dispatch::Table, Dispatch::Threaded, Dispatch::Cached, Dispatch::Jit}) {
+            auto machine = C64();
+            machine.set_dispatch(dispatch);
+            load_timer_nmi(machine);
+            machine.run_for_cycles(100000);
+            REQUIRE(machine.ram[0x02] >= 99);
+            REQUIRE(machine.ram[0x02] <= 100);
+
+            auto reference = C64();
+            load_timer_nmi(reference);
+            reference.run_for_cycles(100000);
+            REQUIRE(machine.save_state() == reference.save_state());
+        }
+
+        auto clocked = C64();
+        load_timer_nmi(clocked);
+        for (uint64_t i = 0; i < 100000; i++) {
+            clocked.clock();
+        }
+        load_timer_nmi(c64);
+        c64.run_for_cycles(100000);
+        REQUIRE(clocked.save_state() == c64.save_state());
+    }
+
+    SECTION("Same state whichever way it runs") {
+        boot(c64);
+        auto booted = c64.save_state();
+        c64.run_frames(5);
+
+        for (auto dispatch: {Dispatch::Threaded, Dispatch::Cached, Dispatch::Jit}) {
+            auto machine = C64();
+            machine.set_dispatch(dispatch);
+            machine.load_state(booted);
+            machine.run_frames(5);
+            REQUIRE(machine.save_state() == c64.save_state());
+        }
+
+        auto clocked = C64();
+        clocked.load_state(booted);
+        for (uint64_t i = 0; i < 5 * C64::cycles_per_frame; i++) {
+            clocked.clock();
+        }
+        REQUIRE(clocked.save_state() == c64.save_state());
+    }
+}
@@ -18,6 +18,70 @@ TEST_CASE("CPU") {
         REQUIRE(status == 0x51);
     }
 
+    SECTION("CPU status register") {
+        for (int value = 0; value <= 0xFF; value++) {
+            cpu.status = value;
+            REQUIRE(uint8_t(cpu.status) == value);
+        }
+
+        const uint8_t program[] = {
+                0xA9, 0x80, // $0200 LDA #$80
+                0x69, 0x80, // $0202 ADC #$80 (C, Z and V set, N clear)
+                0x08,       // $0204 PHP
+                0x24, 0x10, // $0205 BIT $10 (N and V from $C0, Z from A & $C0)
+        };
+        for (int i = 0; i < sizeof(program); i++) {
+            bus.write(0x0200 + i, program[i]);
+        }
+        bus.write(0x0010, 0xC0);
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x02);
+        cpu.reset(bus);
+
+        cpu.step_instruction(bus);
+        REQUIRE(uint8_t(cpu.status) == (Flags6502::N | Flags6502::U | Flags6502::I));
+        cpu.step_instruction(bus);
+        REQUIRE(uint8_t(cpu.status) == (Flags6502::C | Flags6502::Z | Flags6502::V | Flags6502::U | Flags6502::I));
+        cpu.step_instruction(bus);
+        REQUIRE(bus.read(0x01FD) == (Flags6502::C | Flags6502::Z | Flags6502::V | Flags6502::B | Flags6502::U |
+                                     Flags6502::I));
+        cpu.step_instruction(bus);
+        REQUIRE(uint8_t(cpu.status) == (Flags6502::N | Flags6502::Z | Flags6502::V | Flags6502::C | Flags6502::U |
+                                        Flags6502::I));
+        REQUIRE(cpu.is_status_flag_set(Flags6502::Z));
+        REQUIRE(cpu.get_flag(Flags6502::C) == 1);
+    }
+
+    SECTION("CPU decimal mode") {
+        const uint8_t program[] = {
+                0xF8,       // $0200 SED
+                0x18,       // $0201 CLC
+                0xA9, 0x58, // $0202 LDA #$58
+                0x69, 0x46, // $0204 ADC #$46 -> $04, C set
+                0xE9, 0x05, // $0206 SBC #$05 -> $99, C clear (borrow)
+                0xE9, 0x98, // $0208 SBC #$98 -> $00, C set
+        };
+        for (int i = 0; i < sizeof(program); i++) {
+            bus.write(0x0200 + i, program[i]);
+        }
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x02);
+        cpu.reset(bus);
+
+        for (int i = 0; i < 4; i++) {
+            cpu.step_instruction(bus);
+        }
+        REQUIRE(cpu.a == 0x04);
+        REQUIRE(cpu.is_status_flag_set(Flags6502::C));
+        cpu.step_instruction(bus);
+        REQUIRE(cpu.a == 0x99);
+        REQUIRE(!cpu.is_status_flag_set(Flags6502::C));
+        cpu.step_instruction(bus);
+        REQUIRE(cpu.a == 0x00);
+        REQUIRE(cpu.is_status_flag_set(Flags6502::C));
+        REQUIRE(cpu.is_status_flag_set(Flags6502::Z));
+    }
+
     SECTION("CPU reset") {
         bus.write(0xFFFC, 0xA5);
         bus.write(0xFFFD, 0x7F);
@@ -34,6 +98,73 @@ TEST_CASE("CPU") {
         REQUIRE(cpu.cycles == 7);
     }
 
+    SECTION("CPU step instruction") {
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x02);
+        bus.write(0x0200, 0xEA); // NOP
+        bus.write(0x0201, 0xAD); // LDA $0300
+        bus.write(0x0202, 0x00);
+        bus.write(0x0203, 0x03);
+        cpu.reset(bus);
+
+        REQUIRE(cpu.step_instruction(bus) == 8 + 2);
+        REQUIRE(cpu.pc == 0x0201);
+        REQUIRE(cpu.complete());
+        REQUIRE(cpu.step_instruction(bus) == 4);
+        REQUIRE(cpu.pc == 0x0204);
+        REQUIRE(cpu.clock_count == 14);
+    }
+
+    SECTION("CPU run for cycles") {
+        for (uint16_t addr = 0x0200; addr < 0x0300; addr++) {
+            bus.write(addr, 0xEA); // NOP
+        }
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x02);
+        cpu.reset(bus);
+
+        REQUIRE(cpu.run_for_cycles(bus, 5) == 5);
+        REQUIRE(cpu.cycles == 3);
+        REQUIRE(cpu.run_for_cycles(bus, 4) == 4);
+        REQUIRE(cpu.pc == 0x0201);
+        REQUIRE(cpu.cycles == 1);
+        REQUIRE(cpu.run_for_cycles(bus, 100) == 100);
+        REQUIRE(cpu.clock_count == 109);
+        REQUIRE(cpu.pc == 0x0200 + 51);
+        REQUIRE(cpu.cycles == 1);
+    }
+
+    SECTION("CPU block cache") {
+        cpu.dispatch = Dispatch::Cached;
+        const uint8_t program[] = {
+                0xA9, 0x01,       // $0200 LDA #$01
+                0x8D, 0x06, 0x02, // $0202 STA $0206 (the operand of the next LDX)
+                0xA2, 0x00,       // $0205 LDX #$00
+                0x4C, 0x00, 0x02, // $0207 JMP $0200
+        };
+        for (int i = 0; i < sizeof(program); i++) {
+            bus.write(0x0200 + i, program[i]);
+        }
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x02);
+        cpu.reset(bus);
+
+        cpu.step_instruction(bus);
+        cpu.step_instruction(bus);
+        cpu.step_instruction(bus);
+        REQUIRE(cpu.x == 0x01);
+        REQUIRE(cpu.clock_count == 8 + 2 + 4 + 2);
+
+        // the second time around the block comes from the cache
+        bus.write(0x0201, 0x02);
+        cpu.invalidate_code(0x0201);
+        for (int i = 0; i < 4; i++) {
+            cpu.step_instruction(bus);
+        }
+        REQUIRE(cpu.x == 0x02);
+        REQUIRE(cpu.pc == 0x0207);
+    }
+
     SECTION("CPU Addressing Mode Names") {
         bool all_success = true;
         uint8_t count = 0;
@@ -26,15 +26,11 @@ void run_klaus_test(CPU6502 &cpu, const std::string &rom_path, uint16_t stop_pc,
     int count = 0;
     while (cpu.pc != stop_pc) {
         count++;
-        while (!cpu.complete()) {
-            cpu.clock(bus);
-        }
-
         if(trace) {
             std::string status = nestools::full_cpu_status_as_string(cpu, bus);
             fmt::print("{:d} -> {}\n", count, status);
         }
-        cpu.clock(bus);
+        cpu.step_instruction(bus);
 
         if (pc == cpu.pc) {
             std::string status = nestools::full_cpu_status_as_string(cpu, bus);
@@ -53,6 +49,26 @@ void run_klaus_test(CPU6502 &cpu, const std::string &rom_path, uint16_t stop_pc,
     fmt::print("Running time: {:d} ms.\n", duration.count());
 }
 
+// run_for_cycles is what lets the JIT run whole blocks, the test ends in a
+// JMP to itself at `stop_pc`
+void run_klaus_test_in_slices(CPU6502 &cpu, const std::string &rom_path, uint16_t stop_pc) {
+    auto data = load_rom_file(rom_path);
+    auto bus = MockBus();
+    for (int index = 0; index < data.size(); index++) {
+        bus.write(index, data[index]);
+    }
+    bus.write(0xFFFC, 0x00);
+    bus.write(0xFFFD, 0x04);
+    cpu.reset(bus);
+
+    uint16_t pc = -1;
+    while (cpu.pc != stop_pc || !cpu.complete()) {
+        cpu.run_for_cycles(bus, 997);
+        REQUIRE_MESSAGE((pc != cpu.pc || !cpu.complete()), fmt::format("Trapped at ${:04X}", cpu.pc));
+        pc = cpu.complete() ? cpu.pc : -1;
+    }
+}
+
 TEST_CASE("Run Klaus' Tests") {
     SECTION("Klaus Functional Test") {
         // Decimal testing starts at 0x336D
@@ -61,6 +77,46 @@ TEST_CASE("Run Klaus' Tests") {
         run_klaus_test(cpu, "roms/6502_functional_test.bin", 0x3469, false);
     }
 
+    SECTION("Klaus Functional Test with the block cache") {
+        auto cpu = CPU6502();
+        cpu.dispatch = Dispatch::Cached;
+        run_klaus_test(cpu, "roms/6502_functional_test.bin", 0x3469, false);
+    }
+
+    SECTION("Klaus Functional Test threaded") {
+        auto cpu = CPU6502();
+        cpu.dispatch = Dispatch::Threaded;
+        run_klaus_test_in_slices(cpu, "roms/6502_functional_test.bin", 0x3469);
+    }
+
+    SECTION("Klaus Functional Test with the JIT") {
+        auto cpu = CPU6502();
+        cpu.dispatch = Dispatch::Jit;
+        run_klaus_test_in_slices(cpu, "roms/6502_functional_test.bin", 0x3469);
+    }
+
+    SECTION("Every backend counts the instructions it runs") {
+        auto reference = CPU6502();
+        run_klaus_test(reference, "roms/6502_functional_test.bin", 0x3469, false);
+        REQUIRE(reference.instruction_count > 30000000);
+
+        auto data = load_rom_file("roms/6502_functional_test.bin");
+        auto dispatch = GENERATE(Dispatch::Switch, Dispatch::Table, Dispatch::Threaded, Dispatch::Cached, Dispatch::Jit);
+        auto bus = MockBus();
+        for (size_t index = 0; index < data.size(); index++) {
+            bus.write(index, data[index]);
+        }
+        bus.write(0xFFFC, 0x00);
+        bus.write(0xFFFD, 0x04);
+        auto cpu = CPU6502();
+        cpu.dispatch = dispatch;
+        cpu.reset(bus);
+        cpu.run_for_cycles(bus, reference.clock_count);
+        REQUIRE(cpu.pc == 0x3469);
+        REQUIRE(cpu.complete());
+        REQUIRE(cpu.instruction_count == reference.instruction_count);
+    }
+
     SECTION("Common functionality test") {
         auto data = load_rom_file("roms/6502_functional_test.bin");
         REQUIRE(data.size() == 0x10000);
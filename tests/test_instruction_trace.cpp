@@ -0,0 +1,92 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+#include <c64/instruction_trace.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+TEST_CASE("Instruction trace") {
+    SECTION("LZ round trip") {
+        std::mt19937 random(42);
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 50000; i++) {
+            // runs, repeats and noise
+            data.push_back(i % 1000 < 500 ? uint8_t(i / 7) : uint8_t(random()));
+        }
+        std::vector<uint8_t> packed;
+        lz_compress(data.data(), data.size(), packed);
+        REQUIRE(packed.size() < data.size());
+
+        std::vector<uint8_t> unpacked(data.size());
+        lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+        REQUIRE(unpacked == data);
+
+        REQUIRE_THROWS(lz_decompress(packed.data(), packed.size() - 1, unpacked.data(), unpacked.size()));
+
+        packed.clear();
+        lz_compress(data.data(), 0, packed);
+        lz_decompress(packed.data(), packed.size(), unpacked.data(), 0);
+    }
+
+    SECTION("Trace a run") {
+        auto c64 = C64();
+        auto reference = C64();
+        c64.reset();
+        reference.reset();
+
+        FILE *file = std::tmpfile();
+        uint64_t written;
+        {
+            auto tracer = InstructionTracer(file);
+            c64.set_instruction_tracer(&tracer);
+            c64.run_for_cycles(300000);
+            c64.step_instruction();
+            c64.set_instruction_tracer(nullptr);
+            c64.run_for_cycles(1000);
+        }
+        std::rewind(file);
+
+        // replay the same instructions on a second machine and compare
+        auto reader = TraceReader(file);
+        TraceRecord record{};
+        uint64_t count = 0;
+        while (reader.next(record)) {
+            auto expected = trace_record(reference.cpu, reference, reference.cpu.clock_count + reference.cpu.cycles);
+            REQUIRE(std::memcmp(&record.bytes, &expected.bytes, 3) == 0);
+            REQUIRE(record.pc == expected.pc);
+            REQUIRE(record.cycle == expected.cycle);
+            REQUIRE(record.a == expected.a);
+            REQUIRE(record.x == expected.x);
+            REQUIRE(record.y == expected.y);
+            REQUIRE(record.sp == expected.sp);
+            REQUIRE(record.p == expected.p);
+            reference.step_instruction();
+            count++;
+        }
+        REQUIRE(count > 50000);
+        REQUIRE(reference.cpu.clock_count + reference.cpu.cycles == c64.cpu.clock_count + c64.cpu.cycles - 1000);
+
+        written = std::ftell(file);
+        // a few bits per instruction
+        REQUIRE(written < count);
+        std::fclose(file);
+    }
+
+    SECTION("Text format") {
+        TraceRecord record{1234, 0xFD6E, {0xB1, 0xC1, 0x00}, 0x55, 0x00, 0x00, 0xFB, 0x24};
+        REQUIRE(format_trace_record(record) ==
+                "FD6E  B1 C1     LDA ($C1),Y                     A:55 X:00 Y:00 P:24 SP:FB CYC:1234 IZY ..I..U..");
+    }
+
+    SECTION("Not a trace") {
+        FILE *file = std::tmpfile();
+        std::fputs("hello", file);
+        std::rewind(file);
+        REQUIRE_THROWS(TraceReader(file));
+        std::fclose(file);
+    }
+}
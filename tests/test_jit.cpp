@@ -0,0 +1,34 @@
+#include "catch2.hpp"
+
+#define private public
+#define protected public
+#include "c64/cpu_6502.hpp"
+#include "common.hpp"
+
+TEST_CASE("JIT") {
+    auto data = load_rom_file("roms/6502_functional_test.bin");
+    auto bus = MockBus();
+    for (size_t index = 0; index < data.size(); index++) {
+        bus.write(index, data[index]);
+    }
+    bus.write(0xFFFC, 0x00);
+    bus.write(0xFFFD, 0x04);
+
+    auto cpu = CPU6502();
+    cpu.dispatch = Dispatch::Jit;
+    cpu.reset(bus);
+
+    SECTION("Falls back to the block cache without executable memory") {
+        cpu.run_for_cycles(bus, 1000000);
+        REQUIRE(cpu.code_cache->jit != nullptr);
+
+        // unaligned addresses make mprotect fail from the next function on
+        cpu.code_cache->jit->page_size = 1;
+        for (int slice = 0; slice < 200 && !(cpu.pc == 0x3469 && cpu.complete()); slice++) {
+            cpu.run_for_cycles(bus, 1000000);
+        }
+        REQUIRE(cpu.dispatch == Dispatch::Cached);
+        REQUIRE(cpu.code_cache->jit == nullptr);
+        REQUIRE(cpu.pc == 0x3469);
+    }
+}
@@ -0,0 +1,109 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+#include <c64/instrumentation.hpp>
+#include <c64/profiler.hpp>
+#include <c64/symbols.hpp>
+
+// loop: JSR sub; JMP loop
+// sub: INX; RTS
+static void load_calls(C64 &c64) {
+    const uint8_t program[] = {0x20, 0x10, 0xC0, 0x4C, 0x00, 0xC0};
+    const uint8_t sub[] = {0xE8, 0x60};
+    c64.reset();
+    c64.write_ram(0xC000, program, sizeof(program));
+    c64.write_ram(0xC010, sub, sizeof(sub));
+    c64.cpu.pc = 0xC000;
+    c64.cpu.cycles = 0;
+}
+
+TEST_CASE("Profiler") {
+    auto c64 = C64();
+    load_calls(c64);
+
+    SECTION("Counts per PC") {
+        auto &profiler = c64.enable_profiler();
+        c64.run_for_cycles(17 * 1000);
+
+        // JSR 6, JMP 3, INX 2, RTS 6
+        REQUIRE(profiler.instructions(0xC000) == 1000);
+        REQUIRE(profiler.cycles(0xC000) == 6000);
+        REQUIRE(profiler.cycles(0xC003) == 3000);
+        REQUIRE(profiler.cycles(0xC010) == 2000);
+        REQUIRE(profiler.cycles(0xC011) == 6000);
+        REQUIRE(profiler.total_cycles() == 17 * 1000);
+        REQUIRE(!profiler.has_call_graph());
+
+        auto stepped = C64();
+        load_calls(stepped);
+        auto &by_step = stepped.enable_profiler();
+        while (by_step.total_cycles() < 17 * 1000) {
+            stepped.step_instruction();
+        }
+        for (uint16_t pc: {0xC000, 0xC003, 0xC010, 0xC011}) {
+            REQUIRE(by_step.instructions(pc) == profiler.instructions(pc));
+            REQUIRE(by_step.cycles(pc) == profiler.cycles(pc));
+        }
+
+        c64.disable_profiler();
+        REQUIRE(c64.get_profiler() == nullptr);
+    }
+
+    SECTION("Call graph") {
+        auto &profiler = c64.enable_profiler(true);
+        c64.run_for_cycles(17 * 100);
+
+        auto edges = profiler.call_edges();
+        REQUIRE(edges.size() == 1);
+        REQUIRE(edges[0].caller == Profiler::root);
+        REQUIRE(edges[0].callee == 0xC010);
+        REQUIRE(edges[0].calls == 100);
+        REQUIRE(edges[0].cycles == 100 * (2 + 6));
+    }
+
+    SECTION("Callers 32 KB apart") {
+        // root -> $2000 -> $1234, then root -> $A000 -> $1234
+        auto &profiler = c64.enable_profiler(true);
+        for (uint16_t caller: {0x2000, 0xA000}) {
+            profiler.follow_call(0xC000, 0x20, caller);
+            profiler.follow_call(caller, 0x20, 0x1234);
+            profiler.follow_call(0x1234, 0x60, caller + 3);
+            profiler.follow_call(caller + 3, 0x60, 0xC003);
+        }
+
+        auto edges = profiler.call_edges();
+        REQUIRE(edges.size() == 4);
+        for (uint32_t caller: {0x2000u, 0xA000u}) {
+            auto edge = std::find_if(edges.begin(), edges.end(), [caller](CallEdge const &e) {
+                return e.caller == caller && e.callee == 0x1234;
+            });
+            REQUIRE(edge != edges.end());
+            REQUIRE(edge->calls == 1);
+        }
+    }
+
+    SECTION("Symbols") {
+        auto symbols = SymbolTable::c64(*c64.rom_set());
+        REQUIRE(symbols.describe(0xFFD2) == "CHROUT");
+        REQUIRE(symbols.describe(0xF1CA) == "CHROUT");
+        REQUIRE(symbols.describe(0xF1CB) == "CHROUT+1");
+        REQUIRE(symbols.describe(0xFD50) == "RAMTAS");
+        REQUIRE(symbols.describe(0xA831) == "BASIC_END");
+        REQUIRE(symbols.describe(0x0074) == "CHRGET+1");
+        REQUIRE(symbols.describe(0x0090) == "$0090");
+        REQUIRE(symbols.describe(0xC000) == "$C000");
+    }
+
+    SECTION("Report") {
+        c64.reset();
+        auto &profiler = c64.enable_profiler(true);
+        c64.run_for_cycles(2500000);
+
+        auto symbols = SymbolTable::c64(*c64.rom_set());
+        auto report = c64tools::profile_report(profiler, symbols, c64.get_cpu(), c64, 10);
+        REQUIRE(report.find("Routines") != std::string::npos);
+        REQUIRE(report.find("RAMTAS") != std::string::npos);
+        REQUIRE(report.find("-> RAMTAS") != std::string::npos);
+    }
+}
@@ -0,0 +1,123 @@
+# Smoke test of the Python bindings, run by ctest with the module on PYTHONPATH
+import unittest
+
+import numpy as np
+import pyc64
+
+
+def boot(dispatch=pyc64.Dispatch.Table):
+    c64 = pyc64.pyC64()
+    c64.set_dispatch(dispatch)
+    c64.reset()
+    c64.run_cycles(2500000)
+    return c64
+
+
+class PyC64Test(unittest.TestCase):
+    def test_boot(self):
+        c64 = boot()
+        self.assertIn("READY.", c64.screen_text())
+        self.assertEqual(c64.frame().shape, (272, 384))
+        self.assertEqual(c64.frame_rgba().shape, (272, 384, 4))
+        self.assertEqual(c64.run_frames(1), 312 * 63)
+
+    def test_memory_views(self):
+        c64 = pyc64.pyC64()
+        ram = c64.ram
+        self.assertEqual(ram.shape, (0x10000,))
+        self.assertEqual(ram.dtype, np.uint8)
+        self.assertTrue(ram.flags.writeable)
+
+        kernal = c64.kernal_rom
+        self.assertFalse(kernal.flags.writeable)
+        self.assertEqual(kernal[0x1FFC] | kernal[0x1FFD] << 8, 0xFCE2)  # reset vector
+        self.assertEqual(len(c64.basic_rom), 0x2000)
+        self.assertEqual(len(c64.char_rom), 0x1000)
+
+    def test_ram_writes_reach_cached_code(self):
+        for dispatch in (pyc64.Dispatch.Cached, pyc64.Dispatch.Jit):
+            c64 = boot(dispatch)
+            ram = c64.ram
+            # the KERNAL's IRQ handler, called through $0314, first runs INC $C100
+            ram[0xC000:0xC006] = [0xEE, 0x00, 0xC1, 0x4C, 0x31, 0xEA]
+            ram[0xC100:0xC102] = 0
+            ram[0x0314:0x0316] = [0x00, 0xC0]
+            c64.run_frames(10)
+            count = ram[0xC100]
+            self.assertGreater(count, 0)
+
+            # now INC $C101, the cached INC $C100 has to go
+            ram[0xC001] = 0x01
+            c64.run_frames(10)
+            self.assertEqual(ram[0xC100], count)
+            self.assertGreater(ram[0xC101], 0)
+
+    def test_save_and_load_state(self):
+        c64 = boot()
+        state = c64.save_state()
+        registers = (c64.cpu().a, c64.cpu().x, c64.cpu().y, c64.cpu().pc)
+        c64.run_frames(5)
+
+        other = pyc64.pyC64()
+        other.load_state(state)
+        self.assertEqual((other.cpu().a, other.cpu().x, other.cpu().y, other.cpu().pc), registers)
+        other.run_frames(5)
+        self.assertEqual(other.save_state(), c64.save_state())
+
+    def test_breakpoint(self):
+        c64 = pyc64.pyC64()
+        c64.reset()
+        point = c64.add_breakpoint(0xFD50)  # RAMTAS
+        self.assertLess(c64.run_cycles(100000), 100000)
+        self.assertEqual(c64.cpu().pc, 0xFD50)
+        self.assertEqual(c64.last_break().id, point)
+        self.assertEqual(c64.last_break().kind, pyc64.BreakKind.Breakpoint)
+
+
+class VecC64Test(unittest.TestCase):
+    def test_machines_diverge_and_match_lone_ones(self):
+        # four machines started from the same boot, each with its own RAM byte
+        source = boot()
+        states = []
+        for i in range(4):
+            machine = pyc64.pyC64()
+            machine.load_state(source.save_state())
+            machine.ram[0x0400] = i + 1  # top left of the screen
+            machine.run_cycles(1000 * i)
+            states.append(machine.save_state())
+
+        vec = pyc64.VecC64(4, threads=2)
+        self.assertEqual(len(vec), 4)
+        vec.load_states(states)
+        vec.step(200000)
+
+        screens = vec.screens()
+        registers = vec.registers()
+        self.assertEqual(screens.shape, (4, 1000))
+        self.assertEqual(registers.shape, (4, 6))
+        self.assertEqual(vec.frames().shape, (4, 272, 384))
+        self.assertEqual(list(screens[:, 0]), [1, 2, 3, 4])
+
+        for i, state in enumerate(states):
+            alone = pyc64.pyC64()
+            alone.load_state(state)
+            alone.run_cycles(200000)
+            self.assertEqual(vec.save_state(i), alone.save_state())
+            self.assertTrue(np.array_equal(screens[i], alone.ram[0x0400:0x07E8]))
+            self.assertEqual(registers[i, 5], alone.cpu().pc)
+        self.assertEqual(len({vec.save_state(i) for i in range(4)}), 4)
+
+    def test_one_state_for_all(self):
+        source = boot()
+        vec = pyc64.VecC64(3)
+        vec.load_state(source.save_state())
+        vec.step(100000)
+        source.run_cycles(100000)
+        for i in range(3):
+            self.assertEqual(vec.save_state(i), source.save_state())
+        with self.assertRaises(IndexError):
+            vec.save_state(3)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,61 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+TEST_CASE("Scheduler") {
+    auto scheduler = Scheduler();
+    REQUIRE(scheduler.next() == Scheduler::never);
+    REQUIRE(!scheduler.pop(UINT64_MAX - 1));
+
+    SECTION("Earliest first") {
+        scheduler.post(Device::Cia1, 300);
+        scheduler.post(Device::Vic, 100);
+        scheduler.post(Device::Cia2, 200);
+        REQUIRE(scheduler.next() == 100);
+
+        REQUIRE(!scheduler.pop(99));
+        REQUIRE(scheduler.pop(250) == Device::Vic);
+        REQUIRE(scheduler.pop(250) == Device::Cia2);
+        REQUIRE(!scheduler.pop(250));
+        REQUIRE(scheduler.next() == 300);
+        REQUIRE(scheduler.due(Device::Vic) == Scheduler::never);
+    }
+
+    SECTION("Posting again moves the event") {
+        scheduler.post(Device::Vic, 100);
+        scheduler.post(Device::Cia1, 200);
+        scheduler.post(Device::Cia2, 300);
+
+        scheduler.post(Device::Cia2, 50);
+        REQUIRE(scheduler.next() == 50);
+        scheduler.post(Device::Cia2, 500);
+        REQUIRE(scheduler.next() == 100);
+        scheduler.post(Device::Vic, Scheduler::never);
+        REQUIRE(scheduler.next() == 200);
+        REQUIRE(scheduler.due(Device::Cia2) == 500);
+
+        REQUIRE(scheduler.pop(1000) == Device::Cia1);
+        REQUIRE(scheduler.pop(1000) == Device::Cia2);
+        REQUIRE(scheduler.next() == Scheduler::never);
+    }
+
+    SECTION("Machine") {
+        // after boot the KERNAL's timer A interrupt is the only event
+        auto c64 = C64();
+        c64.reset();
+        while (c64.read(0x04CD, true) != 0x2E) {
+            c64.run_for_cycles(10000);
+        }
+        c64.run_for_cycles(12345);
+        uint64_t due = c64.scheduler.next();
+        REQUIRE(due > c64.cpu.clock_count);
+        REQUIRE(c64.scheduler.due(Device::Cia1) == due);
+        REQUIRE(c64.scheduler.due(Device::Vic) == Scheduler::never);
+
+        // the chip is brought up to the clock once its event is due
+        c64.run_for_cycles(due - c64.cpu.clock_count + 10);
+        REQUIRE(c64.cia1.clock >= due);
+        REQUIRE(c64.scheduler.next() > due);
+    }
+}
@@ -0,0 +1,274 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// A 440 Hz triangle on voice 1 at full volume, sustained
+static void play_tone(Sid &sid, uint64_t now) {
+    auto frequency = uint16_t(440 * (uint64_t(1) << 24) / Sid::clock_rate);
+    sid.write(0x00, frequency & 0xFF);
+    sid.write(0x01, frequency >> 8);
+    sid.write(0x05, 0x00);
+    sid.write(0x06, 0xF0);
+    sid.write(0x18, 0x0F);
+    sid.run_until(now);
+    sid.write(0x04, 0x11);
+}
+
+static int zero_crossings(std::vector<int16_t> const &samples, size_t from) {
+    double mean = 0.0;
+    for (size_t i = from; i < samples.size(); i++) {
+        mean += samples[i];
+    }
+    mean /= double(samples.size() - from);
+    int crossings = 0;
+    for (size_t i = from + 1; i < samples.size(); i++) {
+        crossings += (samples[i - 1] < mean) != (samples[i] < mean);
+    }
+    return crossings;
+}
+
+TEST_CASE("SID") {
+    auto sid = Sid();
+
+    SECTION("Oscillator") {
+        // voice 3 sawtooth, OSC3 reads its top 8 bits
+        sid.write(0x0E, 0x00);
+        sid.write(0x0F, 0x10);
+        sid.write(0x12, 0x20);
+        sid.run_until(800);
+        REQUIRE(sid.read(0x1B) == 0x32);
+        sid.run_until(815);
+        REQUIRE(sid.read(0x1B) == 0x32);
+        sid.run_until(816);
+        REQUIRE(sid.read(0x1B) == 0x33);
+
+        // the test bit holds it at 0
+        sid.write(0x12, 0x28);
+        sid.run_until(10000);
+        REQUIRE(sid.read(0x1B) == 0x00);
+
+        REQUIRE(sid.read(0x19) == 0xFF);
+        REQUIRE(sid.read(0x00) == 0x00);
+    }
+
+    SECTION("Envelope") {
+        sid.write(0x13, 0x00);
+        sid.write(0x14, 0x80); // sustain at 0x88
+        sid.write(0x12, 0x01);
+        sid.run_until(8 * 64);
+        uint8_t rising = sid.read(0x1C);
+        REQUIRE(0 < rising);
+        REQUIRE(rising < 0xFF);
+
+        sid.run_until(20000);
+        REQUIRE(sid.read(0x1C) == 0x88);
+
+        sid.write(0x12, 0x00);
+        sid.run_until(20000 + 8 * 64);
+        REQUIRE(sid.read(0x1C) < 0x88);
+        sid.run_until(200000);
+        REQUIRE(sid.read(0x1C) == 0x00);
+    }
+
+    SECTION("Silence") {
+        sid.set_sample_rate(48000);
+        sid.run_until(Sid::clock_rate);
+        auto samples = sid.take_samples();
+        REQUIRE(samples.size() > 47900);
+        REQUIRE(samples.size() <= 48000);
+        for (int16_t sample: samples) {
+            REQUIRE(sample == 0);
+        }
+        REQUIRE(sid.take_samples().empty());
+    }
+
+    SECTION("Tone") {
+        sid.set_sample_rate(44100);
+        play_tone(sid, 0);
+        sid.run_until(Sid::clock_rate);
+        auto samples = sid.take_samples();
+        REQUIRE(samples.size() > 44050);
+        REQUIRE(samples.size() <= 44100);
+        // 440 periods a second, past the first tenth
+        int crossings = zero_crossings(samples, 4410);
+        REQUIRE(crossings >= 2 * 396 - 4);
+        REQUIRE(crossings <= 2 * 396 + 4);
+        int16_t peak = *std::max_element(samples.begin(), samples.end());
+        REQUIRE(peak > 4000);
+
+        // a low pass at the bottom of the range takes most of it away
+        auto filtered = Sid();
+        filtered.set_sample_rate(44100);
+        filtered.write(0x17, 0x01);
+        filtered.write(0x15, 0x00);
+        filtered.write(0x16, 0x00);
+        filtered.write(0x18, 0x1F);
+        play_tone(filtered, 0);
+        filtered.run_until(Sid::clock_rate);
+        auto low = filtered.take_samples();
+        auto range = [](std::vector<int16_t> const &s) {
+            auto [min, max] = std::minmax_element(s.begin() + 4410, s.end());
+            return *max - *min;
+        };
+        REQUIRE(range(low) * 4 < range(samples));
+    }
+
+    SECTION("SSE2 and scalar voices agree") {
+        Sid::Block block{};
+        uint32_t seed = 1;
+        auto next = [&seed] {
+            seed = seed * 1664525 + 1013904223;
+            return seed;
+        };
+        for (int step = 0; step < Sid::block_size; step++) {
+            block.accumulator[0][step] = next() >> 8;
+            block.accumulator[1][step] = next() >> 8;
+            block.noise[0][step] = next() >> 16 & 0xFF0;
+            block.level[0][step] = next() >> 24;
+        }
+
+        int32_t vectorized[Sid::block_size];
+        int32_t scalar[Sid::block_size];
+        for (int waveforms = 0x10; waveforms <= 0xF0; waveforms += 0x10) {
+            for (uint8_t ring: {0x00, 0x04}) {
+                for (uint16_t pw: {0x000, 0x800, 0xFFF}) {
+                    // the odd count leaves the last steps to the scalar loop
+                    for (int count: {Sid::block_size, Sid::block_size - 3}) {
+                        auto control = uint8_t(waveforms | ring);
+                        Sid::render_voice(block.accumulator[0], block.accumulator[1], block.noise[0],
+                                          block.level[0], control, pw, count, vectorized, true);
+                        Sid::render_voice(block.accumulator[0], block.accumulator[1], block.noise[0],
+                                          block.level[0], control, pw, count, scalar, false);
+                        REQUIRE(std::memcmp(vectorized, scalar, count * sizeof(int32_t)) == 0);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Same output however it is caught up") {
+        auto stepped = Sid();
+        sid.set_sample_rate(44100);
+        stepped.set_sample_rate(44100);
+        play_tone(sid, 1000);
+        play_tone(stepped, 1000);
+        // noise on voice 3, synced to voice 2
+        for (auto *chip: {&sid, &stepped}) {
+            chip->write(0x07, 0x00);
+            chip->write(0x08, 0x08);
+            chip->write(0x0E, 0x00);
+            chip->write(0x0F, 0x30);
+            chip->write(0x13, 0x22);
+            chip->write(0x14, 0x44);
+            chip->write(0x12, 0x83);
+        }
+
+        sid.run_until(300000);
+        for (uint64_t now = 1000; now <= 300000; now += 1 + now % 97) {
+            stepped.run_until(now);
+        }
+        stepped.run_until(300000);
+        auto a = sid.save_state(300000);
+        auto b = stepped.save_state(300000);
+        REQUIRE(std::memcmp(&a, &b, sizeof(a)) == 0);
+        REQUIRE(sid.take_samples() == stepped.take_samples());
+
+        // a state ahead of the chip is the state it gets to
+        auto ahead = sid.save_state(345678);
+        sid.run_until(345678);
+        auto caught_up = sid.save_state(345678);
+        REQUIRE(std::memcmp(&ahead, &caught_up, sizeof(ahead)) == 0);
+    }
+
+    SECTION("WAV") {
+        std::vector<int16_t> samples = {0, 1000, -1000, 32767};
+        std::string path = "test_sid.wav";
+        write_wav(path, samples, 48000);
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::remove(path.c_str());
+
+        REQUIRE(bytes.size() == 44 + 8);
+        REQUIRE(std::memcmp(bytes.data(), "RIFF", 4) == 0);
+        REQUIRE(std::memcmp(bytes.data() + 8, "WAVEfmt ", 8) == 0);
+        REQUIRE((bytes[24] | bytes[25] << 8 | bytes[26] << 16) == 48000);
+        REQUIRE(std::memcmp(bytes.data() + 36, "data", 4) == 0);
+        REQUIRE(bytes[40] == 8);
+        REQUIRE((bytes[46] | bytes[47] << 8) == 1000);
+        REQUIRE_THROWS_AS(write_wav("/nonexistent/test.wav", samples, 48000), std::runtime_error);
+    }
+}
+
+// Plays a sawtooth on voice 3 and keeps OSC3 and ENV3 at $02 and $03:
+//      LDA #$00 : STA $D40E
+//      LDA #$10 : STA $D40F
+//      LDA #$21 : STA $D412    ; sawtooth, gate on
+// loop LDA $D41B : STA $02
+//      LDA $D41C : STA $03
+//      JMP loop
+static void load_osc3_loop(C64 &c64) {
+    const uint8_t program[] = {
+            0xA9, 0x00, 0x8D, 0x0E, 0xD4, 0xA9, 0x10, 0x8D, 0x0F, 0xD4, 0xA9, 0x21, 0x8D, 0x12, 0xD4,
+            0xAD, 0x1B, 0xD4, 0x85, 0x02, 0xAD, 0x1C, 0xD4, 0x85, 0x03, 0x4C, 0x0F, 0xC0,
+    };
+    c64.reset();
+    c64.write_ram(0xC000, program, sizeof(program));
+    c64.cpu.pc = 0xC000;
+    c64.cpu.cycles = 0;
+}
+
+TEST_CASE("SID in the C64") {
+    auto c64 = C64();
+
+    SECTION("Audio") {
+        REQUIRE(c64.take_audio().empty());
+        c64.enable_audio(44100);
+        REQUIRE(c64.audio_sample_rate() == 44100);
+        load_osc3_loop(c64);
+        c64.write(0xD418, 0x0F);
+        c64.run_frames(50);
+        auto samples = c64.take_audio();
+        // 50 PAL frames are a little short of a second
+        REQUIRE(samples.size() > 44100 * 50 * C64::cycles_per_frame / Sid::clock_rate - 40);
+        REQUIRE(samples.size() <= 44100 * 50 * C64::cycles_per_frame / Sid::clock_rate + 1);
+        REQUIRE(*std::max_element(samples.begin(), samples.end()) > 4000);
+
+        c64.disable_audio();
+        c64.run_frames(1);
+        REQUIRE(c64.take_audio().empty());
+        REQUIRE_THROWS_AS(c64.enable_audio(0), std::out_of_range);
+    }
+
+    SECTION("Same state whichever way it runs") {
+        load_osc3_loop(c64);
+        c64.run_for_cycles(100000);
+        REQUIRE(c64.ram[0x03] == 0x00); // attack and decay at the fastest rate, no sustain
+
+        for (auto dispatch: {Dispatch::Cached, Dispatch::Jit}) {
+            auto machine = C64();
+            machine.set_dispatch(dispatch);
+            machine.enable_audio(48000);
+            load_osc3_loop(machine);
+            machine.run_for_cycles(100000);
+            REQUIRE(machine.save_state() == c64.save_state());
+        }
+
+        auto clocked = C64();
+        load_osc3_loop(clocked);
+        for (uint64_t i = 0; i < 100000; i++) {
+            clocked.clock();
+        }
+        REQUIRE(clocked.save_state() == c64.save_state());
+
+        auto restored = C64();
+        restored.load_state(c64.save_state());
+        REQUIRE(restored.read(0xD41B, true) == c64.read(0xD41B, true));
+    }
+}
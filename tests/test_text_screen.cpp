@@ -0,0 +1,77 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+#include <cstring>
+#include <string>
+
+static void boot(C64 &c64) {
+    c64.reset();
+    // the '.' of READY. on the screen
+    while (c64.read(0x04CD, true) != 0x2E) {
+        c64.run_for_cycles(10000);
+    }
+}
+
+/// The RGBA of the text screen's pixel at (x, y) taken from the VIC-II frame
+static void frame_pixel(C64 &c64, int x, int y, uint8_t *out) {
+    uint8_t color = c64.get_vic().frame()[(35 + y) * VicII::frame_width + 32 + x];
+    std::memcpy(out, VicII::palette[color], 3);
+    out[3] = 0xFF;
+}
+
+TEST_CASE("Text screen") {
+    auto c64 = C64();
+    boot(c64);
+    c64.run_frames(1);
+
+    SECTION("Text") {
+        auto &screen = c64.render_text_screen();
+        auto text = screen.ascii();
+        REQUIRE(text.size() == TextScreen::cells + TextScreen::rows);
+        REQUIRE(text.substr(41, 40) == "    **** COMMODORE 64 BASIC V2 ****     ");
+        REQUIRE(text.substr(5 * 41, 6) == "READY.");
+
+        auto petscii = screen.petscii();
+        REQUIRE(petscii.substr(5 * 41, 6) == "READY.");
+        REQUIRE(petscii[40] == '\x0D');
+    }
+
+    SECTION("Only changed cells are drawn") {
+        auto &screen = c64.render_text_screen();
+        std::vector<uint8_t> first(screen.rgba(), screen.rgba() + TextScreen::width * TextScreen::height * 4);
+
+        // nothing but the cursor blinks
+        c64.run_frames(50);
+        REQUIRE(c64.text_screen->update(c64.vic_memory(), c64.text_screen->source) <= 2);
+
+        c64.type("PRINT 1+1\n");
+        c64.run_frames(10);
+        REQUIRE(c64.render_text_screen().ascii().find(" 2 ") != std::string::npos);
+
+        // the image matches what the VIC-II shows
+        uint8_t expected[4];
+        for (int y = 0; y < TextScreen::height; y++) {
+            for (int x = 0; x < TextScreen::width; x++) {
+                frame_pixel(c64, x, y, expected);
+                REQUIRE(std::memcmp(&screen.rgba()[(y * TextScreen::width + x) * 4], expected, 4) == 0);
+            }
+        }
+        REQUIRE(std::memcmp(first.data(), screen.rgba(), first.size()) != 0);
+    }
+
+    SECTION("Writes behind the CPU's back") {
+        c64.render_text_screen();
+        const uint8_t hello[] = {0x08, 0x05, 0x0C, 0x0C, 0x0F}; // HELLO in screen codes
+        c64.write_ram(0x0400 + 10 * 40, hello, sizeof(hello));
+        auto text = c64.render_text_screen().ascii();
+        REQUIRE(text.substr(10 * 41, 5) == "HELLO");
+
+        c64.ram_data()[0x0400 + 11 * 40] = 0x17; // W
+        REQUIRE(c64.render_text_screen().ascii()[11 * 41] == 'W');
+
+        c64.disable_text_screen();
+        REQUIRE(c64.write_map[0x04] != nullptr);
+    }
+}
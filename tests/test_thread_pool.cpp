@@ -0,0 +1,85 @@
+#include "catch2.hpp"
+#include <c64/c64.hpp>
+#include <c64/thread_pool.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+TEST_CASE("Thread pool") {
+    auto pool = ThreadPool(4);
+    REQUIRE(pool.size() == 4);
+
+    SECTION("Runs every task") {
+        std::atomic<int> sum = 0;
+        for (int i = 1; i <= 1000; i++) {
+            pool.submit([&sum, i] { sum += i; });
+        }
+        pool.wait();
+        REQUIRE(sum == 500500);
+    }
+
+    SECTION("Parallel for") {
+        std::vector<int> values(100);
+        pool.parallel_for(values.size(), [&](size_t index) { values[index] = index * 2; });
+        REQUIRE(values[0] == 0);
+        REQUIRE(values[99] == 198);
+    }
+
+    SECTION("A throwing task") {
+        std::atomic<int> ran = 0;
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&ran, i] {
+                if (i % 10 == 3) {
+                    throw std::runtime_error("task failed");
+                }
+                ran++;
+            });
+        }
+        REQUIRE_THROWS_AS(pool.wait(), std::runtime_error);
+        REQUIRE(ran == 90);
+
+        // reported once, the pool keeps working
+        pool.wait();
+        REQUIRE_THROWS_AS(pool.parallel_for(8, [](size_t index) {
+            if (index == 5) {
+                throw std::out_of_range("index");
+            }
+        }), std::out_of_range);
+        pool.parallel_for(8, [&ran](size_t) { ran++; });
+        REQUIRE(ran == 98);
+    }
+
+    SECTION("Tasks submitted from tasks") {
+        std::atomic<int> count = 0;
+        for (int round = 0; round < 200; round++) {
+            pool.submit([&] {
+                for (int i = 0; i < 10; i++) {
+                    pool.submit([&count] { count++; });
+                }
+            });
+            if (round % 50 == 0) {
+                pool.wait();
+            }
+        }
+        pool.wait();
+        REQUIRE(count == 2000);
+    }
+
+    SECTION("Independent C64 instances") {
+        std::vector<std::unique_ptr<C64>> machines;
+        for (int i = 0; i < 8; i++) {
+            machines.push_back(std::make_unique<C64>());
+        }
+        pool.parallel_for(machines.size(), [&](size_t index) {
+            machines[index]->reset();
+            machines[index]->run_for_cycles(200000 + index);
+        });
+
+        auto reference = std::make_unique<C64>();
+        reference->reset();
+        reference->run_for_cycles(200000 + 7);
+        REQUIRE(machines[7]->get_cpu().pc == reference->get_cpu().pc);
+        REQUIRE(machines[7]->get_cpu().clock_count == 200007);
+    }
+}
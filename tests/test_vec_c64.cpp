@@ -0,0 +1,62 @@
+#include "catch2.hpp"
+#include <c64/vec_c64.hpp>
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+TEST_CASE("VecC64") {
+    constexpr size_t count = 4;
+    auto source = C64();
+    source.reset();
+    source.run_for_cycles(2500000);
+
+    SECTION("Machines started apart stay apart and match a lone machine") {
+        // each one prints its own product
+        std::vector<std::unique_ptr<C64>> alone;
+        std::vector<std::vector<uint8_t>> states;
+        for (size_t i = 0; i < count; i++) {
+            auto machine = std::make_unique<C64>();
+            machine->load_state(source.save_state());
+            machine->type(fmt::format("PRINT {}*7\n", i + 1));
+            states.push_back(machine->save_state());
+            alone.push_back(std::move(machine));
+        }
+
+        auto vec = VecC64(count, 2);
+        REQUIRE(vec.size() == count);
+        vec.load_states(states);
+        vec.step(500000);
+        for (size_t i = 0; i < count; i++) {
+            alone[i]->run_for_cycles(500000);
+            REQUIRE(vec[i].save_state() == alone[i]->save_state());
+        }
+
+        std::vector<uint8_t> screens(count * VecC64::screen_size);
+        vec.screens(screens.data());
+        std::vector<uint16_t> registers(count * VecC64::register_count);
+        vec.registers(registers.data());
+        for (size_t i = 0; i < count; i++) {
+            auto row = screens.begin() + i * VecC64::screen_size;
+            std::vector<uint8_t> screen(VecC64::screen_size);
+            alone[i]->read_ram(0x0400, screen.data(), screen.size());
+            REQUIRE(std::equal(screen.begin(), screen.end(), row));
+            REQUIRE(registers[i * VecC64::register_count + 5] == alone[i]->get_cpu().pc);
+            for (size_t j = 0; j < i; j++) {
+                REQUIRE(!std::equal(row, row + VecC64::screen_size, screens.begin() + j * VecC64::screen_size));
+            }
+        }
+    }
+
+    SECTION("One state for all") {
+        auto vec = VecC64(count);
+        vec.load_state(source.save_state());
+        vec.step(100000);
+        source.run_for_cycles(100000);
+        for (size_t i = 0; i < count; i++) {
+            REQUIRE(vec[i].save_state() == source.save_state());
+        }
+        REQUIRE_THROWS_AS(vec.load_states({source.save_state()}), std::runtime_error);
+    }
+}
@@ -0,0 +1,151 @@
+#include "catch2.hpp"
+
+#define private public
+#include <c64/c64.hpp>
+
+#include <vector>
+
+// Sets up a raster interrupt on line 100 with the KERNAL banked out:
+//      SEI
+//      LDA #$35 : STA $01      ; I/O but no ROMs
+//      LDA #$30 : STA $FFFE
+//      LDA #$C0 : STA $FFFF    ; IRQ vector -> handler
+//      LDA #$1B : STA $D011
+//      LDA #100 : STA $D012
+//      LDA #$01 : STA $D01A    ; raster interrupt on
+//      STA $D019               ; drop the one line 0 raised
+//      CLI
+// loop JMP loop
+// handler ($C030):
+//      INC $02
+//      LDA $D012 : STA $03     ; the line it was taken on
+//      LDA #$FF : STA $D019    ; acknowledge
+//      RTI
+static void load_raster_interrupt(C64 &c64) {
+    const uint8_t program[] = {
+            0x78, 0xA9, 0x35, 0x85, 0x01, 0xA9, 0x30, 0x8D, 0xFE, 0xFF, 0xA9, 0xC0, 0x8D, 0xFF, 0xFF,
+            0xA9, 0x1B, 0x8D, 0x11, 0xD0, 0xA9, 0x64, 0x8D, 0x12, 0xD0, 0xA9, 0x01, 0x8D, 0x1A, 0xD0,
+            0x8D, 0x19, 0xD0, 0x58, 0x4C, 0x22, 0xC0,
+    };
+    const uint8_t handler[] = {0xE6, 0x02, 0xAD, 0x12, 0xD0, 0x85, 0x03, 0xA9, 0xFF, 0x8D, 0x19, 0xD0, 0x40};
+    c64.reset();
+    c64.write_ram(0xC000, program, sizeof(program));
+    c64.write_ram(0xC030, handler, sizeof(handler));
+    c64.cpu.pc = 0xC000;
+    c64.cpu.cycles = 0;
+}
+
+static void boot(C64 &c64) {
+    c64.reset();
+    // the '.' of READY. on the screen
+    while (c64.read(0x04CD, true) != 0x2E) {
+        c64.run_for_cycles(10000);
+    }
+}
+
+TEST_CASE("VIC-II") {
+    auto c64 = C64();
+
+    SECTION("Raster counter") {
+        // the KERNAL tells PAL from NTSC by the raster interrupt flag
+        boot(c64);
+        REQUIRE(c64.ram[0x02A6] == 1);
+
+        for (uint64_t cycles: {100, 5000, 20000, 1000000}) {
+            c64.run_for_cycles(cycles);
+            int line = VicII::raster_line(c64.cpu.clock_count + c64.cpu.cycles);
+            REQUIRE(c64.read(0xD012, true) == (line & 0xFF));
+            REQUIRE((c64.read(0xD011, true) & 0x80) == (line & 0x100) >> 1);
+        }
+    }
+
+    SECTION("Raster interrupt") {
+        for (auto dispatch: {Dispatch::Table, Dispatch::Cached, Dispatch::Jit}) {
+            auto machine = C64();
+            machine.set_dispatch(dispatch);
+            load_raster_interrupt(machine);
+            machine.run_frames(10);
+            REQUIRE(machine.ram[0x02] == 10);
+            REQUIRE(machine.ram[0x03] == 100);
+            REQUIRE((machine.read(0xD019, true) & 0x01) == 0);
+
+            auto reference = C64();
+            load_raster_interrupt(reference);
+            reference.run_frames(10);
+            REQUIRE(machine.save_state() == reference.save_state());
+        }
+
+        // clock by clock takes them at the same instruction boundaries
+        auto clocked = C64();
+        load_raster_interrupt(clocked);
+        for (uint64_t i = 0; i < 3 * C64::cycles_per_frame; i++) {
+            clocked.clock();
+        }
+        load_raster_interrupt(c64);
+        c64.run_frames(3);
+        REQUIRE(clocked.save_state() == c64.save_state());
+    }
+
+    SECTION("Text screen") {
+        boot(c64);
+        c64.run_frames(1);
+        auto &vic = c64.get_vic();
+        uint8_t const *frame = vic.frame();
+        auto const &chars = c64.rom_set()->chars;
+
+        uint8_t border = c64.read(0xD020, true) & 0x0F;
+        uint8_t background = c64.read(0xD021, true) & 0x0F;
+        REQUIRE(border == 14);
+        REQUIRE(background == 6);
+        REQUIRE(frame[0] == border);
+        REQUIRE(frame[VicII::frame_width * VicII::frame_height - 1] == border);
+
+        // the display window starts at (32, 35) and shows upper case characters
+        for (int row = 0; row < 25; row++) {
+            for (int column = 0; column < 40; column++) {
+                uint8_t code = c64.read(0x0400 + row * 40 + column, true);
+                uint8_t color = c64.ram[0xD800 + row * 40 + column] & 0x0F;
+                for (int line = 0; line < 8; line++) {
+                    uint8_t pattern = chars[code * 8 + line];
+                    uint8_t const *pixels = frame + (35 + row * 8 + line) * VicII::frame_width + 32 + column * 8;
+                    for (int pixel = 0; pixel < 8; pixel++) {
+                        REQUIRE(pixels[pixel] == ((pattern << pixel) & 0x80 ? color : background));
+                    }
+                }
+            }
+        }
+
+        std::vector<uint8_t> rgba(VicII::frame_width * VicII::frame_height * 4);
+        vic.frame_rgba(rgba.data());
+        REQUIRE(rgba[0] == VicII::palette[border][0]);
+        REQUIRE(rgba[3] == 0xFF);
+    }
+
+    SECTION("Sprites") {
+        boot(c64);
+        // a solid sprite 0 at (100, 60) from $0340, expanded sideways, over
+        // the text of the first line
+        std::vector<uint8_t> block(63, 0xFF);
+        c64.write_ram(0x0340, block.data(), block.size());
+        c64.write(0x07F8, 0x0D);
+        c64.write(0xD000, 100);
+        c64.write(0xD001, 60);
+        c64.write(0xD027, 1);
+        c64.write(0xD01D, 0x01);
+        c64.write(0xD015, 0x01);
+        c64.run_frames(2);
+
+        uint8_t const *frame = c64.get_vic().frame();
+        int x = 100 + 8;
+        int y = 60 + 1 - VicII::first_visible_line;
+        REQUIRE(frame[y * VicII::frame_width + x] == 1);
+        REQUIRE(frame[(y + 20) * VicII::frame_width + x + 47] == 1);
+        REQUIRE(frame[(y + 21) * VicII::frame_width + x] != 1);
+        REQUIRE(frame[y * VicII::frame_width + x + 48] != 1);
+        REQUIRE(frame[(y - 1) * VicII::frame_width + x] != 1);
+
+        // it covers characters, reading the collision register clears it
+        REQUIRE(c64.read(0xD01F) == 0x01);
+        REQUIRE(c64.read(0xD01F, true) == 0x00);
+    }
+}
@@ -5,7 +5,7 @@ constexpr unsigned int hash(const char *str, int h = 0) {
     return !str[h] ? 5381 : (hash(str, h + 1u) * 33u) ^ str[h];
 }
 
-static int instruction_size(const CPU6502 &cpu, CPUIO &bus) {
+static int instruction_size(const CPU6502Base &cpu, CPUIO &bus) {
     auto opcode = bus.read(cpu.pc, true);
 
     auto addr_mode = cpu.instruction_info(opcode).addr_mode;
@@ -37,7 +37,7 @@ static int instruction_size(const CPU6502 &cpu, CPUIO &bus) {
     }
 }
 
-static std::string relevant_bytes(const CPU6502 &cpu, CPUIO &bus, const char * addr_mode) {
+static std::string relevant_bytes(const CPU6502Base &cpu, CPUIO &bus, const char * addr_mode) {
     auto opc = bus.read(cpu.pc, true);
     switch (hash(addr_mode)) {
         case hash("IMP"): {
@@ -82,7 +82,7 @@ static std::string flags_to_string(uint8_t flags) {
     return fmt::format("{}{}{}{}{}{}{}{}", c, z, i, d, b, u, v, n);
 }
 
-static std::string address(const CPU6502 &cpu, CPUIO &bus) {
+static std::string address(const CPU6502Base &cpu, CPUIO &bus) {
     auto opcode = bus.read(cpu.pc, true);
     uint16_t addr = cpu.pc + 1;
     auto instruction_info = cpu.instruction_info(opcode);
@@ -227,7 +227,7 @@ static std::string address(const CPU6502 &cpu, CPUIO &bus) {
     }
 }
 
-std::string nestools::full_cpu_status_as_string(const CPU6502 &cpu, CPUIO &bus) {
+std::string nestools::full_cpu_status_as_string(const CPU6502Base &cpu, CPUIO &bus) {
     auto pc = cpu.pc;
     auto opcode = bus.read(pc, true);
 
@@ -241,11 +241,11 @@ std::string nestools::full_cpu_status_as_string(const CPU6502 &cpu, CPUIO &bus)
 
     return fmt::format(
             "{:04X}  {:<9}{}{} {:<28}A:{:02X} X:{:02X} Y:{:02X} P:{:02X} SP:{:02X} CYC:{} {} {}",
-            pc, bytes, ns, name, addressing, cpu.a, cpu.x, cpu.y, cpu.status, cpu.stkp,
+            pc, bytes, ns, name, addressing, cpu.a, cpu.x, cpu.y, uint8_t(cpu.status), cpu.stkp,
             cpu.clock_count, instruction_info.addr_mode, flags_to_string(cpu.status));
 }
 
-static std::string summary_cpu_status(const CPU6502 &cpu, CPUIO &bus) {
+static std::string summary_cpu_status(const CPU6502Base &cpu, CPUIO &bus) {
     auto pc = cpu.pc;
     auto opcode = bus.read(pc, true);
 
@@ -258,11 +258,11 @@ static std::string summary_cpu_status(const CPU6502 &cpu, CPUIO &bus) {
     return fmt::format("{:04X} {}{} {:<18} [{}]", pc, ns, name, addressing, addr_mode);
 }
 
-std::string nestools::cpu_status_summary(const CPU6502 & cpu, CPUIO & bus) {
+std::string nestools::cpu_status_summary(const CPU6502Base & cpu, CPUIO & bus) {
     return summary_cpu_status(cpu, bus);
 }
 
-std::map<uint16_t, std::string> nestools::disassemble(const CPU6502 &cpu, CPUIO &bus, uint16_t from, uint16_t to) {
+std::map<uint16_t, std::string> nestools::disassemble(const CPU6502Base &cpu, CPUIO &bus, uint16_t from, uint16_t to) {
     std::map<uint16_t, std::string> map;
     uint32_t addr = from;
 